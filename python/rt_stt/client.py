@@ -13,6 +13,11 @@ from dataclasses import dataclass
 from enum import IntEnum
 import logging
 
+try:
+    import msgpack  # Optional: compact binary frames after SUBSCRIBE
+except ImportError:
+    msgpack = None
+
 logger = logging.getLogger(__name__)
 
 
@@ -48,13 +53,17 @@ class TranscriptionResult:
     text: str
     confidence: float
     timestamp: int
+    is_final: bool = True  # False for streaming partials that will be superseded
+    stream_id: str = 'default'
     
     @classmethod
     def from_dict(cls, data: dict) -> 'TranscriptionResult':
         return cls(
             text=data.get('text', ''),
             confidence=data.get('confidence', 1.0),
-            timestamp=data.get('timestamp', 0)
+            timestamp=data.get('timestamp', 0),
+            is_final=data.get('is_final', True),
+            stream_id=data.get('stream_id', 'default')
         )
 
 
@@ -97,7 +106,8 @@ class RTSTTClient:
     
     def __init__(self, socket_path: str = "/tmp/rt-stt.sock", 
                  auto_reconnect: bool = True,
-                 reconnect_delay: float = 1.0):
+                 reconnect_delay: float = 1.0,
+                 encoding: str = "auto"):
         """
         Initialize RT-STT client
         
@@ -105,11 +115,23 @@ class RTSTTClient:
             socket_path: Path to Unix domain socket
             auto_reconnect: Automatically reconnect on disconnect
             reconnect_delay: Delay between reconnection attempts
+            encoding: Frame encoding to negotiate on subscribe: "msgpack",
+                "json", or "auto" (msgpack if the package is installed)
         """
         self.socket_path = socket_path
         self.auto_reconnect = auto_reconnect
         self.reconnect_delay = reconnect_delay
         
+        if encoding == "auto":
+            encoding = "msgpack" if msgpack else "json"
+        if encoding == "msgpack" and not msgpack:
+            raise RTSTTError("msgpack encoding requires the 'msgpack' package")
+        if encoding not in ("json", "msgpack"):
+            raise RTSTTError(f"Unsupported encoding: {encoding}")
+        self._requested_encoding = encoding
+        self._encoding = "json"  # Every connection starts out as JSON
+        self._subscription: Dict[str, Any] = {}  # Re-sent on reconnect
+        
         self._socket: Optional[socket.socket] = None
         self._connected = False
         self._running = False
@@ -143,6 +165,7 @@ class RTSTTClient:
         try:
             self._socket = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
             self._socket.connect(self.socket_path)
+            self._encoding = "json"
             self._connected = True
             self._running = True
             
@@ -158,7 +181,7 @@ class RTSTTClient:
             
             # Auto-subscribe if we have a transcription callback
             if self._transcription_callback and not self._subscribed:
-                self.subscribe()
+                self._send_subscribe()
             
             return True
             
@@ -207,15 +230,14 @@ class RTSTTClient:
         }
         
         try:
-            # Serialize to JSON
-            json_data = json.dumps(message).encode('utf-8')
-            
-            # Send length prefix
-            length = struct.pack('!I', len(json_data))
-            self._socket.sendall(length)
+            # Serialize; the daemon accepts either encoding at any time
+            if self._encoding == "msgpack":
+                payload = msgpack.packb(message, use_bin_type=True)
+            else:
+                payload = json.dumps(message).encode('utf-8')
             
-            # Send message
-            self._socket.sendall(json_data)
+            # Send length prefix and message together
+            self._socket.sendall(struct.pack('!I', len(payload)) + payload)
             
             return msg_id
             
@@ -223,25 +245,36 @@ class RTSTTClient:
             self._handle_disconnect()
             raise ConnectionError(f"Failed to send message: {e}") from e
     
+    def _recv_exact(self, size: int) -> Optional[bytes]:
+        """Read exactly size bytes, or None if the connection closed"""
+        data = bytearray()
+        while len(data) < size:
+            chunk = self._socket.recv(size - len(data))
+            if not chunk:
+                return None
+            data += chunk
+        return bytes(data)
+    
     def _receive_message(self) -> Optional[dict]:
         """Receive a message from the daemon"""
         try:
             # Read length prefix
-            length_data = self._socket.recv(4)
+            length_data = self._recv_exact(4)
             if not length_data:
                 return None
             
             length = struct.unpack('!I', length_data)[0]
             
             # Read message
-            data = b''
-            while len(data) < length:
-                chunk = self._socket.recv(length - len(data))
-                if not chunk:
-                    return None
-                data += chunk
+            data = self._recv_exact(length)
+            if data is None:
+                return None
             
-            # Parse JSON
+            # MessagePack maps start with 0x80-0x8f, 0xde or 0xdf; JSON with '{'
+            if data and (data[0] & 0xF0 == 0x80 or data[0] in (0xde, 0xdf)):
+                if not msgpack:
+                    raise RTSTTError("Received msgpack frame but 'msgpack' is not installed")
+                return msgpack.unpackb(data, raw=False)
             return json.loads(data.decode('utf-8'))
             
         except Exception as e:
@@ -284,6 +317,10 @@ class RTSTTClient:
                 self._error_callback(error_msg)
         
         elif msg_type == MessageType.ACKNOWLEDGMENT:
+            # A subscribe ack switches encoding for everything after it
+            if data.get('encoding') in ("json", "msgpack"):
+                self._encoding = data['encoding']
+            
             # Handle command responses
             with self._lock:
                 if msg_id in self._pending_commands:
@@ -342,9 +379,40 @@ class RTSTTClient:
     
     # Public API methods
     
-    def subscribe(self):
-        """Subscribe to transcription events"""
-        self._send_message(MessageType.SUBSCRIBE, {})
+    def subscribe(self, fields: Optional[List[str]] = None,
+                  min_confidence: Optional[float] = None,
+                  finals_only: bool = False,
+                  partials_only: bool = False,
+                  stream_id: Optional[str] = None):
+        """Subscribe to transcription events
+        
+        With no arguments the full transcription object for every result is
+        delivered. Calling subscribe again replaces the previous filters.
+        
+        Args:
+            fields: Top-level fields to receive, e.g. ["text", "is_final"]
+            min_confidence: Drop results below this confidence
+            finals_only: Only final results
+            partials_only: Only streaming partials
+            stream_id: Only results from this capture stream
+        """
+        subscription: Dict[str, Any] = {}
+        if fields is not None:
+            subscription["fields"] = list(fields)
+        if min_confidence is not None:
+            subscription["min_confidence"] = min_confidence
+        if finals_only:
+            subscription["finals_only"] = True
+        if partials_only:
+            subscription["partials_only"] = True
+        if stream_id is not None:
+            subscription["stream_id"] = stream_id
+        self._subscription = subscription
+        self._send_subscribe()
+    
+    def _send_subscribe(self):
+        data = dict(self._subscription, encoding=self._requested_encoding)
+        self._send_message(MessageType.SUBSCRIBE, data)
         self._subscribed = True
         logger.info("Subscribed to transcriptions")
     
@@ -439,7 +507,7 @@ class RTSTTClient:
         """Set callback for transcription results"""
         self._transcription_callback = callback
         if self._connected and not self._subscribed:
-            self.subscribe()
+            self._send_subscribe()
     
     def on_status(self, callback: Callable[[Status], None]):
         """Set callback for status updates"""
@@ -467,7 +535,7 @@ class RTSTTClient:
     def start_listening(self):
         """Start listening (resume + subscribe)"""
         if not self._subscribed:
-            self.subscribe()
+            self._send_subscribe()
         self.resume()
     
     def stop_listening(self):
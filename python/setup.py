@@ -29,6 +29,8 @@ setup(
         # No external dependencies - uses only stdlib!
     ],
     extras_require={
+        # Compact binary frames; the client uses them automatically when present
+        'msgpack': ['msgpack>=1.0'],
         'dev': [
             'pytest>=6.0',
             'pytest-cov',
@@ -15,6 +15,7 @@ mkdir -p models
 
 # Model URLs
 BASE_URL="https://huggingface.co/ggerganov/whisper.cpp/resolve/main"
+VAD_BASE_URL="https://huggingface.co/ggml-org/whisper-vad/resolve/main"
 
 # Available models
 echo ""
@@ -27,6 +28,7 @@ echo "5) base       (142 MB) - Multilingual"
 echo "6) small      (466 MB) - Multilingual, good balance"
 echo "7) medium     (1.5 GB) - Multilingual, high accuracy"
 echo "8) large-v3   (3.1 GB) - Multilingual, best accuracy"
+echo "9) silero-vad (1 MB)   - Neural VAD model (stt.vad.type = \"neural\")"
 echo ""
 echo "For lowest latency STT, we recommend 'base.en' (option 2)"
 echo ""
@@ -67,6 +69,10 @@ for choice in $choices; do
             model="large-v3"
             file="ggml-large-v3.bin"
             ;;
+        9)
+            model="silero-vad"
+            file="ggml-silero-v5.1.2.bin"
+            ;;
         *)
             echo "Invalid choice: $choice"
             continue
@@ -77,7 +83,11 @@ for choice in $choices; do
         echo "Model $model already exists, skipping..."
     else
         echo "Downloading $model model..."
-        curl -L "${BASE_URL}/${file}" -o "models/${file}" --progress-bar
+        url="${BASE_URL}/${file}"
+        if [ "$model" = "silero-vad" ]; then
+            url="${VAD_BASE_URL}/${file}"
+        fi
+        curl -L "$url" -o "models/${file}" --progress-bar
         echo "Downloaded $model successfully!"
     fi
 done
@@ -92,6 +102,9 @@ if [[ "$response" =~ ^([yY][eE][sS]|[yY])$ ]]; then
     for model_file in ../../models/ggml-*.bin; do
         if [ -f "$model_file" ]; then
             model_name=$(basename "$model_file" .bin)
+            if [[ "$model_name" == ggml-silero-* ]]; then
+                continue
+            fi
             echo "Converting $model_name to Core ML..."
             ./models/generate-coreml-model.sh "$model_file"
         fi
@@ -0,0 +1,272 @@
+#include "audio/audio_tap.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <new>
+
+namespace rt_stt {
+namespace audio {
+
+// File layout: one page of header, the event ring, then the sample ring,
+// each starting on a page boundary. Positions are monotonic counts; slot
+// i of a ring holds position i % capacity.
+static constexpr char TAP_MAGIC[8] = {'R', 'T', 'S', 'T', 'T', 'A', 'P', '\0'};
+static constexpr uint32_t TAP_VERSION = 1;
+static constexpr size_t TAP_PAGE = 4096;
+// Largest block write() copies before publishing write_pos. The copy lands
+// in the ring ahead of write_pos, so a reader has to assume this many of
+// the oldest slots it sees may already be overwritten.
+static constexpr uint64_t TAP_MAX_WRITE = 4096;
+
+struct TapHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t sample_rate;
+    uint64_t capacity_samples;
+    uint64_t event_capacity;
+    int64_t start_unix_ms;
+    std::atomic<uint64_t> write_pos;   // Samples ever written; published after the copy
+    std::atomic<uint64_t> event_pos;   // Events ever written
+};
+
+struct TapEvent {
+    uint64_t position;
+    uint8_t old_state;
+    uint8_t new_state;
+    uint8_t reserved[6];
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "tap positions are shared through the mapping");
+static_assert(sizeof(TapHeader) <= TAP_PAGE, "tap header must fit its page");
+static_assert(sizeof(TapEvent) == 16, "tap event layout is part of the file format");
+
+static size_t page_align(size_t bytes) {
+    return (bytes + TAP_PAGE - 1) / TAP_PAGE * TAP_PAGE;
+}
+
+static size_t events_offset() {
+    return TAP_PAGE;
+}
+
+static size_t samples_offset(uint64_t event_capacity) {
+    return events_offset() + page_align(event_capacity * sizeof(TapEvent));
+}
+
+AudioTap::~AudioTap() {
+    close();
+}
+
+bool AudioTap::open(const std::string& path, uint32_t sample_rate, size_t capacity_seconds,
+                    size_t event_capacity) {
+    close();
+
+    capacity_ = static_cast<uint64_t>(std::max<size_t>(capacity_seconds, 1)) * sample_rate;
+    event_capacity_ = std::max<size_t>(event_capacity, 16);
+    mapping_size_ = samples_offset(event_capacity_) + page_align(capacity_ * sizeof(float));
+
+    // Keep the previous recording (e.g. the one from before a crash) as
+    // path.prev rather than truncating it
+    std::string previous = path + ".prev";
+    if (std::rename(path.c_str(), previous.c_str()) != 0 && errno != ENOENT) {
+        std::cerr << "Audio tap: cannot keep " << path << " as " << previous << ": "
+                  << std::strerror(errno) << std::endl;
+    }
+
+    fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd_ < 0) {
+        std::cerr << "Audio tap: cannot create " << path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    if (ftruncate(fd_, static_cast<off_t>(mapping_size_)) != 0) {
+        std::cerr << "Audio tap: cannot size " << path << ": " << std::strerror(errno) << std::endl;
+        close();
+        return false;
+    }
+
+    mapping_ = mmap(nullptr, mapping_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (mapping_ == MAP_FAILED) {
+        std::cerr << "Audio tap: cannot map " << path << ": " << std::strerror(errno) << std::endl;
+        mapping_ = nullptr;
+        close();
+        return false;
+    }
+
+    // Touch every page now so recording never takes a first-write fault
+    std::memset(mapping_, 0, mapping_size_);
+
+    char* base = static_cast<char*>(mapping_);
+    events_ = reinterpret_cast<TapEvent*>(base + events_offset());
+    samples_ = reinterpret_cast<float*>(base + samples_offset(event_capacity_));
+
+    header_ = new (base) TapHeader();
+    header_->version = TAP_VERSION;
+    header_->sample_rate = sample_rate;
+    header_->capacity_samples = capacity_;
+    header_->event_capacity = event_capacity_;
+    header_->start_unix_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    header_->write_pos.store(0, std::memory_order_relaxed);
+    header_->event_pos.store(0, std::memory_order_relaxed);
+    // The magic goes last: a reader never sees a half-initialized header
+    std::atomic_thread_fence(std::memory_order_release);
+    std::memcpy(header_->magic, TAP_MAGIC, sizeof(TAP_MAGIC));
+    return true;
+}
+
+void AudioTap::close() {
+    if (mapping_) {
+        msync(mapping_, mapping_size_, MS_ASYNC);
+        munmap(mapping_, mapping_size_);
+        mapping_ = nullptr;
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+    header_ = nullptr;
+    events_ = nullptr;
+    samples_ = nullptr;
+}
+
+void AudioTap::write(const float* samples, size_t n_samples) {
+    if (!header_ || n_samples == 0) return;
+
+    uint64_t pos = header_->write_pos.load(std::memory_order_relaxed);
+
+    // More than the ring holds: only the newest capacity_ samples survive
+    if (n_samples > capacity_) {
+        samples += n_samples - capacity_;
+        pos += n_samples - capacity_;
+        n_samples = static_cast<size_t>(capacity_);
+    }
+
+    // Publish every TAP_MAX_WRITE samples, so a reader knows how far ahead
+    // of write_pos the ring may be changing
+    while (n_samples > 0) {
+        size_t block = std::min<size_t>(n_samples, static_cast<size_t>(TAP_MAX_WRITE));
+        size_t slot = static_cast<size_t>(pos % capacity_);
+        size_t first = std::min<size_t>(block, static_cast<size_t>(capacity_) - slot);
+        std::memcpy(samples_ + slot, samples, first * sizeof(float));
+        if (first < block) {
+            std::memcpy(samples_, samples + first, (block - first) * sizeof(float));
+        }
+        pos += block;
+        samples += block;
+        n_samples -= block;
+        header_->write_pos.store(pos, std::memory_order_release);
+    }
+}
+
+void AudioTap::mark(VAD::State old_state, VAD::State new_state) {
+    if (!header_) return;
+
+    uint64_t n = header_->event_pos.load(std::memory_order_relaxed);
+    TapEvent& event = events_[n % event_capacity_];
+    event.position = header_->write_pos.load(std::memory_order_relaxed);
+    event.old_state = static_cast<uint8_t>(old_state);
+    event.new_state = static_cast<uint8_t>(new_state);
+    header_->event_pos.store(n + 1, std::memory_order_release);
+}
+
+uint64_t AudioTap::position() const {
+    return header_ ? header_->write_pos.load(std::memory_order_relaxed) : 0;
+}
+
+bool AudioTapReader::open(const std::string& path) {
+    samples_.clear();
+    events_.clear();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Cannot open tap file " << path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < TAP_PAGE) {
+        std::cerr << "Not a tap file: " << path << std::endl;
+        ::close(fd);
+        return false;
+    }
+
+    size_t size = static_cast<size_t>(st.st_size);
+    void* mapping = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        std::cerr << "Cannot map tap file " << path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    const char* base = static_cast<const char*>(mapping);
+    const TapHeader* header = reinterpret_cast<const TapHeader*>(base);
+    bool valid = std::memcmp(header->magic, TAP_MAGIC, sizeof(TAP_MAGIC)) == 0 &&
+                 header->version == TAP_VERSION && header->capacity_samples > 0 &&
+                 header->event_capacity > 0 &&
+                 samples_offset(header->event_capacity) + header->capacity_samples * sizeof(float) <= size;
+    if (!valid) {
+        std::cerr << "Not a tap file (or unsupported version): " << path << std::endl;
+        munmap(mapping, size);
+        return false;
+    }
+
+    sample_rate_ = header->sample_rate;
+    start_unix_ms_ = header->start_unix_ms;
+    const uint64_t capacity = header->capacity_samples;
+    const uint64_t event_capacity = header->event_capacity;
+    const float* ring = reinterpret_cast<const float*>(base + samples_offset(event_capacity));
+    const TapEvent* event_ring = reinterpret_cast<const TapEvent*>(base + events_offset());
+
+    // Copy the retained window oldest first
+    uint64_t end = header->write_pos.load(std::memory_order_acquire);
+    uint64_t begin = end - std::min(end, capacity);
+    samples_.resize(static_cast<size_t>(end - begin));
+    for (uint64_t pos = begin; pos < end;) {
+        size_t slot = static_cast<size_t>(pos % capacity);
+        size_t n = static_cast<size_t>(std::min<uint64_t>(end - pos, capacity - slot));
+        std::memcpy(samples_.data() + (pos - begin), ring + slot, n * sizeof(float));
+        pos += n;
+    }
+
+    uint64_t event_end = header->event_pos.load(std::memory_order_acquire);
+    uint64_t event_begin = event_end - std::min(event_end, event_capacity);
+    std::vector<TapEvent> raw;
+    raw.reserve(static_cast<size_t>(event_end - event_begin));
+    for (uint64_t n = event_begin; n < event_end; ++n) {
+        raw.push_back(event_ring[n % event_capacity]);
+    }
+
+    // A live writer may have lapped the oldest part of the copy meanwhile,
+    // including a write still in progress past end_after: up to
+    // TAP_MAX_WRITE samples, or the one event slot at event_end_after
+    uint64_t end_after = header->write_pos.load(std::memory_order_acquire) + TAP_MAX_WRITE;
+    uint64_t event_end_after = header->event_pos.load(std::memory_order_acquire) + 1;
+    munmap(mapping, size);
+
+    if (end_after > begin + capacity) {
+        size_t overwritten = static_cast<size_t>(std::min<uint64_t>(end_after - capacity - begin, samples_.size()));
+        samples_.erase(samples_.begin(), samples_.begin() + overwritten);
+        begin += overwritten;
+    }
+    first_position_ = begin;
+
+    size_t events_overwritten = event_end_after > event_begin + event_capacity
+        ? static_cast<size_t>(std::min<uint64_t>(event_end_after - event_capacity - event_begin, raw.size()))
+        : 0;
+    for (size_t i = events_overwritten; i < raw.size(); ++i) {
+        if (raw[i].position < begin || raw[i].position > end) continue;
+        events_.push_back({raw[i].position, static_cast<VAD::State>(raw[i].old_state),
+                           static_cast<VAD::State>(raw[i].new_state)});
+    }
+    return true;
+}
+
+} // namespace audio
+} // namespace rt_stt
@@ -0,0 +1,84 @@
+#ifndef AUDIO_AUDIO_TAP_H
+#define AUDIO_AUDIO_TAP_H
+
+#include "audio/vad.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace rt_stt {
+namespace audio {
+
+struct TapHeader;
+struct TapEvent;
+
+// Flight recorder for engine input: the last N seconds of a stream's audio
+// and its VAD transitions, kept in a preallocated memory-mapped ring file.
+// Recording is a memcpy into the mapping plus one atomic store; the kernel
+// writes the pages back in the background, so the hot path makes no
+// syscalls. The file stays readable (AudioTapReader) while it is written
+// and after a crash.
+class AudioTap {
+public:
+    AudioTap() = default;
+    ~AudioTap();
+    AudioTap(const AudioTap&) = delete;
+    AudioTap& operator=(const AudioTap&) = delete;
+
+    // Creates path, sized for capacity_seconds of audio and event_capacity
+    // VAD transitions, and faults every page in up front. An existing file
+    // is kept as path.prev first, so a restart after a crash does not wipe
+    // the recording of it.
+    bool open(const std::string& path, uint32_t sample_rate, size_t capacity_seconds,
+              size_t event_capacity = 4096);
+    void close();
+    bool is_open() const { return header_ != nullptr; }
+
+    // Single writer (the thread feeding the stream). Allocation- and syscall-free.
+    void write(const float* samples, size_t n_samples);
+    void mark(VAD::State old_state, VAD::State new_state);  // At the current position
+
+    uint64_t position() const;   // Samples recorded since open()
+
+private:
+    int fd_ = -1;
+    void* mapping_ = nullptr;
+    size_t mapping_size_ = 0;
+    TapHeader* header_ = nullptr;
+    TapEvent* events_ = nullptr;
+    float* samples_ = nullptr;
+    uint64_t capacity_ = 0;
+    uint64_t event_capacity_ = 0;
+};
+
+// A consistent copy of what a tap file currently retains, taken even while
+// the daemon keeps recording into it
+class AudioTapReader {
+public:
+    struct Event {
+        uint64_t position;       // Absolute sample position (since the tap was opened)
+        VAD::State old_state;
+        VAD::State new_state;
+    };
+
+    bool open(const std::string& path);
+
+    uint32_t sample_rate() const { return sample_rate_; }
+    int64_t start_unix_ms() const { return start_unix_ms_; }   // Wall clock of position 0
+    uint64_t first_position() const { return first_position_; } // Position of samples()[0]
+    const std::vector<float>& samples() const { return samples_; }
+    const std::vector<Event>& events() const { return events_; }  // Within the retained audio, in order
+
+private:
+    uint32_t sample_rate_ = 0;
+    int64_t start_unix_ms_ = 0;
+    uint64_t first_position_ = 0;
+    std::vector<float> samples_;
+    std::vector<Event> events_;
+};
+
+} // namespace audio
+} // namespace rt_stt
+
+#endif // AUDIO_AUDIO_TAP_H
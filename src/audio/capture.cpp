@@ -1,7 +1,12 @@
 #include "audio/capture.h"
+#include "audio/ring_buffer.h"
+#include "audio/dsp.h"
 #include <iostream>
 #include <cstring>
 #include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <thread>
 
 #ifdef __APPLE__
 #include <CoreAudio/CoreAudio.h>
@@ -12,6 +17,33 @@
 #define MINIAUDIO_IMPLEMENTATION
 #include "miniaudio.h"
 
+#ifdef RT_STT_CHECK_RT_ALLOC
+#include <cassert>
+#include <cstdlib>
+#include <new>
+
+namespace {
+// Set while a thread is inside a real-time audio callback
+thread_local bool t_in_realtime_callback = false;
+std::atomic<size_t> g_realtime_allocations{0};
+}
+
+// Debug-only replacement of the global allocator that counts allocations made
+// from inside a RealtimeScope. Enabled with -DRT_STT_CHECK_RT_ALLOC=ON.
+void* operator new(std::size_t size) {
+    if (t_in_realtime_callback) {
+        g_realtime_allocations.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (void* ptr = std::malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+#endif
+
 namespace rt_stt {
 namespace audio {
 
@@ -19,22 +51,147 @@ struct AudioCapture::Impl {
 #ifdef __APPLE__
     AudioUnit audio_unit = nullptr;
     AudioDeviceID device_id = kAudioDeviceUnknown;
+    
+    // Render buffers handed to AudioUnitRender, one per channel.
+    // Sized once in initialize_coreaudio() so the callback never allocates.
+    AudioBufferList* render_buffers = nullptr;
+    std::vector<float> channel_storage;
+    std::vector<const float*> channel_planes;  // Per-channel pointers for dsp::downmix_planar
 #endif
     
     // miniaudio fallback
     ma_device ma_device;
     bool use_miniaudio = false;
     
-    // Ring buffer for thread safety
-    std::vector<float> ring_buffer;
-    size_t write_pos = 0;
-    size_t read_pos = 0;
-    std::mutex buffer_mutex;
+    // Lock-free hand-off to the consumer thread in pull mode (use_callback = false)
+    SPSCRingBuffer ring_buffer;
     
     // Actual channel count being captured
     int actual_channels = 1;
+    
+    // Channel picked for force_single_channel, validated at init time
+    int selected_channel = 0;
+    
+    // Scratch buffer for channel extraction / downmix
+    std::vector<float> mono_buffer;
+    size_t max_frames = 0;
+    
+    // native_rate: the ring holds device-rate audio, converted to
+    // sample_rate by whichever thread reads it, never the audio thread
+    bool resampling = false;
+    std::atomic<int> device_rate{0};    // Updated on a device rate change
+    int chunk_ms = 30;
+    dsp::Resampler resampler;           // Consumer side only, like the ring's read()
+    std::vector<float> native_chunk;
+    std::vector<float> resampled;       // Converted samples not yet handed out
+    size_t resampled_pos = 0;
+    size_t resampled_len = 0;
+    
+    // native_rate with use_callback: feeds the callback from its own thread
+    std::thread resample_thread;
+    std::atomic<bool> resample_running{false};
+    std::mutex format_mutex;            // Start/stop against a rate-change reformat
+    mutable std::mutex ring_mutex;      // Resampling consumer against a rate-change ring resize
+    
+    void setup_resampler(int rate, int out_rate) {
+        size_t chunk = std::max<size_t>(1, (static_cast<size_t>(chunk_ms) * rate) / 1000);
+        resampler.configure(rate, out_rate, chunk);
+        native_chunk.assign(chunk, 0.0f);
+        resampled.assign(resampler.max_output(chunk), 0.0f);
+        resampled_pos = 0;
+        resampled_len = 0;
+    }
+    
+    size_t read_resampled(float* out, size_t max_samples) {
+        std::lock_guard<std::mutex> lock(ring_mutex);
+        int rate = device_rate.load(std::memory_order_acquire);
+        if (rate != resampler.in_rate()) {
+            // Audio still queued at the old rate would come out at the wrong
+            // pitch; drop it and convert from the new rate on
+            while (ring_buffer.read(native_chunk.data(), native_chunk.size()) > 0) {}
+            setup_resampler(rate, resampler.out_rate());
+        }
+        
+        size_t written = 0;
+        while (written < max_samples) {
+            if (resampled_pos == resampled_len) {
+                size_t n = ring_buffer.read(native_chunk.data(), native_chunk.size());
+                if (n == 0) break;
+                resampled_len = resampler.process(native_chunk.data(), n, resampled.data());
+                resampled_pos = 0;
+                continue;
+            }
+            size_t n = std::min(max_samples - written, resampled_len - resampled_pos);
+            std::memcpy(out + written, resampled.data() + resampled_pos, n * sizeof(float));
+            resampled_pos += n;
+            written += n;
+        }
+        return written;
+    }
+    
+#ifdef __APPLE__
+    void allocate_render_buffers(size_t frames) {
+        free_render_buffers();
+        
+        max_frames = frames;
+        channel_storage.assign(static_cast<size_t>(actual_channels) * max_frames, 0.0f);
+        mono_buffer.assign(max_frames, 0.0f);
+        channel_planes.assign(actual_channels, nullptr);
+        
+        render_buffers = static_cast<AudioBufferList*>(calloc(
+            1, offsetof(AudioBufferList, mBuffers) + sizeof(AudioBuffer) * actual_channels
+        ));
+        render_buffers->mNumberBuffers = actual_channels;
+        for (int ch = 0; ch < actual_channels; ++ch) {
+            render_buffers->mBuffers[ch].mNumberChannels = 1;
+            render_buffers->mBuffers[ch].mDataByteSize = max_frames * sizeof(float);
+            render_buffers->mBuffers[ch].mData = channel_storage.data() + ch * max_frames;
+        }
+    }
+    
+    void free_render_buffers() {
+        if (render_buffers) {
+            free(render_buffers);
+            render_buffers = nullptr;
+        }
+        channel_storage.clear();
+        channel_storage.shrink_to_fit();
+    }
+#endif
+};
+
+namespace {
+
+// Marks the enclosing scope as real-time. When built with RT_STT_CHECK_RT_ALLOC,
+// every heap allocation made inside the scope is counted and asserted on.
+class RealtimeScope {
+public:
+#ifdef RT_STT_CHECK_RT_ALLOC
+    RealtimeScope() : allocations_at_entry_(g_realtime_allocations.load(std::memory_order_relaxed)) {
+        t_in_realtime_callback = true;
+    }
+    ~RealtimeScope() {
+        t_in_realtime_callback = false;
+        assert(g_realtime_allocations.load(std::memory_order_relaxed) == allocations_at_entry_ &&
+               "heap allocation on the real-time audio thread");
+    }
+private:
+    size_t allocations_at_entry_;
+#else
+    RealtimeScope() {}
+#endif
 };
 
+} // namespace
+
+size_t AudioCapture::realtime_allocation_count() {
+#ifdef RT_STT_CHECK_RT_ALLOC
+    return g_realtime_allocations.load(std::memory_order_relaxed);
+#else
+    return 0;
+#endif
+}
+
 // Platform-specific audio callback for Core Audio
 #ifdef __APPLE__
 OSStatus CoreAudioCallback(
@@ -46,71 +203,56 @@ OSStatus CoreAudioCallback(
     AudioBufferList* ioData
 ) {
     AudioCapture* capture = static_cast<AudioCapture*>(inRefCon);
+    AudioCapture::Impl* impl = capture->impl_.get();
     
-    // Allocate buffer list for input
-    int channel_count = capture->impl_->actual_channels;
-    AudioBufferList* bufferList = (AudioBufferList*)malloc(
-        sizeof(AudioBufferList) + sizeof(AudioBuffer) * (channel_count - 1)
-    );
-    
-    bufferList->mNumberBuffers = channel_count;
-    for (UInt32 i = 0; i < bufferList->mNumberBuffers; ++i) {
-        bufferList->mBuffers[i].mNumberChannels = 1;
-        bufferList->mBuffers[i].mDataByteSize = inNumberFrames * sizeof(float);
-        bufferList->mBuffers[i].mData = malloc(bufferList->mBuffers[i].mDataByteSize);
-    }
-    
-    // Render audio from input
-    OSStatus status = AudioUnitRender(
-        capture->impl_->audio_unit,
-        ioActionFlags,
-        inTimeStamp,
-        inBusNumber,
-        inNumberFrames,
-        bufferList
-    );
-    
-    if (status == noErr) {
-        // Convert to mono if needed and process
-        std::vector<float> mono_buffer(inNumberFrames);
+    const float* mono = nullptr;
+    OSStatus status;
+    {
+        RealtimeScope rt_scope;
         
-        if (capture->get_config().force_single_channel) {
-            // Use only the specified input channel
-            UInt32 channel_idx = capture->get_config().input_channel_index;
-            if (channel_idx < bufferList->mNumberBuffers) {
-                memcpy(mono_buffer.data(), bufferList->mBuffers[channel_idx].mData, 
-                       inNumberFrames * sizeof(float));
+        AudioBufferList* buffer_list = impl->render_buffers;
+        if (!buffer_list || inNumberFrames > impl->max_frames) {
+            return kAudioUnitErr_TooManyFramesToProcess;
+        }
+        
+        // AudioUnitRender may shrink mDataByteSize, so reset it every cycle
+        for (UInt32 i = 0; i < buffer_list->mNumberBuffers; ++i) {
+            buffer_list->mBuffers[i].mDataByteSize = inNumberFrames * sizeof(float);
+        }
+        
+        // Render audio from input
+        status = AudioUnitRender(
+            impl->audio_unit,
+            ioActionFlags,
+            inTimeStamp,
+            inBusNumber,
+            inNumberFrames,
+            buffer_list
+        );
+        
+        if (status == noErr) {
+            const CaptureConfig& config = capture->config_;
+            
+            if (config.force_single_channel || buffer_list->mNumberBuffers == 1) {
+                // Use the selected input channel directly, no copy needed
+                UInt32 channel_idx = config.force_single_channel ? impl->selected_channel : 0;
+                mono = static_cast<const float*>(buffer_list->mBuffers[channel_idx].mData);
             } else {
-                // Fallback to first channel if specified channel doesn't exist
-                std::cerr << "Warning: Requested channel " << channel_idx 
-                         << " not available, using channel 0" << std::endl;
-                memcpy(mono_buffer.data(), bufferList->mBuffers[0].mData, 
-                       inNumberFrames * sizeof(float));
-            }
-        } else if (capture->get_config().channels == 1 && bufferList->mNumberBuffers == 1) {
-            // Already mono
-            memcpy(mono_buffer.data(), bufferList->mBuffers[0].mData, 
-                   inNumberFrames * sizeof(float));
-        } else {
-            // Mix all channels to mono
-            for (UInt32 frame = 0; frame < inNumberFrames; ++frame) {
-                float sum = 0.0f;
-                for (UInt32 ch = 0; ch < bufferList->mNumberBuffers; ++ch) {
-                    float* channel_data = (float*)bufferList->mBuffers[ch].mData;
-                    sum += channel_data[frame];
+                // Mix all channels to mono into the preallocated scratch buffer
+                for (UInt32 ch = 0; ch < buffer_list->mNumberBuffers; ++ch) {
+                    impl->channel_planes[ch] = static_cast<const float*>(buffer_list->mBuffers[ch].mData);
                 }
-                mono_buffer[frame] = sum / bufferList->mNumberBuffers;
+                float* out = impl->mono_buffer.data();
+                dsp::downmix_planar(impl->channel_planes.data(), buffer_list->mNumberBuffers,
+                                    inNumberFrames, out);
+                mono = out;
             }
         }
-        
-        capture->process_audio_callback(mono_buffer.data(), inNumberFrames);
     }
     
-    // Clean up
-    for (UInt32 i = 0; i < bufferList->mNumberBuffers; ++i) {
-        free(bufferList->mBuffers[i].mData);
+    if (mono) {
+        capture->process_audio_callback(mono, inNumberFrames);
     }
-    free(bufferList);
     
     return status;
 }
@@ -181,37 +323,57 @@ static AudioDeviceID FindAudioDevice(const std::string& device_name) {
     
     return kAudioDeviceUnknown;
 }
+
+static int NominalSampleRate(AudioDeviceID device_id) {
+    Float64 rate = 0.0;
+    UInt32 size = sizeof(rate);
+    AudioObjectPropertyAddress addr = {
+        kAudioDevicePropertyNominalSampleRate,
+        kAudioObjectPropertyScopeGlobal,
+        kAudioObjectPropertyElementMain
+    };
+    if (AudioObjectGetPropertyData(device_id, &addr, 0, nullptr, &size, &rate) != noErr) {
+        return 0;
+    }
+    return static_cast<int>(rate);
+}
+
+static const AudioObjectPropertyAddress kNominalRateAddress = {
+    kAudioDevicePropertyNominalSampleRate,
+    kAudioObjectPropertyScopeGlobal,
+    kAudioObjectPropertyElementMain
+};
+
+// Runs on a Core Audio notification thread, not the I/O thread
+static OSStatus DeviceRateListener(AudioObjectID, UInt32, const AudioObjectPropertyAddress*, void* client_data) {
+    static_cast<AudioCapture*>(client_data)->handle_device_rate_change();
+    return noErr;
+}
 #endif
 
 // miniaudio callback
 static void MiniaudioCallback(ma_device* device, void* output, const void* input, ma_uint32 frame_count) {
     AudioCapture* capture = static_cast<AudioCapture*>(device->pUserData);
-    if (input) {
-        const float* input_buffer = static_cast<const float*>(input);
-        
-        if (capture->get_config().force_single_channel && device->capture.channels > 1) {
-            // Extract only the specified channel
-            std::vector<float> mono_buffer(frame_count);
-            int channel_idx = capture->get_config().input_channel_index;
-            
-            // Ensure channel index is valid
-            if (channel_idx >= device->capture.channels) {
-                channel_idx = 0; // Fallback to first channel
-            }
-            
-            // Extract single channel (interleaved audio format)
-            for (ma_uint32 i = 0; i < frame_count; ++i) {
-                mono_buffer[i] = input_buffer[i * device->capture.channels + channel_idx];
-            }
-            
-            capture->process_audio_callback(mono_buffer.data(), frame_count);
-        } else {
-            // Pass through as-is (already mono or mixing all channels)
-            capture->process_audio_callback(input_buffer, frame_count);
-        }
+    if (!input) return;
+    
+    const float* input_buffer = static_cast<const float*>(input);
+    const int channels = static_cast<int>(device->capture.channels);
+    
+    if (capture->get_config().force_single_channel && channels > 1) {
+        capture->process_interleaved_callback(input_buffer, frame_count, channels);
+    } else {
+        // Pass through as-is (already mono or mixing all channels)
+        capture->process_audio_callback(input_buffer, frame_count);
     }
 }
 
+// Pull-mode ring for device_rate samples: ring_buffer_ms, and at least two
+// callbacks' worth
+static size_t ring_samples(const CaptureConfig& config, int device_rate) {
+    return (static_cast<size_t>(std::max(config.ring_buffer_ms, config.buffer_size_ms * 2)) *
+            device_rate) / 1000;
+}
+
 AudioCapture::AudioCapture() : impl_(std::make_unique<Impl>()) {}
 
 AudioCapture::~AudioCapture() {
@@ -221,6 +383,9 @@ AudioCapture::~AudioCapture() {
 bool AudioCapture::initialize(const CaptureConfig& config) {
     config_ = config;
     
+    // Size the pull-mode ring before any callback can fire
+    impl_->ring_buffer.reset(ring_samples(config_, config_.sample_rate));
+    
 #ifdef __APPLE__
     // Try Core Audio first
     if (initialize_coreaudio()) {
@@ -301,9 +466,20 @@ bool AudioCapture::initialize_coreaudio() {
         return false;
     }
     
-    // Set format
+    // Set format. With native_rate the unit delivers the device's own rate,
+    // so the HAL does no implicit conversion on the I/O thread.
+    int capture_rate = config_.sample_rate;
+    if (config_.native_rate) {
+        int native = NominalSampleRate(impl_->device_id);
+        if (native > 0) {
+            capture_rate = native;
+        } else {
+            std::cerr << "Could not query the device rate, capturing at " << capture_rate << " Hz" << std::endl;
+        }
+    }
+    
     AudioStreamBasicDescription format = {};
-    format.mSampleRate = config_.sample_rate;
+    format.mSampleRate = capture_rate;
     format.mFormatID = kAudioFormatLinearPCM;
     format.mFormatFlags = kAudioFormatFlagIsFloat | kAudioFormatFlagIsPacked;
     format.mFramesPerPacket = 1;
@@ -357,7 +533,7 @@ bool AudioCapture::initialize_coreaudio() {
     }
     
     // Set buffer size
-    UInt32 buffer_frames = (config_.buffer_size_ms * config_.sample_rate) / 1000;
+    UInt32 buffer_frames = (config_.buffer_size_ms * capture_rate) / 1000;
     status = AudioUnitSetProperty(
         impl_->audio_unit,
         kAudioDevicePropertyBufferFrameSize,
@@ -397,6 +573,29 @@ bool AudioCapture::initialize_coreaudio() {
         return false;
     }
     
+    // Validate the selected channel once, not on every callback
+    impl_->selected_channel = config_.input_channel_index;
+    if (config_.force_single_channel && 
+        (impl_->selected_channel < 0 || impl_->selected_channel >= impl_->actual_channels)) {
+        std::cerr << "Warning: Requested channel " << impl_->selected_channel 
+                 << " not available, using channel 0" << std::endl;
+        impl_->selected_channel = 0;
+    }
+    
+    // Size render buffers for the largest slice the unit may ask us to render
+    UInt32 max_frames_per_slice = 0;
+    UInt32 prop_size = sizeof(max_frames_per_slice);
+    if (AudioUnitGetProperty(impl_->audio_unit, kAudioUnitProperty_MaximumFramesPerSlice,
+                             kAudioUnitScope_Global, 0, &max_frames_per_slice, &prop_size) != noErr) {
+        max_frames_per_slice = 0;
+    }
+    impl_->allocate_render_buffers(std::max<size_t>(max_frames_per_slice, buffer_frames));
+    
+    if (config_.native_rate) {
+        configure_resampler(capture_rate);
+        AudioObjectAddPropertyListener(impl_->device_id, &kNominalRateAddress, DeviceRateListener, this);
+    }
+    
     std::cout << "Core Audio initialized successfully" << std::endl;
     return true;
 #else
@@ -415,7 +614,7 @@ bool AudioCapture::initialize_miniaudio() {
     } else {
         config.capture.channels = config_.channels;
     }
-    config.sampleRate = config_.sample_rate;
+    config.sampleRate = config_.native_rate ? 0 : config_.sample_rate;  // 0: the device's own rate
     config.dataCallback = MiniaudioCallback;
     config.pUserData = this;
     config.periodSizeInMilliseconds = config_.buffer_size_ms;
@@ -448,6 +647,25 @@ bool AudioCapture::initialize_miniaudio() {
     // Store actual channel count
     impl_->actual_channels = impl_->ma_device.capture.channels;
     
+    impl_->selected_channel = config_.input_channel_index;
+    if (impl_->selected_channel < 0 || impl_->selected_channel >= impl_->actual_channels) {
+        impl_->selected_channel = 0; // Fallback to first channel
+    }
+    
+    // Scratch buffer for channel extraction; larger periods are processed in slices
+    const int capture_rate = static_cast<int>(impl_->ma_device.sampleRate);
+    impl_->max_frames = std::max<size_t>(
+        impl_->ma_device.capture.internalPeriodSizeInFrames,
+        (static_cast<size_t>(config_.buffer_size_ms) * capture_rate) / 1000
+    );
+    impl_->mono_buffer.assign(impl_->max_frames, 0.0f);
+    
+    // miniaudio keeps this client rate across device reroutes, converting
+    // internally only if the new device runs at a different one
+    if (config_.native_rate) {
+        configure_resampler(capture_rate);
+    }
+    
     std::cout << "miniaudio initialized successfully" << std::endl;
     std::cout << "Device has " << impl_->actual_channels << " input channels" << std::endl;
     if (config_.force_single_channel) {
@@ -462,10 +680,14 @@ void AudioCapture::shutdown() {
     
 #ifdef __APPLE__
     if (impl_->audio_unit) {
+        if (config_.native_rate) {
+            AudioObjectRemovePropertyListener(impl_->device_id, &kNominalRateAddress, DeviceRateListener, this);
+        }
         AudioUnitUninitialize(impl_->audio_unit);
         AudioComponentInstanceDispose(impl_->audio_unit);
         impl_->audio_unit = nullptr;
     }
+    impl_->free_render_buffers();
 #endif
     
     if (impl_->use_miniaudio) {
@@ -474,8 +696,10 @@ void AudioCapture::shutdown() {
 }
 
 bool AudioCapture::start() {
+    std::lock_guard<std::mutex> lock(impl_->format_mutex);
     if (running_.load()) return true;
     
+    bool started = false;
 #ifdef __APPLE__
     if (impl_->audio_unit) {
         OSStatus status = AudioOutputUnitStart(impl_->audio_unit);
@@ -483,24 +707,50 @@ bool AudioCapture::start() {
             std::cerr << "Failed to start audio unit: " << status << std::endl;
             return false;
         }
-        running_ = true;
-        return true;
+        started = true;
     }
 #endif
     
-    if (impl_->use_miniaudio) {
+    if (!started && impl_->use_miniaudio) {
         if (ma_device_start(&impl_->ma_device) != MA_SUCCESS) {
             std::cerr << "Failed to start miniaudio device" << std::endl;
             return false;
         }
-        running_ = true;
-        return true;
+        started = true;
     }
     
-    return false;
+    if (!started) return false;
+    running_ = true;
+    
+    // Callback mode still gets 16 kHz frames, converted on this thread
+    if (impl_->resampling && config_.use_callback) {
+        impl_->resample_running = true;
+        impl_->resample_thread = std::thread([this] {
+            std::vector<float> frame(std::max<size_t>(
+                1, (static_cast<size_t>(config_.buffer_size_ms) * config_.sample_rate) / 1000));
+            const auto idle = std::chrono::milliseconds(std::max(1, config_.buffer_size_ms / 4));
+            while (impl_->resample_running.load()) {
+                size_t n = impl_->read_resampled(frame.data(), frame.size());
+                if (n > 0) {
+                    if (callback_) callback_(frame.data(), n);
+                } else {
+                    std::this_thread::sleep_for(idle);
+                }
+            }
+        });
+    }
+    return true;
 }
 
 void AudioCapture::stop() {
+    std::lock_guard<std::mutex> lock(impl_->format_mutex);
+    
+    // Joined even if a failed rate change already cleared running_
+    impl_->resample_running = false;
+    if (impl_->resample_thread.joinable()) {
+        impl_->resample_thread.join();
+    }
+    
     if (!running_.load()) return;
     
     running_ = false;
@@ -517,8 +767,42 @@ void AudioCapture::stop() {
 }
 
 void AudioCapture::process_audio_callback(const float* input, size_t frame_count) {
-    if (callback_ && running_.load()) {
-        callback_(input, frame_count);
+    if (!running_.load(std::memory_order_relaxed)) return;
+    
+    // The user callback runs on the audio thread here, so it is held to the
+    // same no-allocation rule as the ring write
+    RealtimeScope rt_scope;
+    
+    // Device-rate audio always goes through the ring to the resampler
+    if (config_.use_callback && !impl_->resampling) {
+        if (callback_) {
+            callback_(input, frame_count);
+        }
+        return;
+    }
+    
+    // Pull mode: the audio thread only copies into the ring
+    impl_->ring_buffer.write(input, frame_count);
+}
+
+void AudioCapture::process_interleaved_callback(const float* input, size_t frame_count, int channels) {
+    // Extract the selected channel into the preallocated scratch buffer, in
+    // slices if the backend hands us more frames than it was sized for
+    float* mono = impl_->mono_buffer.data();
+    const size_t slice_frames = impl_->max_frames;
+    if (slice_frames == 0) return;
+    
+    size_t offset = 0;
+    while (offset < frame_count) {
+        size_t n;
+        {
+            RealtimeScope rt_scope;
+            n = std::min(slice_frames, frame_count - offset);
+            dsp::extract_channel(input + offset * channels, n, channels,
+                                 impl_->selected_channel, mono);
+        }
+        process_audio_callback(mono, n);
+        offset += n;
     }
 }
 
@@ -635,13 +919,116 @@ DeviceInfo AudioCapture::get_current_device() const {
     DeviceInfo info;
     info.name = config_.device_name;
     info.max_input_channels = config_.channels;
-    info.default_sample_rate = config_.sample_rate;
+    info.default_sample_rate = get_device_sample_rate();
     return info;
 }
 
+int AudioCapture::get_device_sample_rate() const {
+    return impl_->resampling ? impl_->device_rate.load() : config_.sample_rate;
+}
+
+void AudioCapture::configure_resampler(int device_rate) {
+    impl_->resampling = true;
+    impl_->chunk_ms = std::max(1, config_.buffer_size_ms);
+    impl_->device_rate = device_rate;
+    impl_->setup_resampler(device_rate, config_.sample_rate);
+    
+    // The ring now carries device-rate samples
+    impl_->ring_buffer.reset(ring_samples(config_, device_rate));
+    
+    if (device_rate != config_.sample_rate) {
+        std::cout << "Capturing at " << device_rate << " Hz, resampling to " << config_.sample_rate
+                  << " Hz" << std::endl;
+    }
+}
+
+void AudioCapture::handle_device_rate_change() {
+#ifdef __APPLE__
+    std::lock_guard<std::mutex> lock(impl_->format_mutex);
+    if (!impl_->audio_unit || !impl_->resampling) return;
+    
+    int rate = NominalSampleRate(impl_->device_id);
+    if (rate <= 0 || rate == impl_->device_rate.load()) return;
+    std::cout << "Input device rate changed: " << impl_->device_rate.load() << " -> " << rate << " Hz" << std::endl;
+    
+    // Reformat the unit at the new rate rather than let the HAL convert
+    const bool was_running = running_.load();
+    if (was_running) {
+        AudioOutputUnitStop(impl_->audio_unit);
+    }
+    AudioUnitUninitialize(impl_->audio_unit);
+    
+    AudioStreamBasicDescription format = {};
+    UInt32 size = sizeof(format);
+    OSStatus status = AudioUnitGetProperty(impl_->audio_unit, kAudioUnitProperty_StreamFormat,
+                                           kAudioUnitScope_Output, 1, &format, &size);
+    if (status == noErr) {
+        format.mSampleRate = rate;
+        status = AudioUnitSetProperty(impl_->audio_unit, kAudioUnitProperty_StreamFormat,
+                                      kAudioUnitScope_Output, 1, &format, sizeof(format));
+    }
+    if (status == noErr) {
+        status = AudioUnitInitialize(impl_->audio_unit);
+    }
+    if (status != noErr) {
+        std::cerr << "Failed to reformat audio unit at " << rate << " Hz: " << status << std::endl;
+        running_ = false;
+        return;
+    }
+    
+    // Slices scale with the rate; the unit is stopped, so resizing is safe
+    UInt32 max_frames_per_slice = 0;
+    size = sizeof(max_frames_per_slice);
+    if (AudioUnitGetProperty(impl_->audio_unit, kAudioUnitProperty_MaximumFramesPerSlice,
+                             kAudioUnitScope_Global, 0, &max_frames_per_slice, &size) != noErr) {
+        max_frames_per_slice = 0;
+    }
+    impl_->allocate_render_buffers(std::max<size_t>(
+        max_frames_per_slice, (static_cast<size_t>(config_.buffer_size_ms) * rate) / 1000));
+    
+    // Same headroom in time at the new rate. The producer is stopped and
+    // ring_mutex keeps the consumer out; what was queued at the old rate
+    // would be dropped by the consumer anyway. It switches its resampler
+    // over on its next read.
+    {
+        std::lock_guard<std::mutex> ring_lock(impl_->ring_mutex);
+        impl_->ring_buffer.reset(ring_samples(config_, rate));
+        impl_->device_rate.store(rate, std::memory_order_release);
+    }
+    
+    if (was_running && AudioOutputUnitStart(impl_->audio_unit) != noErr) {
+        std::cerr << "Failed to restart audio unit after rate change" << std::endl;
+        running_ = false;
+    }
+#endif
+}
+
 size_t AudioCapture::read_samples(float* buffer, size_t max_samples) {
-    // Not implemented for callback-based capture
-    return 0;
+    if (impl_->resampling) {
+        return impl_->read_resampled(buffer, max_samples);
+    }
+    return impl_->ring_buffer.read(buffer, max_samples);
+}
+
+size_t AudioCapture::available_samples() const {
+    if (impl_->resampling) {
+        // Estimate in output samples
+        std::lock_guard<std::mutex> lock(impl_->ring_mutex);
+        size_t native = impl_->ring_buffer.available();
+        int rate = std::max(1, impl_->device_rate.load());
+        return (impl_->resampled_len - impl_->resampled_pos) +
+               (native * static_cast<size_t>(config_.sample_rate)) / rate;
+    }
+    return impl_->ring_buffer.available();
+}
+
+size_t AudioCapture::dropped_samples() const {
+    if (impl_->resampling) {
+        std::lock_guard<std::mutex> lock(impl_->ring_mutex);
+        int rate = std::max(1, impl_->device_rate.load());
+        return (impl_->ring_buffer.dropped_samples() * static_cast<size_t>(config_.sample_rate)) / rate;
+    }
+    return impl_->ring_buffer.dropped_samples();
 }
 
 } // namespace audio
@@ -22,10 +22,12 @@ namespace audio {
 // Audio capture configuration
 struct CaptureConfig {
     std::string device_name = "MOTU M2";  // Empty for default device
-    int sample_rate = 16000;
+    int sample_rate = 16000;          // Rate delivered to the callback / read_samples
+    bool native_rate = false;         // Capture at the device's own rate and resample to sample_rate off the audio thread
     int channels = 1;
     int buffer_size_ms = 30;
-    bool use_callback = true;
+    bool use_callback = true;         // false: pull samples with read_samples()
+    int ring_buffer_ms = 2000;        // Pull-mode buffering between audio and consumer threads
     int bit_depth = 32; // float32
     int input_channel_index = 1; // 0-based index, 0 = Input 1, 1 = Input 2, etc.
     bool force_single_channel = true; // If true, use only the specified input_channel_index
@@ -62,7 +64,9 @@ public:
     void stop();
     bool is_running() const { return running_.load(); }
     
-    // Set callback for audio data
+    // Set callback for audio data. Without resampling it is called on the
+    // real-time audio thread and must not block or allocate (asserted in
+    // RT_STT_CHECK_RT_ALLOC builds); with it, on the resampler thread.
     void set_callback(AudioCallback callback) { callback_ = callback; }
     
     // Get available devices
@@ -71,15 +75,31 @@ public:
     // Get current device info
     DeviceInfo get_current_device() const;
     
-    // Non-callback mode: pull audio data
+    // Non-callback mode: pull audio data (single consumer thread only)
     size_t read_samples(float* buffer, size_t max_samples);
+    size_t available_samples() const;
+    size_t dropped_samples() const; // Samples lost because the consumer fell behind
     
     // Get actual configuration after initialization
     CaptureConfig get_config() const { return config_; }
     
+    // Rate the device is captured at (sample_rate unless native_rate)
+    int get_device_sample_rate() const;
+    
     // Internal audio callback (needs to be public for C callback)
     void process_audio_callback(const float* input, size_t frame_count);
     
+    // Internal: selects input_channel_index from interleaved input, then
+    // forwards it to process_audio_callback. Allocation-free.
+    void process_interleaved_callback(const float* input, size_t frame_count, int channels);
+    
+    // Internal: the device's nominal rate changed (native_rate, Core Audio).
+    // Reformats the unit at the new rate; the resampler follows on read.
+    void handle_device_rate_change();
+    
+    // Heap allocations observed on the audio thread (RT_STT_CHECK_RT_ALLOC builds only)
+    static size_t realtime_allocation_count();
+    
 private:
     struct Impl;
     std::unique_ptr<Impl> impl_;
@@ -91,6 +111,7 @@ private:
     // Platform-specific initialization
     bool initialize_coreaudio();
     bool initialize_miniaudio();
+    void configure_resampler(int device_rate);
 };
 
 } // namespace audio
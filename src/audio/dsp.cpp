@@ -0,0 +1,483 @@
+#include "audio/dsp.h"
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+#if defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define RT_STT_DSP_NEON 1
+#elif defined(__AVX__)
+#include <immintrin.h>
+#define RT_STT_DSP_AVX 1
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define RT_STT_DSP_SSE 1
+#endif
+
+namespace rt_stt {
+namespace audio {
+namespace dsp {
+
+float FrameStats::rms(size_t n_samples) const {
+    return n_samples ? std::sqrt(sum_squares / n_samples) : 0.0f;
+}
+
+float FrameStats::abs_mean(size_t n_samples) const {
+    return n_samples ? abs_sum / n_samples : 0.0f;
+}
+
+#if defined(RT_STT_DSP_SSE) || defined(RT_STT_DSP_AVX)
+static inline float horizontal_sum(__m128 v) {
+    __m128 shuf = _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1));
+    __m128 sums = _mm_add_ps(v, shuf);
+    shuf = _mm_movehl_ps(shuf, sums);
+    return _mm_cvtss_f32(_mm_add_ss(sums, shuf));
+}
+
+static inline float horizontal_max(__m128 v) {
+    __m128 shuf = _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1));
+    __m128 maxs = _mm_max_ps(v, shuf);
+    shuf = _mm_movehl_ps(shuf, maxs);
+    return _mm_cvtss_f32(_mm_max_ss(maxs, shuf));
+}
+#endif
+
+FrameStats analyze(const float* samples, size_t n_samples) {
+    FrameStats stats;
+    size_t i = 0;
+
+#if defined(RT_STT_DSP_NEON)
+    float32x4_t sq = vdupq_n_f32(0.0f);
+    float32x4_t ab = vdupq_n_f32(0.0f);
+    float32x4_t pk = vdupq_n_f32(0.0f);
+    for (; i + 4 <= n_samples; i += 4) {
+        float32x4_t x = vld1q_f32(samples + i);
+        float32x4_t ax = vabsq_f32(x);
+        sq = vfmaq_f32(sq, x, x);
+        ab = vaddq_f32(ab, ax);
+        pk = vmaxq_f32(pk, ax);
+    }
+    stats.sum_squares = vaddvq_f32(sq);
+    stats.abs_sum = vaddvq_f32(ab);
+    stats.peak = vmaxvq_f32(pk);
+#elif defined(RT_STT_DSP_AVX)
+    const __m256 sign_mask = _mm256_set1_ps(-0.0f);
+    __m256 sq = _mm256_setzero_ps();
+    __m256 ab = _mm256_setzero_ps();
+    __m256 pk = _mm256_setzero_ps();
+    for (; i + 8 <= n_samples; i += 8) {
+        __m256 x = _mm256_loadu_ps(samples + i);
+        __m256 ax = _mm256_andnot_ps(sign_mask, x);
+        sq = _mm256_add_ps(sq, _mm256_mul_ps(x, x));
+        ab = _mm256_add_ps(ab, ax);
+        pk = _mm256_max_ps(pk, ax);
+    }
+    stats.sum_squares = horizontal_sum(_mm_add_ps(_mm256_castps256_ps128(sq), _mm256_extractf128_ps(sq, 1)));
+    stats.abs_sum = horizontal_sum(_mm_add_ps(_mm256_castps256_ps128(ab), _mm256_extractf128_ps(ab, 1)));
+    stats.peak = horizontal_max(_mm_max_ps(_mm256_castps256_ps128(pk), _mm256_extractf128_ps(pk, 1)));
+#elif defined(RT_STT_DSP_SSE)
+    const __m128 sign_mask = _mm_set1_ps(-0.0f);
+    __m128 sq = _mm_setzero_ps();
+    __m128 ab = _mm_setzero_ps();
+    __m128 pk = _mm_setzero_ps();
+    for (; i + 4 <= n_samples; i += 4) {
+        __m128 x = _mm_loadu_ps(samples + i);
+        __m128 ax = _mm_andnot_ps(sign_mask, x);
+        sq = _mm_add_ps(sq, _mm_mul_ps(x, x));
+        ab = _mm_add_ps(ab, ax);
+        pk = _mm_max_ps(pk, ax);
+    }
+    stats.sum_squares = horizontal_sum(sq);
+    stats.abs_sum = horizontal_sum(ab);
+    stats.peak = horizontal_max(pk);
+#endif
+
+    // Scalar tail (or the whole buffer without SIMD)
+    for (; i < n_samples; ++i) {
+        float x = samples[i];
+        float ax = std::abs(x);
+        stats.sum_squares += x * x;
+        stats.abs_sum += ax;
+        stats.peak = std::max(stats.peak, ax);
+    }
+
+    return stats;
+}
+
+float sum_squares(const float* samples, size_t n_samples) {
+    float sum = 0.0f;
+    size_t i = 0;
+
+#if defined(RT_STT_DSP_NEON)
+    float32x4_t acc0 = vdupq_n_f32(0.0f);
+    float32x4_t acc1 = vdupq_n_f32(0.0f);
+    for (; i + 8 <= n_samples; i += 8) {
+        float32x4_t a = vld1q_f32(samples + i);
+        float32x4_t b = vld1q_f32(samples + i + 4);
+        acc0 = vfmaq_f32(acc0, a, a);
+        acc1 = vfmaq_f32(acc1, b, b);
+    }
+    sum = vaddvq_f32(vaddq_f32(acc0, acc1));
+#elif defined(RT_STT_DSP_AVX)
+    __m256 acc = _mm256_setzero_ps();
+    for (; i + 8 <= n_samples; i += 8) {
+        __m256 x = _mm256_loadu_ps(samples + i);
+        acc = _mm256_add_ps(acc, _mm256_mul_ps(x, x));
+    }
+    sum = horizontal_sum(_mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1)));
+#elif defined(RT_STT_DSP_SSE)
+    __m128 acc = _mm_setzero_ps();
+    for (; i + 4 <= n_samples; i += 4) {
+        __m128 x = _mm_loadu_ps(samples + i);
+        acc = _mm_add_ps(acc, _mm_mul_ps(x, x));
+    }
+    sum = horizontal_sum(acc);
+#endif
+
+    for (; i < n_samples; ++i) {
+        sum += samples[i] * samples[i];
+    }
+    return sum;
+}
+
+void extract_channel(const float* interleaved, size_t frames, size_t channels,
+                     size_t channel, float* out) {
+    if (channels == 1) {
+        std::memcpy(out, interleaved, frames * sizeof(float));
+        return;
+    }
+
+    size_t i = 0;
+#if defined(RT_STT_DSP_NEON)
+    // Structured loads deinterleave the common stereo and quad layouts
+    if (channels == 2) {
+        for (; i + 4 <= frames; i += 4) {
+            float32x4x2_t v = vld2q_f32(interleaved + i * 2);
+            vst1q_f32(out + i, v.val[channel]);
+        }
+    } else if (channels == 4) {
+        for (; i + 4 <= frames; i += 4) {
+            float32x4x4_t v = vld4q_f32(interleaved + i * 4);
+            vst1q_f32(out + i, v.val[channel]);
+        }
+    }
+#elif defined(RT_STT_DSP_SSE) || defined(RT_STT_DSP_AVX)
+    if (channels == 2) {
+        for (; i + 4 <= frames; i += 4) {
+            __m128 a = _mm_loadu_ps(interleaved + i * 2);
+            __m128 b = _mm_loadu_ps(interleaved + i * 2 + 4);
+            __m128 v = channel == 0 ? _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0))
+                                    : _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+            _mm_storeu_ps(out + i, v);
+        }
+    }
+#endif
+
+    const float* src = interleaved + channel;
+    for (; i < frames; ++i) {
+        out[i] = src[i * channels];
+    }
+}
+
+void downmix_interleaved(const float* interleaved, size_t frames, size_t channels, float* out) {
+    if (channels == 1) {
+        std::memcpy(out, interleaved, frames * sizeof(float));
+        return;
+    }
+
+    const float scale = 1.0f / channels;
+    size_t i = 0;
+#if defined(RT_STT_DSP_NEON)
+    if (channels == 2) {
+        const float32x4_t s = vdupq_n_f32(scale);
+        for (; i + 4 <= frames; i += 4) {
+            float32x4x2_t v = vld2q_f32(interleaved + i * 2);
+            vst1q_f32(out + i, vmulq_f32(vaddq_f32(v.val[0], v.val[1]), s));
+        }
+    }
+#elif defined(RT_STT_DSP_SSE) || defined(RT_STT_DSP_AVX)
+    if (channels == 2) {
+        const __m128 s = _mm_set1_ps(scale);
+        for (; i + 4 <= frames; i += 4) {
+            __m128 a = _mm_loadu_ps(interleaved + i * 2);
+            __m128 b = _mm_loadu_ps(interleaved + i * 2 + 4);
+            __m128 left = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+            __m128 right = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+            _mm_storeu_ps(out + i, _mm_mul_ps(_mm_add_ps(left, right), s));
+        }
+    }
+#endif
+
+    for (; i < frames; ++i) {
+        const float* frame = interleaved + i * channels;
+        float sum = 0.0f;
+        for (size_t c = 0; c < channels; ++c) {
+            sum += frame[c];
+        }
+        out[i] = sum * scale;
+    }
+}
+
+// out[i] = (out[i] + src[i]) * scale
+static void accumulate(float* out, const float* src, size_t n, float scale) {
+    size_t i = 0;
+#if defined(RT_STT_DSP_NEON)
+    const float32x4_t s = vdupq_n_f32(scale);
+    for (; i + 4 <= n; i += 4) {
+        vst1q_f32(out + i, vmulq_f32(vaddq_f32(vld1q_f32(out + i), vld1q_f32(src + i)), s));
+    }
+#elif defined(RT_STT_DSP_AVX)
+    const __m256 s = _mm256_set1_ps(scale);
+    for (; i + 8 <= n; i += 8) {
+        __m256 v = _mm256_add_ps(_mm256_loadu_ps(out + i), _mm256_loadu_ps(src + i));
+        _mm256_storeu_ps(out + i, _mm256_mul_ps(v, s));
+    }
+#elif defined(RT_STT_DSP_SSE)
+    const __m128 s = _mm_set1_ps(scale);
+    for (; i + 4 <= n; i += 4) {
+        __m128 v = _mm_add_ps(_mm_loadu_ps(out + i), _mm_loadu_ps(src + i));
+        _mm_storeu_ps(out + i, _mm_mul_ps(v, s));
+    }
+#endif
+    for (; i < n; ++i) {
+        out[i] = (out[i] + src[i]) * scale;
+    }
+}
+
+void downmix_planar(const float* const* planes, size_t n_channels, size_t frames, float* out) {
+    if (n_channels == 0) return;
+
+    std::memcpy(out, planes[0], frames * sizeof(float));
+    for (size_t c = 1; c < n_channels; ++c) {
+        accumulate(out, planes[c], frames, c + 1 == n_channels ? 1.0f / n_channels : 1.0f);
+    }
+}
+
+// Sum of a[i] * b[i]
+static float dot(const float* a, const float* b, size_t n) {
+    float sum = 0.0f;
+    size_t i = 0;
+#if defined(RT_STT_DSP_NEON)
+    float32x4_t acc0 = vdupq_n_f32(0.0f);
+    float32x4_t acc1 = vdupq_n_f32(0.0f);
+    for (; i + 8 <= n; i += 8) {
+        acc0 = vfmaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+        acc1 = vfmaq_f32(acc1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+    }
+    sum = vaddvq_f32(vaddq_f32(acc0, acc1));
+#elif defined(RT_STT_DSP_AVX)
+    __m256 acc = _mm256_setzero_ps();
+    for (; i + 8 <= n; i += 8) {
+        acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+    }
+    sum = horizontal_sum(_mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1)));
+#elif defined(RT_STT_DSP_SSE)
+    __m128 acc = _mm_setzero_ps();
+    for (; i + 4 <= n; i += 4) {
+        acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+    }
+    sum = horizontal_sum(acc);
+#endif
+    for (; i < n; ++i) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+void Resampler::configure(int in_rate, int out_rate, size_t max_input, size_t taps) {
+    in_rate_ = in_rate;
+    out_rate_ = out_rate;
+    max_input_ = std::max<size_t>(max_input, 1);
+    
+    size_t a = static_cast<size_t>(in_rate), b = static_cast<size_t>(out_rate);
+    while (b != 0) {
+        size_t t = a % b;
+        a = b;
+        b = t;
+    }
+    const size_t divisor = std::max<size_t>(a, 1);
+    up_ = static_cast<size_t>(out_rate) / divisor;
+    down_ = static_cast<size_t>(in_rate) / divisor;
+    
+    coeffs_.clear();
+    history_.clear();
+    if (up_ == down_) {
+        taps_ = 0;
+        return;
+    }
+    
+    // Prototype low-pass at the upsampled rate (in_rate * L), cut off just
+    // below the lower of the two Nyquist frequencies
+    const double ratio = static_cast<double>(down_) / up_;
+    taps_ = static_cast<size_t>(std::ceil(taps * std::max(1.0, ratio)));
+    const size_t length = taps_ * up_;
+    const double cutoff = 0.5 * 0.92 / std::max(up_, down_);   // Cycles per upsampled sample
+    const double center = (length - 1) / 2.0;
+    const double pi = 3.141592653589793;
+    
+    std::vector<double> prototype(length);
+    for (size_t n = 0; n < length; ++n) {
+        const double x = n - center;
+        const double sinc = x == 0.0 ? 2.0 * cutoff : std::sin(2.0 * pi * cutoff * x) / (pi * x);
+        // Blackman window: ~-74 dB sidelobes, plenty for 16-bit-equivalent speech
+        const double w = 0.42 - 0.5 * std::cos(2.0 * pi * n / (length - 1)) +
+                         0.08 * std::cos(4.0 * pi * n / (length - 1));
+        prototype[n] = sinc * w;
+    }
+    
+    // Branch p holds h[p + k*L]; stored newest-input-first reversed so the
+    // dot product runs over history in memory order. Each branch is
+    // normalized to unity DC gain, which also folds in the factor L.
+    coeffs_.assign(up_ * taps_, 0.0f);
+    for (size_t p = 0; p < up_; ++p) {
+        double sum = 0.0;
+        for (size_t k = 0; k < taps_; ++k) {
+            sum += prototype[p + k * up_];
+        }
+        for (size_t k = 0; k < taps_; ++k) {
+            coeffs_[p * taps_ + (taps_ - 1 - k)] = static_cast<float>(prototype[p + k * up_] / sum);
+        }
+    }
+    
+    // Kept: taps_ - 1 samples of context plus the overshoot of one step
+    history_.assign(taps_ + down_ / up_ + 1 + max_input_, 0.0f);
+    reset();
+}
+
+void Resampler::reset() {
+    std::fill(history_.begin(), history_.end(), 0.0f);
+    filled_ = taps_ > 0 ? taps_ - 1 : 0;
+    base_ = filled_;
+    phase_ = 0;
+}
+
+size_t Resampler::process(const float* input, size_t n_input, float* out) {
+    if (taps_ == 0) {
+        std::memcpy(out, input, n_input * sizeof(float));
+        return n_input;
+    }
+    
+    size_t written = 0;
+    for (size_t offset = 0; offset < n_input; offset += max_input_) {
+        written += process_slice(input + offset, std::min(max_input_, n_input - offset), out + written);
+    }
+    return written;
+}
+
+size_t Resampler::process_slice(const float* input, size_t n_input, float* out) {
+    std::memcpy(history_.data() + filled_, input, n_input * sizeof(float));
+    filled_ += n_input;
+    
+    // Output n sits at upsampled time n*M, i.e. input base_ and branch phase_
+    size_t written = 0;
+    while (base_ < filled_) {
+        out[written++] = dot(coeffs_.data() + phase_ * taps_, history_.data() + base_ + 1 - taps_, taps_);
+        phase_ += down_;
+        base_ += phase_ / up_;
+        phase_ %= up_;
+    }
+    
+    // Slide the context the next output needs to the front
+    const size_t keep_from = base_ + 1 - taps_;
+    std::memmove(history_.data(), history_.data() + keep_from, (filled_ - keep_from) * sizeof(float));
+    filled_ -= keep_from;
+    base_ -= keep_from;
+    return written;
+}
+
+RealFFT::RealFFT(size_t size) {
+    if (size > 0) {
+        resize(size);
+    }
+}
+
+void RealFFT::resize(size_t size) {
+    size_ = size;
+    const size_t half = size / 2;
+    const double two_pi = 6.283185307179586;
+    
+    cos_.resize(half / 2);
+    sin_.resize(half / 2);
+    for (size_t j = 0; j < half / 2; ++j) {
+        cos_[j] = static_cast<float>(std::cos(two_pi * j / half));
+        sin_[j] = static_cast<float>(std::sin(two_pi * j / half));
+    }
+    
+    split_cos_.resize(half + 1);
+    split_sin_.resize(half + 1);
+    for (size_t k = 0; k <= half; ++k) {
+        split_cos_[k] = static_cast<float>(std::cos(two_pi * k / size));
+        split_sin_[k] = static_cast<float>(std::sin(two_pi * k / size));
+    }
+    
+    size_t bits = 0;
+    while ((size_t(1) << bits) < half) {
+        ++bits;
+    }
+    bitrev_.resize(half);
+    for (size_t i = 0; i < half; ++i) {
+        size_t r = 0;
+        for (size_t b = 0; b < bits; ++b) {
+            r |= ((i >> b) & 1) << (bits - 1 - b);
+        }
+        bitrev_[i] = r;
+    }
+    
+    re_.assign(half, 0.0f);
+    im_.assign(half, 0.0f);
+}
+
+void RealFFT::power_spectrum(const float* input, float* power) {
+    const size_t half = size_ / 2;
+    
+    // Pack even/odd samples as the real/imaginary parts of a half-size signal
+    for (size_t i = 0; i < half; ++i) {
+        size_t r = bitrev_[i];
+        re_[r] = input[2 * i];
+        im_[r] = input[2 * i + 1];
+    }
+    
+    // Iterative radix-2 complex FFT
+    for (size_t len = 2; len <= half; len <<= 1) {
+        const size_t span = len / 2;
+        const size_t step = half / len;
+        for (size_t start = 0; start < half; start += len) {
+            for (size_t j = 0; j < span; ++j) {
+                const float wr = cos_[j * step];
+                const float wi = -sin_[j * step];
+                const size_t a = start + j;
+                const size_t b = a + span;
+                const float tr = re_[b] * wr - im_[b] * wi;
+                const float ti = re_[b] * wi + im_[b] * wr;
+                re_[b] = re_[a] - tr;
+                im_[b] = im_[a] - ti;
+                re_[a] += tr;
+                im_[a] += ti;
+            }
+        }
+    }
+    
+    // Split into the spectrum of the real input:
+    // X[k] = E[k] + W^k O[k], with E/O recovered from Z[k] and conj(Z[half-k])
+    for (size_t k = 0; k <= half; ++k) {
+        const size_t k1 = k % half;
+        const size_t k2 = (half - k) % half;
+        const float a = re_[k1], b = im_[k1];
+        const float c = re_[k2], d = im_[k2];
+        
+        const float even_re = 0.5f * (a + c);
+        const float even_im = 0.5f * (b - d);
+        const float odd_re = 0.5f * (b + d);
+        const float odd_im = -0.5f * (a - c);
+        
+        const float wr = split_cos_[k];
+        const float wi = -split_sin_[k];
+        const float x_re = even_re + wr * odd_re - wi * odd_im;
+        const float x_im = even_im + wr * odd_im + wi * odd_re;
+        power[k] = x_re * x_re + x_im * x_im;
+    }
+}
+
+} // namespace dsp
+} // namespace audio
+} // namespace rt_stt
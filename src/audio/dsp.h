@@ -0,0 +1,105 @@
+#ifndef AUDIO_DSP_H
+#define AUDIO_DSP_H
+
+#include <cstddef>
+#include <vector>
+
+namespace rt_stt {
+namespace audio {
+namespace dsp {
+
+// Vectorized sample kernels shared by capture, VAD and the engine. Each has
+// a NEON path (Apple Silicon), SSE/AVX paths on x86, and a scalar fallback;
+// all are allocation-free and safe to call on the audio thread.
+
+// Everything the per-frame level checks need, gathered in one pass
+struct FrameStats {
+    float sum_squares = 0.0f;
+    float abs_sum = 0.0f;
+    float peak = 0.0f;      // max |x|
+
+    float rms(size_t n_samples) const;
+    float abs_mean(size_t n_samples) const;
+};
+
+FrameStats analyze(const float* samples, size_t n_samples);
+
+// Sum of x^2 only, for callers that just need RMS energy
+float sum_squares(const float* samples, size_t n_samples);
+
+// out[i] = interleaved[i * channels + channel]
+void extract_channel(const float* interleaved, size_t frames, size_t channels,
+                     size_t channel, float* out);
+
+// out[i] = mean over c of interleaved[i * channels + c]
+void downmix_interleaved(const float* interleaved, size_t frames, size_t channels, float* out);
+
+// out[i] = mean over c of planes[c][i] (non-interleaved, e.g. Core Audio AUHAL)
+void downmix_planar(const float* const* planes, size_t n_channels, size_t frames, float* out);
+
+// Real-input FFT of a fixed power-of-two size, computed as a half-size
+// complex FFT plus a split pass. Twiddles, bit-reversal table and work
+// buffers are built by resize(), so transforms never allocate.
+class RealFFT {
+public:
+    explicit RealFFT(size_t size = 0);
+    
+    void resize(size_t size);   // Power of two, >= 4
+    size_t size() const { return size_; }
+    size_t n_bins() const { return size_ / 2 + 1; }
+    
+    // input holds size() samples; power receives n_bins() values of |X[k]|^2
+    void power_spectrum(const float* input, float* power);
+    
+private:
+    size_t size_ = 0;
+    std::vector<float> cos_, sin_;              // Half-size complex FFT twiddles
+    std::vector<float> split_cos_, split_sin_;  // exp(-2*pi*i*k/size) for the split pass
+    std::vector<size_t> bitrev_;
+    std::vector<float> re_, im_;
+};
+
+// Streaming rational-ratio resampler, e.g. 48 kHz or 44.1 kHz capture down
+// to Whisper's 16 kHz. A windowed-sinc low-pass is split into polyphase
+// branches, so each output sample is a single vectorized dot product over
+// the recent input. configure() builds the tables and history; process()
+// never allocates. Equal rates pass samples through unchanged.
+class Resampler {
+public:
+    // taps is the filter length at 1:1; it is scaled by the decimation
+    // factor so the anti-aliasing cutoff stays as sharp when downsampling
+    void configure(int in_rate, int out_rate, size_t max_input, size_t taps = 32);
+    void reset();   // Forget history, e.g. after a gap in the input
+    
+    int in_rate() const { return in_rate_; }
+    int out_rate() const { return out_rate_; }
+    
+    // Most samples process() writes for n_input samples
+    size_t max_output(size_t n_input) const { return (n_input * up_) / down_ + 1; }
+    
+    // Consumes all n_input samples (any count; larger inputs are processed
+    // in max_input slices) and returns the number written to out, which must
+    // hold max_output(n_input)
+    size_t process(const float* input, size_t n_input, float* out);
+    
+private:
+    int in_rate_ = 0;
+    int out_rate_ = 0;
+    size_t up_ = 1;            // Interpolation factor L (out_rate / gcd)
+    size_t down_ = 1;          // Decimation factor M (in_rate / gcd)
+    size_t taps_ = 0;          // Coefficients per phase
+    size_t max_input_ = 0;
+    std::vector<float> coeffs_; // up_ phases of taps_, time-reversed for the dot product
+    std::vector<float> history_;
+    size_t filled_ = 0;         // Valid samples in history_
+    size_t base_ = 0;           // History index of the newest sample the next output needs
+    size_t phase_ = 0;          // Polyphase branch of the next output
+    
+    size_t process_slice(const float* input, size_t n_input, float* out);
+};
+
+} // namespace dsp
+} // namespace audio
+} // namespace rt_stt
+
+#endif // AUDIO_DSP_H
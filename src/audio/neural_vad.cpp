@@ -0,0 +1,122 @@
+#include "audio/neural_vad.h"
+#include "whisper.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+namespace rt_stt {
+namespace audio {
+
+// Silero scores fixed 512-sample windows at 16 kHz
+static constexpr size_t SILERO_WINDOW_SAMPLES = 512;
+
+NeuralVAD::NeuralVAD(const VADConfig& config) : VAD(config) {
+    if (config_.neural_model_path.empty()) {
+        std::cerr << "Neural VAD: no model path configured" << std::endl;
+        return;
+    }
+
+    whisper_vad_context_params ctx_params = whisper_vad_default_context_params();
+    ctx_params.n_threads = 1;
+    ctx_params.use_gpu = false;   // Tiny model; keep the GPU for the decoder
+
+    vctx_ = whisper_vad_init_from_file_with_params(config_.neural_model_path.c_str(), ctx_params);
+    if (!vctx_) {
+        std::cerr << "Neural VAD: failed to load model: " << config_.neural_model_path << std::endl;
+        return;
+    }
+
+    // Round the batch to whole Silero windows
+    size_t batch = (static_cast<size_t>(config_.neural_batch_ms) * config_.sample_rate) / 1000;
+    batch_samples_ = std::max<size_t>(1, (batch + SILERO_WINDOW_SAMPLES - 1) / SILERO_WINDOW_SAMPLES) *
+                     SILERO_WINDOW_SAMPLES;
+    size_t context = (static_cast<size_t>(config_.neural_context_ms) * config_.sample_rate) / 1000;
+    context_samples_ = (context / SILERO_WINDOW_SAMPLES) * SILERO_WINDOW_SAMPLES;
+
+    batch_.assign(context_samples_ + batch_samples_, 0.0f);
+    pending_.reset(std::max<size_t>(batch_samples_ * 8, config_.sample_rate));
+    batch_period_ = std::chrono::milliseconds(std::max(config_.neural_batch_ms, 10));
+
+    running_ = true;
+    worker_ = std::thread(&NeuralVAD::worker_loop, this);
+}
+
+NeuralVAD::~NeuralVAD() {
+    running_ = false;
+    worker_cv_.notify_all();
+    if (worker_.joinable()) {
+        worker_.join();
+    }
+
+    if (vctx_) {
+        whisper_vad_free(vctx_);
+        vctx_ = nullptr;
+    }
+}
+
+void NeuralVAD::on_frame(const float* samples, size_t n_samples) {
+    if (!running_.load()) return;
+
+    pending_.write(samples, n_samples);
+    if (pending_.available() >= batch_samples_) {
+        worker_cv_.notify_one();
+    }
+}
+
+bool NeuralVAD::is_speech_like(const float* /*samples*/, size_t /*n_samples*/) {
+    if (!vctx_) return true;
+
+    // Hysteresis as in Silero's reference: stay in speech down to threshold - 0.15
+    State state = get_state();
+    bool in_speech = state == State::SPEECH || state == State::SPEECH_ENDING;
+    float threshold = in_speech
+        ? std::max(config_.neural_threshold - 0.15f, 0.01f)
+        : config_.neural_threshold;
+
+    return get_speech_probability() >= threshold;
+}
+
+void NeuralVAD::worker_loop() {
+    // Wake on a full batch, or at least once per batch period in case a
+    // notification raced the wait
+    const auto batch_period = batch_period_;
+
+    while (running_.load()) {
+        {
+            std::unique_lock<std::mutex> lock(worker_mutex_);
+            worker_cv_.wait_for(lock, batch_period, [this] {
+                return !running_.load() || pending_.available() >= batch_samples_;
+            });
+        }
+
+        while (running_.load() && pending_.available() >= batch_samples_) {
+            score_batch();
+        }
+    }
+}
+
+void NeuralVAD::score_batch() {
+    pending_.read(batch_.data() + context_samples_, batch_samples_);
+
+    if (whisper_vad_detect_speech(vctx_, batch_.data(), static_cast<int>(batch_.size()))) {
+        // Only the windows covering the new audio decide; the context is warm-up
+        int n_probs = whisper_vad_n_probs(vctx_);
+        const float* probs = whisper_vad_probs(vctx_);
+        int first = static_cast<int>(context_samples_ / SILERO_WINDOW_SAMPLES);
+
+        float prob = 0.0f;
+        for (int i = std::min(first, n_probs); i < n_probs; ++i) {
+            prob = std::max(prob, probs[i]);
+        }
+        speech_prob_.store(prob, std::memory_order_relaxed);
+    }
+
+    // Slide the tail of this batch into the context slot
+    if (context_samples_ > 0) {
+        std::memmove(batch_.data(), batch_.data() + batch_samples_, context_samples_ * sizeof(float));
+    }
+}
+
+} // namespace audio
+} // namespace rt_stt
@@ -0,0 +1,61 @@
+#ifndef AUDIO_NEURAL_VAD_H
+#define AUDIO_NEURAL_VAD_H
+
+#include "audio/vad.h"
+#include "audio/ring_buffer.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct whisper_vad_context;
+
+namespace rt_stt {
+namespace audio {
+
+// Silero VAD through whisper.cpp's VAD API. Frames are copied into a ring
+// and scored in batches on a worker thread; the state machine reads the
+// latest speech probability, so process() never waits on inference.
+class NeuralVAD : public VAD {
+public:
+    NeuralVAD(const VADConfig& config = VADConfig());
+    ~NeuralVAD() override;
+
+    // False if the model could not be loaded (create_vad then falls back)
+    bool is_loaded() const { return vctx_ != nullptr; }
+
+    // Speech probability of the most recently scored batch
+    float get_speech_probability() const { return speech_prob_.load(std::memory_order_relaxed); }
+
+protected:
+    void on_frame(const float* samples, size_t n_samples) override;
+    bool is_speech_like(const float* samples, size_t n_samples) override;
+
+private:
+    whisper_vad_context* vctx_ = nullptr;
+
+    // Frames waiting to be scored (producer: process(), consumer: worker)
+    SPSCRingBuffer pending_;
+    std::mutex worker_mutex_;
+    std::condition_variable worker_cv_;
+    std::thread worker_;
+    std::atomic<bool> running_{false};
+    std::atomic<float> speech_prob_{0.0f};
+
+    // [context | new batch]; the context carries the tail of the previous
+    // batch so the model's recurrent state has audio to warm up on
+    std::vector<float> batch_;
+    size_t batch_samples_ = 0;
+    size_t context_samples_ = 0;
+    std::chrono::milliseconds batch_period_{10};   // Fixed at construction; config_ may change later
+
+    void worker_loop();
+    void score_batch();
+};
+
+} // namespace audio
+} // namespace rt_stt
+
+#endif // AUDIO_NEURAL_VAD_H
@@ -0,0 +1,82 @@
+#include "audio/ring_buffer.h"
+#include <algorithm>
+#include <cstring>
+
+namespace rt_stt {
+namespace audio {
+
+static size_t next_power_of_two(size_t n) {
+    size_t capacity = 1;
+    while (capacity < n) {
+        capacity <<= 1;
+    }
+    return capacity;
+}
+
+SPSCRingBuffer::SPSCRingBuffer(size_t min_capacity) {
+    if (min_capacity > 0) {
+        reset(min_capacity);
+    }
+}
+
+void SPSCRingBuffer::reset(size_t min_capacity) {
+    buffer_.assign(next_power_of_two(std::max<size_t>(min_capacity, 2)), 0.0f);
+    mask_ = buffer_.size() - 1;
+    write_pos_.store(0, std::memory_order_relaxed);
+    read_pos_.store(0, std::memory_order_relaxed);
+    dropped_.store(0, std::memory_order_relaxed);
+}
+
+size_t SPSCRingBuffer::write(const float* samples, size_t n_samples) {
+    if (buffer_.empty()) return 0;
+    
+    const size_t write_pos = write_pos_.load(std::memory_order_relaxed);
+    const size_t read_pos = read_pos_.load(std::memory_order_acquire);
+    const size_t free_space = buffer_.size() - (write_pos - read_pos);
+    
+    const size_t n = std::min(n_samples, free_space);
+    if (n < n_samples) {
+        dropped_.fetch_add(n_samples - n, std::memory_order_relaxed);
+    }
+    if (n == 0) return 0;
+    
+    // Copy in at most two spans
+    const size_t start = write_pos & mask_;
+    const size_t first = std::min(n, buffer_.size() - start);
+    std::memcpy(buffer_.data() + start, samples, first * sizeof(float));
+    if (n > first) {
+        std::memcpy(buffer_.data(), samples + first, (n - first) * sizeof(float));
+    }
+    
+    write_pos_.store(write_pos + n, std::memory_order_release);
+    return n;
+}
+
+size_t SPSCRingBuffer::read(float* out, size_t max_samples) {
+    if (buffer_.empty()) return 0;
+    
+    const size_t read_pos = read_pos_.load(std::memory_order_relaxed);
+    const size_t write_pos = write_pos_.load(std::memory_order_acquire);
+    
+    const size_t n = std::min(max_samples, write_pos - read_pos);
+    if (n == 0) return 0;
+    
+    const size_t start = read_pos & mask_;
+    const size_t first = std::min(n, buffer_.size() - start);
+    std::memcpy(out, buffer_.data() + start, first * sizeof(float));
+    if (n > first) {
+        std::memcpy(out + first, buffer_.data(), (n - first) * sizeof(float));
+    }
+    
+    read_pos_.store(read_pos + n, std::memory_order_release);
+    return n;
+}
+
+size_t SPSCRingBuffer::available() const {
+    const size_t write_pos = write_pos_.load(std::memory_order_acquire);
+    const size_t read_pos = read_pos_.load(std::memory_order_acquire);
+    return write_pos - read_pos;
+}
+
+} // namespace audio
+} // namespace rt_stt
@@ -0,0 +1,50 @@
+#ifndef AUDIO_RING_BUFFER_H
+#define AUDIO_RING_BUFFER_H
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace rt_stt {
+namespace audio {
+
+// Lock-free single-producer/single-consumer ring buffer for float samples.
+// The producer (audio thread) only ever calls write(), the consumer only
+// read()/available(). Capacity is rounded up to a power of two so indices
+// wrap with a mask, and the two indices live on separate cache lines.
+class SPSCRingBuffer {
+public:
+    explicit SPSCRingBuffer(size_t min_capacity = 0);
+    
+    // Resize and clear. Not thread-safe: call before producer/consumer start.
+    void reset(size_t min_capacity);
+    
+    // Producer side. Writes as many samples as fit and returns that count;
+    // samples that don't fit are dropped and counted in dropped_samples().
+    size_t write(const float* samples, size_t n_samples);
+    
+    // Consumer side. Returns the number of samples copied into out.
+    size_t read(float* out, size_t max_samples);
+    
+    // Samples ready to be read (exact for the consumer, a lower bound otherwise)
+    size_t available() const;
+    
+    size_t capacity() const { return buffer_.size(); }
+    size_t dropped_samples() const { return dropped_.load(std::memory_order_relaxed); }
+    
+private:
+    static constexpr size_t CACHE_LINE_SIZE = 64;
+    
+    std::vector<float> buffer_;
+    size_t mask_ = 0;
+    
+    // Monotonic positions; the slot index is position & mask_
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> write_pos_{0};
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> read_pos_{0};
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> dropped_{0};
+};
+
+} // namespace audio
+} // namespace rt_stt
+
+#endif // AUDIO_RING_BUFFER_H
@@ -1,7 +1,11 @@
 #include "audio/vad.h"
+#include "audio/dsp.h"
+#include "audio/neural_vad.h"
 #include <cmath>
 #include <algorithm>
 #include <numeric>
+#include <cstring>
+#include <iostream>
 
 namespace rt_stt {
 namespace audio {
@@ -9,21 +13,29 @@ namespace audio {
 VAD::VAD(const VADConfig& config)
     : config_(config)
     , state_(State::SILENCE)
+    , buffer_write_pos_(0)
+    , buffer_fill_(0)
     , current_energy_(0.0f)
     , noise_floor_(config.energy_threshold)
     , speech_frames_(0)
-    , silence_frames_(0)
-    , energy_history_idx_(0) {
+    , silence_frames_(0) {
     
     // Calculate frame counts
     frames_per_ms_ = config_.sample_rate / 1000;
     
     // Initialize buffers
     buffer_max_samples_ = (config_.pre_speech_buffer_ms * config_.sample_rate) / 1000;
-    energy_history_.resize(100, config_.energy_threshold);
+    audio_buffer_.assign(buffer_max_samples_, 0.0f);
+    energy_history_.reset(config_.noise_floor_history_frames, config_.energy_threshold);
 }
 
 VAD::State VAD::process(const float* samples, size_t n_samples) {
+    if (config_pending_.load(std::memory_order_acquire)) {
+        apply_pending_config();
+    }
+    
+    on_frame(samples, n_samples);
+    
     // Calculate frame energy
     current_energy_ = calculate_energy(samples, n_samples);
     
@@ -52,12 +64,18 @@ VAD::State VAD::process(const float* samples, size_t n_samples) {
         ? noise_floor_ * config_.speech_end_threshold
         : config_.speech_end_threshold;
     
+    // Frames too quiet to cross either threshold skip the extra analysis
+    bool speech_like = current_energy_ >= std::min(speech_threshold, silence_threshold) &&
+                       is_speech_like(samples, n_samples);
+    bool above_start = current_energy_ > speech_threshold && speech_like;
+    bool below_end = current_energy_ < silence_threshold || !speech_like;
+    
     // State machine
     State old_state = state_;
     
     switch (state_) {
         case State::SILENCE:
-            if (current_energy_ > speech_threshold) {
+            if (above_start) {
                 change_state(State::SPEECH_MAYBE);
                 speech_frames_ = n_samples;
                 silence_frames_ = 0;
@@ -65,7 +83,7 @@ VAD::State VAD::process(const float* samples, size_t n_samples) {
             break;
             
         case State::SPEECH_MAYBE:
-            if (current_energy_ > speech_threshold) {
+            if (above_start) {
                 speech_frames_ += n_samples;
                 if (speech_frames_ >= config_.speech_start_ms * frames_per_ms_) {
                     change_state(State::SPEECH);
@@ -78,7 +96,7 @@ VAD::State VAD::process(const float* samples, size_t n_samples) {
             break;
             
         case State::SPEECH:
-            if (current_energy_ < silence_threshold) {
+            if (below_end) {
                 change_state(State::SPEECH_ENDING);
                 silence_frames_ = n_samples;
             } else {
@@ -87,7 +105,7 @@ VAD::State VAD::process(const float* samples, size_t n_samples) {
             break;
             
         case State::SPEECH_ENDING:
-            if (current_energy_ < silence_threshold) {
+            if (below_end) {
                 silence_frames_ += n_samples;
                 if (silence_frames_ >= config_.speech_end_ms * frames_per_ms_) {
                     // Check if speech was long enough
@@ -115,26 +133,13 @@ float VAD::calculate_energy(const float* samples, size_t n_samples) {
     if (n_samples == 0) return 0.0f;
     
     // Calculate RMS energy
-    float sum_squares = 0.0f;
-    for (size_t i = 0; i < n_samples; ++i) {
-        sum_squares += samples[i] * samples[i];
-    }
-    
-    return std::sqrt(sum_squares / n_samples);
+    return std::sqrt(dsp::sum_squares(samples, n_samples) / n_samples);
 }
 
 void VAD::update_noise_floor(float energy) {
-    // Adaptive noise floor estimation
-    energy_history_[energy_history_idx_] = energy;
-    energy_history_idx_ = (energy_history_idx_ + 1) % energy_history_.size();
-    
-    // Use percentile method for noise floor
-    std::vector<float> sorted_history = energy_history_;
-    std::sort(sorted_history.begin(), sorted_history.end());
-    
-    // Use 20th percentile as noise floor
-    size_t percentile_idx = sorted_history.size() / 5;
-    float new_noise_floor = sorted_history[percentile_idx];
+    // Adaptive noise floor estimation: percentile of recent silent frames
+    energy_history_.push(energy);
+    float new_noise_floor = energy_history_.get(config_.noise_floor_percentile);
     
     // Smooth adaptation
     noise_floor_ = noise_floor_ * (1.0f - config_.noise_floor_adaptation_rate) +
@@ -156,31 +161,88 @@ void VAD::change_state(State new_state) {
 }
 
 void VAD::update_buffer(const float* samples, size_t n_samples) {
-    // Add new samples to buffer
-    for (size_t i = 0; i < n_samples; ++i) {
-        audio_buffer_.push_back(samples[i]);
-    }
+    const size_t capacity = buffer_max_samples_;
+    if (capacity == 0 || n_samples == 0) return;
     
-    // Keep buffer size limited
-    while (audio_buffer_.size() > buffer_max_samples_) {
-        audio_buffer_.pop_front();
+    // Only the newest `capacity` samples can survive
+    if (n_samples >= capacity) {
+        std::memcpy(audio_buffer_.data(), samples + (n_samples - capacity), capacity * sizeof(float));
+        buffer_write_pos_ = 0;
+        buffer_fill_ = capacity;
+        return;
     }
+    
+    // At most two copies: up to the end of the ring, then wrapped to the front
+    size_t first = std::min(n_samples, capacity - buffer_write_pos_);
+    std::memcpy(audio_buffer_.data() + buffer_write_pos_, samples, first * sizeof(float));
+    std::memcpy(audio_buffer_.data(), samples + first, (n_samples - first) * sizeof(float));
+    
+    buffer_write_pos_ = (buffer_write_pos_ + n_samples) % capacity;
+    buffer_fill_ = std::min(buffer_fill_ + n_samples, capacity);
+}
+
+VAD::BufferedAudio VAD::get_buffered_spans() const {
+    BufferedAudio spans;
+    if (buffer_fill_ == 0) return spans;
+    
+    const size_t capacity = buffer_max_samples_;
+    size_t start = (buffer_write_pos_ + capacity - buffer_fill_) % capacity;
+    
+    spans.first = audio_buffer_.data() + start;
+    spans.first_size = std::min(buffer_fill_, capacity - start);
+    spans.second = audio_buffer_.data();
+    spans.second_size = buffer_fill_ - spans.first_size;
+    return spans;
 }
 
 std::vector<float> VAD::get_buffered_audio() const {
-    return std::vector<float>(audio_buffer_.begin(), audio_buffer_.end());
+    std::vector<float> audio;
+    append_buffered_audio(audio);
+    return audio;
+}
+
+void VAD::append_buffered_audio(std::vector<float>& out, size_t exclude_recent) const {
+    BufferedAudio spans = get_buffered_spans();
+    if (exclude_recent >= spans.size()) return;
+    
+    size_t remaining = spans.size() - exclude_recent;
+    size_t from_first = std::min(remaining, spans.first_size);
+    out.insert(out.end(), spans.first, spans.first + from_first);
+    out.insert(out.end(), spans.second, spans.second + (remaining - from_first));
 }
 
 void VAD::update_config(const VADConfig& config) {
-    config_ = config;
-    frames_per_ms_ = config_.sample_rate / 1000;
-    buffer_max_samples_ = (config_.pre_speech_buffer_ms * config_.sample_rate) / 1000;
+    std::atomic_store(&pending_config_, std::make_shared<const VADConfig>(config));
+    config_pending_.store(true, std::memory_order_release);
+}
+
+void VAD::apply_pending_config() {
+    // Clear the flag first: a config published after the exchange below
+    // sets it again and is picked up on the next frame
+    config_pending_.store(false, std::memory_order_relaxed);
+    std::shared_ptr<const VADConfig> next = std::atomic_exchange(&pending_config_, std::shared_ptr<const VADConfig>());
+    if (!next) return;
     
-    // Reset adaptive parameters
-    if (config_.use_adaptive_threshold) {
+    const VADConfig previous = config_;
+    config_ = *next;
+    config_.sample_rate = previous.sample_rate;   // Buffers and frame timing are sized for it
+    
+    // Keep the pre-speech audio unless its length changed
+    if (config_.pre_speech_buffer_ms != previous.pre_speech_buffer_ms) {
+        buffer_max_samples_ = (config_.pre_speech_buffer_ms * config_.sample_rate) / 1000;
+        audio_buffer_.assign(buffer_max_samples_, 0.0f);
+        buffer_write_pos_ = 0;
+        buffer_fill_ = 0;
+    }
+    
+    // Restart the noise floor estimate only when its inputs changed, so
+    // re-applying unrelated settings does not make the VAD relearn the room
+    if (config_.use_adaptive_threshold &&
+        (!previous.use_adaptive_threshold ||
+         config_.energy_threshold != previous.energy_threshold ||
+         config_.noise_floor_history_frames != previous.noise_floor_history_frames)) {
         noise_floor_ = config_.energy_threshold;
-        energy_history_.assign(100, config_.energy_threshold);
-        energy_history_idx_ = 0;
+        energy_history_.reset(config_.noise_floor_history_frames, config_.energy_threshold);
     }
 }
 
@@ -188,27 +250,109 @@ void VAD::reset() {
     state_ = State::SILENCE;
     speech_frames_ = 0;
     silence_frames_ = 0;
-    audio_buffer_.clear();
+    buffer_write_pos_ = 0;
+    buffer_fill_ = 0;
     current_energy_ = 0.0f;
     
     if (config_.use_adaptive_threshold) {
         noise_floor_ = config_.energy_threshold;
-        energy_history_.assign(energy_history_.size(), config_.energy_threshold);
-        energy_history_idx_ = 0;
+        energy_history_.reset(config_.noise_floor_history_frames, config_.energy_threshold);
     }
 }
 
-// SpectralVAD implementation (stub for now)
+// WindowedPercentile implementation
+void WindowedPercentile::reset(size_t window, float fill_value) {
+    window = std::max<size_t>(window, 1);
+    history_.assign(window, fill_value);
+    sorted_.assign(window, fill_value);
+    next_ = 0;
+}
+
+void WindowedPercentile::push(float value) {
+    if (history_.empty()) return;
+    
+    float oldest = history_[next_];
+    history_[next_] = value;
+    next_ = (next_ + 1) % history_.size();
+    
+    // Replace the evicted value in sorted_, sliding what lies between the
+    // two positions by one slot
+    size_t old_idx = std::lower_bound(sorted_.begin(), sorted_.end(), oldest) - sorted_.begin();
+    size_t new_idx = std::lower_bound(sorted_.begin(), sorted_.end(), value) - sorted_.begin();
+    
+    if (new_idx > old_idx) {
+        std::move(sorted_.begin() + old_idx + 1, sorted_.begin() + new_idx, sorted_.begin() + old_idx);
+        sorted_[new_idx - 1] = value;
+    } else {
+        std::move_backward(sorted_.begin() + new_idx, sorted_.begin() + old_idx, sorted_.begin() + old_idx + 1);
+        sorted_[new_idx] = value;
+    }
+}
+
+float WindowedPercentile::get(float percentile) const {
+    if (sorted_.empty()) return 0.0f;
+    
+    percentile = std::min(std::max(percentile, 0.0f), 1.0f);
+    size_t idx = std::min(sorted_.size() - 1, static_cast<size_t>(percentile * sorted_.size()));
+    return sorted_[idx];
+}
+
+// SpectralVAD implementation
 SpectralVAD::SpectralVAD(const VADConfig& config) : VAD(config) {
-    // Initialize FFT buffers
-    fft_buffer_.resize(1024);
-    spectral_features_.resize(4); // Flatness, entropy, centroid, rolloff
+    spectral_features_.assign(N_FEATURES, 0.0f);
 }
 
-VAD::State SpectralVAD::process(const float* samples, size_t n_samples) {
-    // For now, fall back to energy-based VAD
-    // TODO: Implement spectral analysis
-    return VAD::process(samples, n_samples);
+void SpectralVAD::prepare(size_t n_samples) {
+    // Frame length only changes with the capture buffer size, so this runs once
+    frame_samples_ = n_samples;
+    
+    size_t fft_size = 4;
+    while (fft_size < n_samples) {
+        fft_size <<= 1;
+    }
+    fft_.resize(fft_size);
+    
+    // Hann window over the frame; the zero padding needs none
+    window_.resize(n_samples);
+    for (size_t i = 0; i < n_samples; ++i) {
+        window_[i] = 0.5f - 0.5f * std::cos(6.283185307f * i / std::max<size_t>(n_samples - 1, 1));
+    }
+    fft_buffer_.assign(fft_size, 0.0f);
+    power_.assign(fft_.n_bins(), 0.0f);
+}
+
+bool SpectralVAD::is_speech_like(const float* samples, size_t n_samples) {
+    if (n_samples < 4) return true;
+    if (n_samples != frame_samples_) {
+        prepare(n_samples);
+    }
+    
+    for (size_t i = 0; i < n_samples; ++i) {
+        fft_buffer_[i] = samples[i] * window_[i];
+    }
+    fft_.power_spectrum(fft_buffer_.data(), power_.data());
+    
+    // Skip the DC bin; it carries offset, not content
+    const float* spectrum = power_.data() + 1;
+    const size_t n_bins = power_.size() - 1;
+    const float bin_hz = static_cast<float>(config_.sample_rate) / fft_.size();
+    
+    float flatness = calculate_spectral_flatness(spectrum, n_bins);
+    float entropy = calculate_spectral_entropy(spectrum, n_bins) / std::log2(static_cast<float>(n_bins));
+    // Bin i of spectrum is FFT bin i + 1
+    float centroid = calculate_spectral_centroid(spectrum, n_bins, bin_hz) + bin_hz;
+    float rolloff = calculate_spectral_rolloff(spectrum, n_bins, bin_hz, 0.85f) + bin_hz;
+    
+    spectral_features_[FLATNESS] = flatness;
+    spectral_features_[ENTROPY] = entropy;
+    spectral_features_[CENTROID_HZ] = centroid;
+    spectral_features_[ROLLOFF_HZ] = rolloff;
+    
+    return flatness <= config_.spectral_flatness_max &&
+           entropy <= config_.spectral_entropy_max &&
+           centroid >= config_.spectral_centroid_min_hz &&
+           centroid <= config_.spectral_centroid_max_hz &&
+           rolloff <= config_.spectral_rolloff_max_hz;
 }
 
 float SpectralVAD::calculate_spectral_flatness(const float* spectrum, size_t n_bins) {
@@ -249,5 +393,54 @@ float SpectralVAD::calculate_spectral_entropy(const float* spectrum, size_t n_bi
     return entropy;
 }
 
+float SpectralVAD::calculate_spectral_centroid(const float* spectrum, size_t n_bins, float bin_hz) {
+    // Power-weighted mean frequency
+    float weighted = 0.0f;
+    float sum = 0.0f;
+    for (size_t i = 0; i < n_bins; ++i) {
+        weighted += i * spectrum[i];
+        sum += spectrum[i];
+    }
+    
+    if (sum < 1e-10f) return 0.0f;
+    return (weighted / sum) * bin_hz;
+}
+
+float SpectralVAD::calculate_spectral_rolloff(const float* spectrum, size_t n_bins, float bin_hz, float fraction) {
+    float total = 0.0f;
+    for (size_t i = 0; i < n_bins; ++i) {
+        total += spectrum[i];
+    }
+    
+    // First bin at which the cumulative power reaches the fraction
+    float target = total * fraction;
+    float cumulative = 0.0f;
+    for (size_t i = 0; i < n_bins; ++i) {
+        cumulative += spectrum[i];
+        if (cumulative >= target) {
+            return i * bin_hz;
+        }
+    }
+    return (n_bins - 1) * bin_hz;
+}
+
+std::unique_ptr<VAD> create_vad(const VADConfig& config) {
+    switch (config.type) {
+        case VADConfig::Type::SPECTRAL:
+            return std::make_unique<SpectralVAD>(config);
+        case VADConfig::Type::NEURAL: {
+            auto vad = std::make_unique<NeuralVAD>(config);
+            if (vad->is_loaded()) {
+                return vad;
+            }
+            std::cerr << "Neural VAD unavailable, falling back to energy VAD" << std::endl;
+            return std::make_unique<VAD>(config);
+        }
+        case VADConfig::Type::ENERGY:
+        default:
+            return std::make_unique<VAD>(config);
+    }
+}
+
 } // namespace audio
 } // namespace rt_stt
@@ -1,16 +1,26 @@
 #ifndef VAD_H
 #define VAD_H
 
+#include "audio/dsp.h"
 #include <vector>
-#include <deque>
+#include <atomic>
 #include <cstddef>
 #include <functional>
+#include <memory>
+#include <string>
 
 namespace rt_stt {
 namespace audio {
 
 // VAD configuration
 struct VADConfig {
+    enum class Type {
+        ENERGY,    // RMS energy against an adaptive noise floor
+        SPECTRAL,  // Energy, plus the frame's spectrum must look like voice
+        NEURAL     // Energy, plus a Silero speech probability (whisper.cpp VAD model)
+    };
+    Type type = Type::ENERGY;
+    
     // Energy-based VAD parameters
     float energy_threshold = 0.01f;
     float speech_start_threshold = 0.02f;
@@ -25,7 +35,41 @@ struct VADConfig {
     // Advanced parameters
     bool use_adaptive_threshold = true;
     float noise_floor_adaptation_rate = 0.001f;
+    int noise_floor_history_frames = 100;   // Silent frames the noise floor is estimated over
+    float noise_floor_percentile = 0.2f;    // Percentile of that history taken as the floor
     int sample_rate = 16000;
+    
+    // Spectral VAD (type == SPECTRAL): voiced speech is harmonic, so it is far
+    // less flat than HVAC/fan noise or keyboard clicks, and its energy sits
+    // in the voice band rather than below it or spread up to Nyquist
+    float spectral_flatness_max = 0.30f;        // 0 = pure tone, 1 = white noise
+    float spectral_entropy_max = 0.90f;         // Normalized to 0..1
+    float spectral_centroid_min_hz = 300.0f;
+    float spectral_centroid_max_hz = 3500.0f;
+    float spectral_rolloff_max_hz = 5000.0f;    // Frequency below which 85% of power lies
+    
+    // Neural VAD (type == NEURAL). Scoring runs on its own thread, so the
+    // decision trails the audio by up to one batch.
+    std::string neural_model_path = "models/ggml-silero-v5.1.2.bin";
+    float neural_threshold = 0.5f;   // Speech probability needed to start speech
+    int neural_batch_ms = 96;        // Audio scored per inference call
+    int neural_context_ms = 192;     // Preceding audio re-fed to warm up the model
+};
+
+// Exact percentile over the last N values. Each push keeps a sorted copy of
+// the window up to date with two binary searches and one bounded move, so
+// nothing is sorted or allocated after reset().
+class WindowedPercentile {
+public:
+    void reset(size_t window, float fill_value);
+    void push(float value);
+    float get(float percentile) const;
+    size_t window() const { return history_.size(); }
+    
+private:
+    std::vector<float> history_;  // Arrival order (ring)
+    std::vector<float> sorted_;   // Same values, ascending
+    size_t next_ = 0;
 };
 
 // Simple energy-based VAD with adaptive threshold
@@ -40,8 +84,18 @@ public:
     
     using StateCallback = std::function<void(State old_state, State new_state)>;
     
+    // Pre-speech audio as it sits in the ring, oldest first: first then second
+    struct BufferedAudio {
+        const float* first = nullptr;
+        size_t first_size = 0;
+        const float* second = nullptr;
+        size_t second_size = 0;
+        
+        size_t size() const { return first_size + second_size; }
+    };
+    
     VAD(const VADConfig& config = VADConfig());
-    ~VAD() = default;
+    virtual ~VAD() = default;
     
     // Process audio samples and return current state
     State process(const float* samples, size_t n_samples);
@@ -52,9 +106,18 @@ public:
     // Get buffered audio (useful for pre-speech buffer)
     std::vector<float> get_buffered_audio() const;
     
-    // Configuration
+    // Zero-copy view of the buffered audio; valid until the next process()
+    BufferedAudio get_buffered_spans() const;
+    
+    // Append buffered audio to out, leaving off the newest exclude_recent
+    // samples; allocation-free when out has the capacity
+    void append_buffered_audio(std::vector<float>& out, size_t exclude_recent = 0) const;
+    
+    // Configuration. update_config may be called from any thread: it only
+    // publishes the new settings, and the thread calling process() takes
+    // them up before its next frame. The sample rate cannot change this way.
     void update_config(const VADConfig& config);
-    VADConfig get_config() const { return config_; }
+    const VADConfig& get_config() const { return config_; }  // As applied; process() thread only
     
     // State change callback
     void set_state_callback(StateCallback callback) { state_callback_ = callback; }
@@ -66,20 +129,36 @@ public:
     float get_current_energy() const { return current_energy_; }
     float get_noise_floor() const { return noise_floor_; }
     
-private:
+protected:
+    // Sees every frame before any decision, e.g. to queue it for analysis
+    virtual void on_frame(const float* /*samples*/, size_t /*n_samples*/) {}
+    
+    // Extra per-frame check on top of the energy thresholds; only consulted
+    // for frames loud enough to matter. The energy VAD accepts everything.
+    virtual bool is_speech_like(const float* /*samples*/, size_t /*n_samples*/) { return true; }
+    
     VADConfig config_;
+    
+private:
+    // Settings published by update_config, not yet applied. The flag keeps
+    // the per-frame check to a single atomic load.
+    std::shared_ptr<const VADConfig> pending_config_;
+    std::atomic<bool> config_pending_{false};
+    
     State state_;
     StateCallback state_callback_;
     
-    // Audio buffer for pre-speech
-    std::deque<float> audio_buffer_;
+    // Audio buffer for pre-speech: fixed-capacity ring of the newest
+    // buffer_max_samples_ samples
+    std::vector<float> audio_buffer_;
     size_t buffer_max_samples_;
+    size_t buffer_write_pos_;
+    size_t buffer_fill_;
     
     // Energy tracking
     float current_energy_;
     float noise_floor_;
-    std::vector<float> energy_history_;
-    size_t energy_history_idx_;
+    WindowedPercentile energy_history_;
     
     // State timing
     size_t speech_frames_;
@@ -91,25 +170,42 @@ private:
     void update_noise_floor(float energy);
     void change_state(State new_state);
     void update_buffer(const float* samples, size_t n_samples);
+    void apply_pending_config();
 };
 
-// Advanced VAD using spectral features (optional, for future enhancement)
+// VAD that also requires a voice-like spectrum, so steady or broadband noise
+// loud enough to pass the energy threshold does not open an utterance
 class SpectralVAD : public VAD {
 public:
+    enum Feature { FLATNESS = 0, ENTROPY, CENTROID_HZ, ROLLOFF_HZ, N_FEATURES };
+    
     SpectralVAD(const VADConfig& config = VADConfig());
     
-    // Override with spectral analysis
-    State process(const float* samples, size_t n_samples);
+    // Features of the last analyzed frame, indexed by Feature
+    const std::vector<float>& get_spectral_features() const { return spectral_features_; }
+    
+protected:
+    bool is_speech_like(const float* samples, size_t n_samples) override;
     
 private:
-    // FFT and spectral analysis members
+    // FFT and spectral analysis members, sized for the current frame length
+    dsp::RealFFT fft_;
+    std::vector<float> window_;
     std::vector<float> fft_buffer_;
+    std::vector<float> power_;
     std::vector<float> spectral_features_;
+    size_t frame_samples_ = 0;
     
+    void prepare(size_t n_samples);
     float calculate_spectral_flatness(const float* spectrum, size_t n_bins);
     float calculate_spectral_entropy(const float* spectrum, size_t n_bins);
+    float calculate_spectral_centroid(const float* spectrum, size_t n_bins, float bin_hz);
+    float calculate_spectral_rolloff(const float* spectrum, size_t n_bins, float bin_hz, float fraction);
 };
 
+// Build the VAD selected by config.type
+std::unique_ptr<VAD> create_vad(const VADConfig& config);
+
 } // namespace audio
 } // namespace rt_stt
 
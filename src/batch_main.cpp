@@ -0,0 +1,381 @@
+#include "stt/whisper_wrapper.h"
+#include "audio/vad.h"
+#include "utils/tool_common.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <ctime>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+// Offline transcription of recorded audio. Files are decoded incrementally
+// (any format miniaudio reads: WAV, FLAC, MP3), split into utterances by the
+// same VAD the daemon uses, and decoded concurrently on the model's decoder
+// pool. Transcripts are printed in file order with absolute timestamps.
+
+namespace {
+
+using rt_stt::utils::format_time;
+using rt_stt::utils::running;
+
+constexpr uint32_t SAMPLE_RATE = 16000;
+constexpr size_t FRAME_SAMPLES = SAMPLE_RATE * 30 / 1000;  // 30 ms, as captured live
+
+struct Options {
+    rt_stt::stt::ModelConfig model;
+    rt_stt::audio::VADConfig vad;
+    int max_segment_s = 30;     // Longer speech is cut so memory stays bounded
+    int min_segment_ms = 500;   // Shorter blips are dropped, as in the daemon
+    bool json_output = false;
+    std::vector<std::string> files;
+};
+
+// One utterance cut from a file
+struct Segment {
+    size_t index = 0;
+    uint64_t start_sample = 0;
+    std::vector<float> samples;
+};
+
+// Turns a stream of frames into utterances, mirroring STTEngine's handling
+// of VAD transitions: pre-speech audio seeds the utterance and it ends when
+// the VAD goes from SPEECH_ENDING back to SILENCE
+class Segmenter {
+public:
+    using EmitFn = std::function<void(Segment&&)>;
+
+    Segmenter(const Options& options, EmitFn emit)
+        : vad_(rt_stt::audio::create_vad(options.vad)),
+          max_samples_(static_cast<size_t>(options.max_segment_s) * SAMPLE_RATE),
+          min_samples_(static_cast<size_t>(options.min_segment_ms) * SAMPLE_RATE / 1000),
+          emit_(std::move(emit)) {
+        vad_->set_state_callback([this](rt_stt::audio::VAD::State old_state, rt_stt::audio::VAD::State new_state) {
+            on_state_change(old_state, new_state);
+        });
+    }
+
+    void feed(const float* frame, size_t n_samples) {
+        frame_samples_ = n_samples;
+        vad_->process(frame, n_samples);
+
+        if (in_speech_) {
+            current_.insert(current_.end(), frame, frame + n_samples);
+            if (current_.size() >= max_samples_) {
+                emit_current();
+                current_start_ = position_ + n_samples;
+            }
+        }
+        position_ += n_samples;
+    }
+
+    // End of file: whatever is still open is an utterance
+    void flush() {
+        if (in_speech_) {
+            emit_current();
+            in_speech_ = false;
+        }
+    }
+
+private:
+    std::unique_ptr<rt_stt::audio::VAD> vad_;
+    size_t max_samples_;
+    size_t min_samples_;
+    EmitFn emit_;
+
+    std::vector<float> current_;
+    uint64_t current_start_ = 0;
+    uint64_t position_ = 0;      // Samples fed before the current frame
+    size_t frame_samples_ = 0;
+    size_t next_index_ = 0;
+    bool in_speech_ = false;
+
+    void on_state_change(rt_stt::audio::VAD::State old_state, rt_stt::audio::VAD::State new_state) {
+        using State = rt_stt::audio::VAD::State;
+        if (old_state == State::SILENCE && new_state == State::SPEECH_MAYBE) {
+            // The frame being processed is appended by feed() afterwards
+            current_.clear();
+            vad_->append_buffered_audio(current_, frame_samples_);
+            current_start_ = position_ - std::min<uint64_t>(position_, current_.size());
+            in_speech_ = true;
+        } else if (new_state == State::SILENCE) {
+            if (old_state == State::SPEECH_ENDING) {
+                emit_current();
+            }
+            in_speech_ = false;
+        }
+    }
+
+    void emit_current() {
+        if (current_.size() >= min_samples_) {
+            Segment segment;
+            segment.index = next_index_++;
+            segment.start_sample = current_start_;
+            segment.samples = std::move(current_);
+            emit_(std::move(segment));
+        }
+        current_ = std::vector<float>();
+        current_.reserve(max_samples_ / 4);
+    }
+};
+
+// Decodes segments on worker threads (one per decoder state) and prints
+// them strictly in segment order. submit() blocks while enough work is
+// waiting, so a long file never sits in memory.
+class DecodePool {
+public:
+    DecodePool(rt_stt::stt::WhisperWrapper& whisper, const Options& options, const std::string& file)
+        : whisper_(whisper), options_(options), file_(file),
+          max_pending_(2 * whisper.get_pool_size()) {
+        for (size_t i = 0; i < whisper.get_pool_size(); ++i) {
+            workers_.emplace_back(&DecodePool::worker_loop, this);
+        }
+    }
+
+    ~DecodePool() { finish(); }
+
+    void submit(Segment&& segment) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        space_cv_.wait(lock, [this] { return pending_.size() < max_pending_; });
+        submitted_++;
+        pending_.push_back(std::move(segment));
+        work_cv_.notify_one();
+    }
+
+    void finish() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (done_) return;
+            done_ = true;
+        }
+        work_cv_.notify_all();
+        for (auto& worker : workers_) {
+            worker.join();
+        }
+    }
+
+    size_t segments() const { return submitted_; }
+    double decode_seconds() const { return decode_us_.load() / 1e6; }
+
+private:
+    rt_stt::stt::WhisperWrapper& whisper_;
+    const Options& options_;
+    std::string file_;
+    size_t max_pending_;
+    std::vector<std::thread> workers_;
+
+    std::mutex mutex_;
+    std::condition_variable work_cv_;
+    std::condition_variable space_cv_;
+    std::deque<Segment> pending_;
+    bool done_ = false;
+    size_t submitted_ = 0;
+    std::atomic<uint64_t> decode_us_{0};
+
+    // In-order output
+    std::mutex output_mutex_;
+    std::map<size_t, std::pair<Segment, std::vector<rt_stt::stt::TranscriptionResult>>> completed_;
+    size_t next_output_ = 0;
+
+    void worker_loop() {
+        while (true) {
+            Segment segment;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                work_cv_.wait(lock, [this] { return !pending_.empty() || done_; });
+                if (pending_.empty()) return;
+                segment = std::move(pending_.front());
+                pending_.pop_front();
+            }
+            space_cv_.notify_one();
+
+            std::vector<rt_stt::stt::TranscriptionResult> results;
+            auto start = std::chrono::steady_clock::now();
+            whisper_.process_stream(segment.samples.data(), segment.samples.size(),
+                [&results](rt_stt::stt::TranscriptionResult&& result) {
+                    results.push_back(std::move(result));
+                });
+            decode_us_ += std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start).count();
+
+            // Samples are no longer needed once decoded
+            segment.samples = std::vector<float>();
+
+            std::lock_guard<std::mutex> lock(output_mutex_);
+            size_t index = segment.index;
+            completed_.emplace(index, std::make_pair(std::move(segment), std::move(results)));
+            for (auto it = completed_.begin(); it != completed_.end() && it->first == next_output_;
+                 it = completed_.erase(it), next_output_++) {
+                print(it->second.first, it->second.second);
+            }
+        }
+    }
+
+    void print(const Segment& segment, const std::vector<rt_stt::stt::TranscriptionResult>& results) {
+        const double offset = static_cast<double>(segment.start_sample) / SAMPLE_RATE;
+        for (const auto& result : results) {
+            if (options_.json_output) {
+                nlohmann::json line = {
+                    {"file", file_},
+                    {"start", offset},
+                    {"end", offset + result.audio_duration_ms / 1000.0},
+                    {"text", result.text},
+                    {"confidence", result.confidence},
+                    {"language", result.language},
+                    {"segments", nlohmann::json::array()}
+                };
+                for (const auto& s : result.segments) {
+                    line["segments"].push_back({
+                        {"start", offset + s.start},
+                        {"end", offset + s.end},
+                        {"text", s.text},
+                        {"avg_logprob", s.avg_logprob}
+                    });
+                }
+                std::cout << line.dump() << "\n";
+            } else if (result.segments.size() > 1) {
+                for (const auto& s : result.segments) {
+                    std::cout << "[" << format_time(offset + s.start) << " --> "
+                              << format_time(offset + s.end) << "] " << s.text << "\n";
+                }
+            } else {
+                std::cout << "[" << format_time(offset) << " --> "
+                          << format_time(offset + result.audio_duration_ms / 1000.0) << "] "
+                          << result.text << "\n";
+            }
+        }
+        std::cout.flush();
+    }
+};
+
+bool transcribe_file(rt_stt::stt::WhisperWrapper& whisper, const Options& options, const std::string& file,
+                     double& audio_seconds) {
+    auto wall_start = std::chrono::steady_clock::now();
+    DecodePool pool(whisper, options, file);
+    Segmenter segmenter(options, [&pool](Segment&& segment) { pool.submit(std::move(segment)); });
+
+    auto feed = [&segmenter](const float* samples, size_t n_samples) { segmenter.feed(samples, n_samples); };
+    uint64_t total_samples = 0;
+    if (!rt_stt::utils::decode_audio_file(file, SAMPLE_RATE, FRAME_SAMPLES, feed, total_samples)) {
+        return false;
+    }
+    segmenter.flush();
+
+    pool.finish();
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+    audio_seconds = static_cast<double>(total_samples) / SAMPLE_RATE;
+
+    std::cerr << file << ": " << format_time(audio_seconds) << " of audio, " << pool.segments()
+              << " segments in " << wall << " s (RTF " << (audio_seconds > 0 ? wall / audio_seconds : 0.0)
+              << ", decoders busy " << pool.decode_seconds() << " s)" << std::endl;
+    return true;
+}
+
+void print_usage(const char* program) {
+    std::cout << "Usage: " << program << " [options] FILE...\n";
+    std::cout << "Transcribe recorded audio (WAV, FLAC, MP3) using the VAD and models of the daemon.\n";
+    std::cout << "Options:\n";
+    rt_stt::utils::print_model_usage();
+    std::cout << "  --decoders N        Concurrent decodes (default: cores / threads)\n";
+    std::cout << "  --translate         Translate to English\n";
+    std::cout << "  --vad TYPE          energy or spectral (default: energy)\n";
+    std::cout << "  --max-segment S     Cut speech longer than S seconds (default: 30)\n";
+    std::cout << "  --json              One JSON object per utterance\n";
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    rt_stt::utils::install_stop_handlers();
+
+    Options options;
+    options.model.model_path = "models/ggml-base.en.bin";
+    options.model.language = "en";
+    options.model.n_threads = 4;
+    options.model.beam_size = 5;
+    int decoders = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (rt_stt::utils::parse_model_option(argc, argv, i, options.model)) continue;
+        std::string arg = argv[i];
+        if (arg == "--decoders" && i + 1 < argc) {
+            decoders = std::max(1, std::stoi(argv[++i]));
+        } else if (arg == "--translate") {
+            options.model.translate = true;
+        } else if (arg == "--vad" && i + 1 < argc) {
+            std::string type = argv[++i];
+            // The neural VAD scores asynchronously, which only keeps up with
+            // audio arriving in real time, so it is not offered here
+            if (type == "spectral") {
+                options.vad.type = rt_stt::audio::VADConfig::Type::SPECTRAL;
+            } else {
+                options.vad.type = rt_stt::audio::VADConfig::Type::ENERGY;
+            }
+        } else if (arg == "--max-segment" && i + 1 < argc) {
+            options.max_segment_s = std::max(1, std::stoi(argv[++i]));
+        } else if (arg == "--json") {
+            options.json_output = true;
+        } else if (arg == "--help" || arg == "-h") {
+            print_usage(argv[0]);
+            return 0;
+        } else if (!arg.empty() && arg[0] != '-') {
+            options.files.push_back(arg);
+        } else {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (options.files.empty()) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    // Fill the machine: each decoder state runs n_threads threads
+    if (decoders == 0) {
+        unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+        decoders = std::max(1, static_cast<int>(cores) / options.model.n_threads);
+    }
+    options.model.n_decoders = decoders;
+    options.vad.sample_rate = SAMPLE_RATE;
+
+    rt_stt::stt::WhisperWrapper whisper;
+    std::cerr << "Loading model: " << options.model.model_path << " (" << decoders << " decoders x "
+              << options.model.n_threads << " threads)" << std::endl;
+    if (!whisper.initialize(options.model)) {
+        std::cerr << "Failed to load model: " << options.model.model_path << std::endl;
+        return 1;
+    }
+
+    auto wall_start = std::chrono::steady_clock::now();
+    std::clock_t cpu_start = std::clock();
+    double total_audio = 0.0;
+    bool ok = true;
+
+    for (const auto& file : options.files) {
+        if (!running()) break;
+        double audio_seconds = 0.0;
+        ok = transcribe_file(whisper, options, file, audio_seconds) && ok;
+        total_audio += audio_seconds;
+    }
+
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+    double cpu = static_cast<double>(std::clock() - cpu_start) / CLOCKS_PER_SEC;
+    if (total_audio > 0.0) {
+        // Wall RTF is the throughput; CPU RTF is what it cost across all cores
+        std::cerr << "Total: " << format_time(total_audio) << " of audio in " << wall << " s, RTF "
+                  << wall / total_audio << " (" << total_audio / wall << "x real time), CPU RTF "
+                  << cpu / total_audio << std::endl;
+    }
+
+    whisper.shutdown();
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,571 @@
+#include "stt/engine.h"
+#include "audio/ring_buffer.h"
+#include "utils/histogram.h"
+#include "utils/tool_common.h"
+#include <sys/resource.h>
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+// Reproducible benchmark over a corpus of recordings. Each file is replayed
+// through the daemon's capture path (a ring buffer drained by the engine's
+// ingest thread, in 30 ms frames) either paced to real time or as fast as
+// the decoders keep up, and the results are scored against reference
+// transcripts. Everything lands in one JSON report on stdout so runs with
+// different models or VAD settings can be diffed.
+
+namespace {
+
+using rt_stt::utils::running;
+
+constexpr uint32_t SAMPLE_RATE = 16000;
+constexpr size_t FRAME_SAMPLES = SAMPLE_RATE * 30 / 1000;  // 30 ms, as captured live
+
+struct Options {
+    rt_stt::stt::STTEngine::Config engine;
+    bool realtime = true;        // false: replay as fast as the decoders keep up
+    std::string partial_model_path;
+    std::string label;
+    std::string output_path;
+    double max_wer = -1.0;       // Regression gates; negative means unchecked
+    double max_p90_ms = -1.0;
+    std::vector<std::string> inputs;
+};
+
+// One recording and its reference transcript (FILE.txt next to FILE.wav)
+struct CorpusEntry {
+    std::string audio_path;
+    std::string reference;
+    bool has_reference = false;
+};
+
+struct WordErrors {
+    size_t reference_words = 0;
+    size_t substitutions = 0;
+    size_t deletions = 0;
+    size_t insertions = 0;
+    size_t total() const { return substitutions + deletions + insertions; }
+};
+
+// Lowercased words with punctuation removed, so "Hello, world." scores
+// the same as "hello world"; apostrophes stay part of the word
+std::vector<std::string> normalize_words(const std::string& text) {
+    std::vector<std::string> words;
+    std::string word;
+    for (char c : text) {
+        unsigned char uc = static_cast<unsigned char>(c);
+        if (std::isalnum(uc) || c == '\'' || uc >= 0x80) {
+            word += static_cast<char>(std::tolower(uc));
+        } else if (!word.empty()) {
+            words.push_back(std::move(word));
+            word.clear();
+        }
+    }
+    if (!word.empty()) {
+        words.push_back(std::move(word));
+    }
+    return words;
+}
+
+// Word-level Levenshtein alignment, keeping the edit breakdown
+WordErrors word_errors(const std::string& reference, const std::string& hypothesis) {
+    struct Cell {
+        size_t cost = 0;
+        size_t sub = 0, del = 0, ins = 0;
+    };
+
+    std::vector<std::string> ref = normalize_words(reference);
+    std::vector<std::string> hyp = normalize_words(hypothesis);
+
+    std::vector<Cell> prev(hyp.size() + 1), curr(hyp.size() + 1);
+    for (size_t j = 1; j <= hyp.size(); ++j) {
+        prev[j] = {j, 0, 0, j};
+    }
+    for (size_t i = 1; i <= ref.size(); ++i) {
+        curr[0] = {i, 0, i, 0};
+        for (size_t j = 1; j <= hyp.size(); ++j) {
+            if (ref[i - 1] == hyp[j - 1]) {
+                curr[j] = prev[j - 1];
+                continue;
+            }
+            Cell best = prev[j - 1];
+            best.sub++;
+            if (prev[j].cost < best.cost) {
+                best = prev[j];
+                best.del++;
+            }
+            if (curr[j - 1].cost < best.cost) {
+                best = curr[j - 1];
+                best.ins++;
+            }
+            best.cost++;
+            curr[j] = best;
+        }
+        std::swap(prev, curr);
+    }
+
+    WordErrors errors;
+    errors.reference_words = ref.size();
+    errors.substitutions = prev[hyp.size()].sub;
+    errors.deletions = prev[hyp.size()].del;
+    errors.insertions = prev[hyp.size()].ins;
+    return errors;
+}
+
+bool is_audio_file(const std::filesystem::path& path) {
+    std::string ext = path.extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return std::tolower(c); });
+    return ext == ".wav" || ext == ".flac" || ext == ".mp3";
+}
+
+// Files are taken as given; directories contribute their recordings in name
+// order, so a corpus always replays in the same sequence
+std::vector<CorpusEntry> load_corpus(const std::vector<std::string>& inputs) {
+    std::vector<std::filesystem::path> paths;
+    for (const auto& input : inputs) {
+        std::error_code ec;
+        if (std::filesystem::is_directory(input, ec)) {
+            std::vector<std::filesystem::path> found;
+            for (const auto& entry : std::filesystem::directory_iterator(input, ec)) {
+                if (entry.is_regular_file() && is_audio_file(entry.path())) {
+                    found.push_back(entry.path());
+                }
+            }
+            std::sort(found.begin(), found.end());
+            paths.insert(paths.end(), found.begin(), found.end());
+        } else {
+            paths.emplace_back(input);
+        }
+    }
+
+    std::vector<CorpusEntry> corpus;
+    for (const auto& path : paths) {
+        CorpusEntry entry;
+        entry.audio_path = path.string();
+
+        std::filesystem::path reference_path = path;
+        reference_path.replace_extension(".txt");
+        std::ifstream reference(reference_path);
+        if (reference) {
+            std::stringstream buffer;
+            buffer << reference.rdbuf();
+            entry.reference = buffer.str();
+            entry.has_reference = true;
+        } else {
+            std::cerr << "No reference transcript for " << entry.audio_path << " (WER not scored)" << std::endl;
+        }
+        corpus.push_back(std::move(entry));
+    }
+    return corpus;
+}
+
+nlohmann::json latency_json(const rt_stt::utils::LatencyHistogram::Snapshot& snapshot) {
+    return {
+        {"count", snapshot.count},
+        {"mean_ms", snapshot.mean_ms()},
+        {"p50_ms", snapshot.percentile_ms(0.50)},
+        {"p90_ms", snapshot.percentile_ms(0.90)},
+        {"p99_ms", snapshot.percentile_ms(0.99)},
+        {"max_ms", snapshot.max_ms()}
+    };
+}
+
+// Process CPU time (user + system, all threads) in seconds
+double cpu_seconds() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+           (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+size_t peak_rss_mb() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return static_cast<size_t>(usage.ru_maxrss) / (1024 * 1024);  // bytes
+#else
+    return static_cast<size_t>(usage.ru_maxrss) / 1024;           // kilobytes
+#endif
+}
+
+// Stands in for AudioCapture: the replay thread writes frames into the ring
+// the way the device callback does, the engine's ingest thread drains it
+class Replayer {
+public:
+    Replayer(rt_stt::stt::STTEngine& engine, const Options& options)
+        : engine_(engine), options_(options), ring_(SAMPLE_RATE * 4),
+          max_pending_(2 * static_cast<size_t>(std::max(1, options.engine.model_config.n_decoders))) {
+        engine_.set_audio_source([this](float* buffer, size_t max_samples) {
+            return ring_.read(buffer, max_samples);
+        });
+    }
+
+    // Replays one file and returns its length in seconds, or a negative
+    // value if it could not be opened
+    double replay_file(const std::string& path) {
+        start_ = std::chrono::steady_clock::now();
+        written_ = 0;
+
+        auto feed = [this](const float* samples, size_t n_samples) { push(samples, n_samples); };
+        uint64_t file_samples = 0;
+        if (!rt_stt::utils::decode_audio_file(path, SAMPLE_RATE, FRAME_SAMPLES, feed, file_samples)) {
+            return -1.0;
+        }
+
+        // Trailing silence long enough for the VAD to close the last
+        // utterance, so every file ends the way a pause in speech would
+        const auto& vad = options_.engine.vad_config;
+        size_t silence_samples = static_cast<size_t>(vad.speech_end_ms + vad.speech_start_ms + 300) *
+                                 SAMPLE_RATE / 1000;
+        std::vector<float> frame(FRAME_SAMPLES, 0.0f);
+        for (size_t sent = 0; sent < silence_samples && running(); sent += FRAME_SAMPLES) {
+            push(frame.data(), FRAME_SAMPLES);
+        }
+
+        drain();
+        return static_cast<double>(file_samples) / SAMPLE_RATE;
+    }
+
+private:
+    rt_stt::stt::STTEngine& engine_;
+    const Options& options_;
+    rt_stt::audio::SPSCRingBuffer ring_;
+    size_t max_pending_;
+    std::chrono::steady_clock::time_point start_;
+    uint64_t written_ = 0;
+
+    void push(const float* samples, size_t n_samples) {
+        if (options_.realtime) {
+            // Deliver each frame when a device would have
+            auto due = start_ + std::chrono::microseconds(written_ * 1000000 / SAMPLE_RATE);
+            std::this_thread::sleep_until(due);
+        } else {
+            // Never overrun the ring, and hold back while enough finals are
+            // waiting that replaying further would only measure the queue
+            while (running() &&
+                   (ring_.capacity() - ring_.available() < n_samples ||
+                    engine_.get_pending_finals() >= max_pending_)) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            }
+        }
+        ring_.write(samples, n_samples);
+        written_ += n_samples;
+    }
+
+    // Wait until the engine has consumed every frame and delivered every final
+    void drain() {
+        while (running() && ring_.available() > 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        // The last frame read may still be in the VAD rather than the queue
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        while (running() && engine_.get_pending_finals() > 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+    }
+};
+
+// What the transcription callback collects for the file being replayed
+struct FileResults {
+    std::mutex mutex;
+    std::string hypothesis;
+    size_t finals = 0;
+    rt_stt::utils::LatencyHistogram latency;
+
+    void add(const rt_stt::stt::TranscriptionResult& result) {
+        if (!result.is_final) return;
+        // Same measure as summary.final_latency
+        latency.record_ms(static_cast<double>(result.speech_latency.count()));
+
+        std::lock_guard<std::mutex> lock(mutex);
+        finals++;
+        if (!result.text.empty()) {
+            if (!hypothesis.empty()) hypothesis += ' ';
+            hypothesis += result.text;
+        }
+    }
+};
+
+const char* vad_type_name(rt_stt::audio::VADConfig::Type type) {
+    switch (type) {
+        case rt_stt::audio::VADConfig::Type::SPECTRAL: return "spectral";
+        case rt_stt::audio::VADConfig::Type::NEURAL:   return "neural";
+        default:                                       return "energy";
+    }
+}
+
+void print_usage(const char* program) {
+    std::cout << "Usage: " << program << " [options] FILE|DIR...\n";
+    std::cout << "Replay a corpus of recordings through the engine and report latency, RTF, CPU, memory\n";
+    std::cout << "and WER (against FILE.txt reference transcripts) as JSON.\n";
+    std::cout << "Options:\n";
+    rt_stt::utils::print_model_usage();
+    std::cout << "  --partial-model P   STREAMING: separate model for partials\n";
+    std::cout << "  --decoders N        Concurrent decodes (default: 1)\n";
+    std::cout << "  --mode MODE         utterance or streaming (default: utterance)\n";
+    std::cout << "  --vad TYPE          energy, spectral or neural (default: energy)\n";
+    std::cout << "  --vad-model PATH    Silero model for the neural VAD\n";
+    std::cout << "  --vad-threshold T   Speech start threshold (default: 0.02)\n";
+    std::cout << "  --speed SPEED       realtime or max (default: realtime)\n";
+    std::cout << "  --label NAME        Name recorded in the report, e.g. the config under test\n";
+    std::cout << "  --output FILE       Also write the report to FILE\n";
+    std::cout << "  --max-wer R         Exit with status 2 if corpus WER exceeds R (e.g. 0.15)\n";
+    std::cout << "  --max-p90-ms MS     Exit with status 2 if p90 final latency exceeds MS\n";
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    rt_stt::utils::install_stop_handlers();
+
+    Options options;
+    auto& engine_config = options.engine;
+    engine_config.model_config.model_path = "models/ggml-base.en.bin";
+    engine_config.model_config.language = "en";
+    engine_config.enable_terminal_output = false;
+    engine_config.segment_metadata = false;
+    engine_config.max_queue_size = 0;   // Every utterance is scored; nothing is dropped
+    engine_config.vad_config.sample_rate = SAMPLE_RATE;
+
+    for (int i = 1; i < argc; i++) {
+        if (rt_stt::utils::parse_model_option(argc, argv, i, engine_config.model_config)) continue;
+        std::string arg = argv[i];
+        if (arg == "--partial-model" && i + 1 < argc) {
+            options.partial_model_path = argv[++i];
+        } else if (arg == "--decoders" && i + 1 < argc) {
+            engine_config.model_config.n_decoders = std::max(1, std::stoi(argv[++i]));
+        } else if (arg == "--mode" && i + 1 < argc) {
+            std::string mode = argv[++i];
+            engine_config.mode = mode == "streaming"
+                ? rt_stt::stt::STTEngine::TranscriptionMode::STREAMING
+                : rt_stt::stt::STTEngine::TranscriptionMode::UTTERANCE;
+        } else if (arg == "--vad" && i + 1 < argc) {
+            std::string type = argv[++i];
+            if (type == "spectral") {
+                engine_config.vad_config.type = rt_stt::audio::VADConfig::Type::SPECTRAL;
+            } else if (type == "neural") {
+                engine_config.vad_config.type = rt_stt::audio::VADConfig::Type::NEURAL;
+            } else {
+                engine_config.vad_config.type = rt_stt::audio::VADConfig::Type::ENERGY;
+            }
+        } else if (arg == "--vad-model" && i + 1 < argc) {
+            engine_config.vad_config.neural_model_path = argv[++i];
+        } else if (arg == "--vad-threshold" && i + 1 < argc) {
+            engine_config.vad_config.speech_start_threshold = std::stof(argv[++i]);
+        } else if (arg == "--speed" && i + 1 < argc) {
+            options.realtime = std::string(argv[++i]) != "max";
+        } else if (arg == "--label" && i + 1 < argc) {
+            options.label = argv[++i];
+        } else if (arg == "--output" && i + 1 < argc) {
+            options.output_path = argv[++i];
+        } else if (arg == "--max-wer" && i + 1 < argc) {
+            options.max_wer = std::stod(argv[++i]);
+        } else if (arg == "--max-p90-ms" && i + 1 < argc) {
+            options.max_p90_ms = std::stod(argv[++i]);
+        } else if (arg == "--help" || arg == "-h") {
+            print_usage(argv[0]);
+            return 0;
+        } else if (!arg.empty() && arg[0] != '-') {
+            options.inputs.push_back(arg);
+        } else {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (options.inputs.empty()) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    // The partial model decodes with the same settings as the main one
+    if (!options.partial_model_path.empty()) {
+        engine_config.partial_model_config = engine_config.model_config;
+        engine_config.partial_model_config.model_path = options.partial_model_path;
+        engine_config.partial_model_config.n_decoders = 1;
+    }
+
+    std::vector<CorpusEntry> corpus = load_corpus(options.inputs);
+    if (corpus.empty()) {
+        std::cerr << "No recordings found" << std::endl;
+        return 1;
+    }
+
+    if (!options.realtime && engine_config.vad_config.type == rt_stt::audio::VADConfig::Type::NEURAL) {
+        // Its scores arrive asynchronously and lag audio replayed faster than real time
+        std::cerr << "Warning: the neural VAD is only representative with --speed realtime" << std::endl;
+    }
+
+    rt_stt::stt::STTEngine engine;
+    if (!engine.initialize(engine_config)) {
+        std::cerr << "Failed to initialize STT engine" << std::endl;
+        return 1;
+    }
+    auto startup = engine.get_startup_timing();
+
+    FileResults* current = nullptr;
+    std::mutex current_mutex;
+    engine.set_transcription_callback([&](const rt_stt::stt::TranscriptionResult& result) {
+        std::lock_guard<std::mutex> lock(current_mutex);
+        if (current) current->add(result);
+    });
+
+    Replayer replayer(engine, options);
+    engine.start();
+
+    // Model loading and warm-up are reported separately from the run
+    auto wall_start = std::chrono::steady_clock::now();
+    double cpu_start = cpu_seconds();
+
+    nlohmann::json files = nlohmann::json::array();
+    WordErrors corpus_errors;
+    double total_audio = 0.0;
+    bool ok = true;
+
+    for (const auto& entry : corpus) {
+        if (!running()) break;
+
+        FileResults results;
+        {
+            std::lock_guard<std::mutex> lock(current_mutex);
+            current = &results;
+        }
+        std::cerr << "Replaying " << entry.audio_path << std::endl;
+        double audio_seconds = replayer.replay_file(entry.audio_path);
+        {
+            std::lock_guard<std::mutex> lock(current_mutex);
+            current = nullptr;
+        }
+        if (audio_seconds < 0.0) {
+            ok = false;
+            continue;
+        }
+        total_audio += audio_seconds;
+
+        nlohmann::json file = {
+            {"file", entry.audio_path},
+            {"audio_s", audio_seconds},
+            {"finals", results.finals},
+            {"hypothesis", results.hypothesis},
+            {"latency", latency_json(results.latency.snapshot())}
+        };
+        if (entry.has_reference) {
+            WordErrors errors = word_errors(entry.reference, results.hypothesis);
+            corpus_errors.reference_words += errors.reference_words;
+            corpus_errors.substitutions += errors.substitutions;
+            corpus_errors.deletions += errors.deletions;
+            corpus_errors.insertions += errors.insertions;
+            file["reference_words"] = errors.reference_words;
+            file["substitutions"] = errors.substitutions;
+            file["deletions"] = errors.deletions;
+            file["insertions"] = errors.insertions;
+            file["wer"] = errors.reference_words
+                ? static_cast<double>(errors.total()) / errors.reference_words : 0.0;
+        }
+        files.push_back(std::move(file));
+    }
+
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+    double cpu = cpu_seconds() - cpu_start;
+    auto metrics = engine.get_metrics();
+
+    nlohmann::json stages = nlohmann::json::object();
+    for (size_t i = 0; i < static_cast<size_t>(rt_stt::stt::STTEngine::LatencyStage::COUNT); ++i) {
+        auto stage = static_cast<rt_stt::stt::STTEngine::LatencyStage>(i);
+        stages[rt_stt::stt::STTEngine::latency_stage_name(stage)] = latency_json(engine.get_latency_snapshot(stage));
+    }
+
+    // Last voiced frame -> final delivered, hangover included: what a
+    // speaker actually waits for
+    auto final_latency = engine.get_latency_snapshot(rt_stt::stt::STTEngine::LatencyStage::SPEECH_TO_DELIVERY);
+    auto hangover = engine.get_latency_snapshot(rt_stt::stt::STTEngine::LatencyStage::VAD_HANGOVER);
+
+    // Taken from the decode stage rather than get_metrics(), whose RTF is
+    // refreshed at most once a second and can miss the last decodes
+    double decode_s = engine.get_latency_snapshot(rt_stt::stt::STTEngine::LatencyStage::DECODE).sum_us / 1e6;
+
+    nlohmann::json summary = {
+        {"files", files.size()},
+        {"audio_s", total_audio},
+        {"wall_s", wall},
+        {"rtf", total_audio > 0.0 ? wall / total_audio : 0.0},
+        {"decode_rtf", total_audio > 0.0 ? decode_s / total_audio : 0.0},
+        {"cpu_s", cpu},
+        {"cpu_s_per_audio_s", total_audio > 0.0 ? cpu / total_audio : 0.0},
+        {"peak_rss_mb", peak_rss_mb()},
+        {"finals", metrics.transcriptions_count},
+        {"dropped_chunks", metrics.dropped_chunks},
+        {"final_latency", latency_json(final_latency)},
+        {"vad_hangover_mean_ms", hangover.mean_ms()},
+        {"stages", stages}
+    };
+    if (corpus_errors.reference_words > 0) {
+        summary["reference_words"] = corpus_errors.reference_words;
+        summary["wer"] = static_cast<double>(corpus_errors.total()) / corpus_errors.reference_words;
+    }
+
+    const auto& model = engine_config.model_config;
+    nlohmann::json report = {
+        {"label", options.label},
+        {"config", {
+            {"model", model.model_path},
+            {"partial_model", engine_config.partial_model_config.model_path},
+            {"language", model.language},
+            {"threads", model.n_threads},
+            {"decoders", model.n_decoders},
+            {"beam_size", model.beam_size},
+            {"use_gpu", model.use_gpu},
+            {"mode", engine_config.mode == rt_stt::stt::STTEngine::TranscriptionMode::STREAMING
+                ? "streaming" : "utterance"},
+            {"vad", vad_type_name(engine_config.vad_config.type)},
+            {"speech_start_threshold", engine_config.vad_config.speech_start_threshold},
+            {"speed", options.realtime ? "realtime" : "max"}
+        }},
+        {"startup", {
+            {"model_load_ms", startup.model_load_ms},
+            {"warm_up_ms", startup.warm_up_ms}
+        }},
+        {"summary", summary},
+        {"files", files}
+    };
+
+    engine.stop();
+    engine.shutdown();
+
+    std::string text = report.dump(2);
+    std::cout << text << std::endl;
+    if (!options.output_path.empty()) {
+        std::ofstream out(options.output_path);
+        if (!out) {
+            std::cerr << "Failed to write report: " << options.output_path << std::endl;
+            ok = false;
+        } else {
+            out << text << "\n";
+        }
+    }
+
+    if (!ok) return 1;
+
+    bool regressed = false;
+    if (options.max_wer >= 0.0 && summary.contains("wer") && summary["wer"].get<double>() > options.max_wer) {
+        std::cerr << "WER " << summary["wer"].get<double>() << " exceeds " << options.max_wer << std::endl;
+        regressed = true;
+    }
+    if (options.max_p90_ms >= 0.0 && final_latency.percentile_ms(0.90) > options.max_p90_ms) {
+        std::cerr << "p90 final latency " << final_latency.percentile_ms(0.90) << " ms exceeds "
+                  << options.max_p90_ms << " ms" << std::endl;
+        regressed = true;
+    }
+    return regressed ? 2 : 0;
+}
@@ -84,11 +84,11 @@ public:
     bool stream_transcriptions(bool json_output = false, bool timestamps = false) {
         if (socket_fd_ < 0) return false;
         
-        // Subscribe to transcriptions
+        // Subscribe to transcriptions; frames after the ack arrive as MessagePack
         nlohmann::json msg = {
             {"type", 1},  // SUBSCRIBE
             {"id", std::to_string(std::chrono::system_clock::now().time_since_epoch().count())},
-            {"data", {}}
+            {"data", {{"encoding", "msgpack"}}}
         };
         
         if (!send_message(msg)) {
@@ -114,6 +114,10 @@ public:
                         auto time_t = std::chrono::system_clock::to_time_t(now);
                         std::cout << "[" << std::put_time(std::localtime(&time_t), "%H:%M:%S") << "] ";
                     }
+                    std::string stream_id = data.value("stream_id", "default");
+                    if (stream_id != "default") {
+                        std::cout << "(" << stream_id << ") ";
+                    }
                     std::cout << data["text"].get<std::string>() << std::endl;
                 }
             }
@@ -139,6 +143,15 @@ public:
             std::cout << "  Model: " << result["model"] << std::endl;
             std::cout << "  Language: " << result["language"] << std::endl;
             std::cout << "  VAD Enabled: " << (result["vad_enabled"] ? "Yes" : "No") << std::endl;
+            std::cout << "  Ready: " << (result.value("ready", false) ? "Yes" : "No") << std::endl;
+            if (result.value("model_loading", false)) {
+                std::cout << "  Model loading: Yes" << std::endl;
+            }
+            if (result.contains("startup")) {
+                std::cout << "  Startup: " << result["startup"].value("total_ms", 0.0f) << " ms (model load "
+                          << result["startup"].value("model_load_ms", 0.0f) << " ms, warm-up "
+                          << result["startup"].value("warm_up_ms", 0.0f) << " ms)" << std::endl;
+            }
         }
         
         return true;
@@ -167,8 +180,12 @@ public:
         return true;
     }
     
-    bool get_metrics(bool json_output) {
-        if (!send_command("get_metrics")) {
+    bool get_metrics(bool json_output, bool prometheus = false) {
+        nlohmann::json params = nlohmann::json::object();
+        if (prometheus) {
+            params["format"] = "prometheus";
+        }
+        if (!send_command("get_metrics", params)) {
             return false;
         }
         
@@ -179,15 +196,48 @@ public:
         
         if (response["type"] == 6 && response["data"]["success"]) {  // ACKNOWLEDGMENT
             auto& result = response["data"]["result"];
-            if (json_output) {
+            if (prometheus) {
+                std::cout << result.value("prometheus", "");
+            } else if (json_output) {
                 std::cout << result.dump(2) << std::endl;
             } else {
                 std::cout << "RT-STT Performance Metrics:" << std::endl;
                 std::cout << "  Average Latency: " << result["avg_latency_ms"].get<float>() << " ms" << std::endl;
                 std::cout << "  Average RTF: " << result["avg_rtf"].get<float>() << std::endl;
+                std::cout << "  Average audio_ctx: " << result.value("avg_audio_ctx", 0.0f) << std::endl;
+                size_t cascade_decodes = result.value("cascade_decodes", size_t(0));
+                if (cascade_decodes > 0) {
+                    std::cout << "  Cascade fallbacks: " << result.value("cascade_fallbacks", size_t(0))
+                              << " / " << cascade_decodes << std::endl;
+                }
+                std::cout << "  Queue: " << result.value("queue_depth", size_t(0)) << " waiting, avg wait "
+                          << result.value("avg_queue_wait_ms", 0.0f) << " ms" << std::endl;
+                std::cout << "  Overflow: " << result.value("dropped_chunks", size_t(0)) << " dropped, "
+                          << result.value("merged_chunks", size_t(0)) << " merged, "
+                          << result.value("downgraded_chunks", size_t(0)) << " downgraded" << std::endl;
+                size_t batched_decodes = result.value("batched_decodes", size_t(0));
+                if (batched_decodes > 0) {
+                    std::cout << "  Batched: " << result.value("batched_chunks", size_t(0)) << " utterances in "
+                              << batched_decodes << " decodes" << std::endl;
+                }
                 std::cout << "  CPU Usage: " << result["cpu_usage"].get<float>() << "%" << std::endl;
                 std::cout << "  Memory Usage: " << result["memory_usage_mb"].get<size_t>() << " MB" << std::endl;
                 std::cout << "  Transcriptions: " << result["transcriptions_count"].get<size_t>() << std::endl;
+                
+                if (result.contains("latency")) {
+                    std::cout << "  Latency (ms)      count      p50      p90      p99      max" << std::endl;
+                    for (const auto& [stage, stats] : result["latency"].items()) {
+                        if (stats.value("count", size_t(0)) == 0) continue;
+                        std::cout << "    " << std::left << std::setw(14) << stage << std::right
+                                  << std::setw(8) << stats.value("count", size_t(0))
+                                  << std::fixed << std::setprecision(1)
+                                  << std::setw(9) << stats.value("p50_ms", 0.0f)
+                                  << std::setw(9) << stats.value("p90_ms", 0.0f)
+                                  << std::setw(9) << stats.value("p99_ms", 0.0f)
+                                  << std::setw(9) << stats.value("max_ms", 0.0f)
+                                  << std::defaultfloat << std::endl;
+                    }
+                }
             }
         }
         
@@ -229,8 +279,18 @@ private:
             return false;
         }
         
+        // The payload's first byte tells the encodings apart: msgpack maps
+        // start 0x80-0x8f/0xde/0xdf, CBOR maps 0xa0-0xbf
         try {
-            msg = nlohmann::json::parse(std::string(buffer.data(), length));
+            uint8_t first = length > 0 ? static_cast<uint8_t>(buffer[0]) : 0;
+            const uint8_t* bytes = reinterpret_cast<const uint8_t*>(buffer.data());
+            if ((first & 0xF0) == 0x80 || first == 0xde || first == 0xdf) {
+                msg = nlohmann::json::from_msgpack(bytes, bytes + length);
+            } else if ((first & 0xE0) == 0xA0) {
+                msg = nlohmann::json::from_cbor(bytes, bytes + length);
+            } else {
+                msg = nlohmann::json::parse(buffer.begin(), buffer.end());
+            }
             return true;
         } catch (...) {
             return false;
@@ -254,6 +314,7 @@ void print_usage(const char* program) {
     std::cout << "  -s, --socket    Socket path (default: /tmp/rt-stt.sock)" << std::endl;
     std::cout << "  -j, --json      Output in JSON format" << std::endl;
     std::cout << "  -t, --timestamp Add timestamps to output" << std::endl;
+    std::cout << "  -p, --prometheus  get-metrics in Prometheus text format" << std::endl;
     std::cout << "  -h, --help      Show this help message" << std::endl;
     std::cout << std::endl;
     std::cout << "Examples:" << std::endl;
@@ -264,6 +325,7 @@ void print_usage(const char* program) {
     std::cout << "  " << program << " pause                # Pause listening" << std::endl;
     std::cout << "  " << program << " set-language es      # Set Spanish" << std::endl;
     std::cout << "  " << program << " get-config -j        # Get config as JSON" << std::endl;
+    std::cout << "  " << program << " get-metrics -p       # Metrics for Prometheus" << std::endl;
 }
 
 int main(int argc, char* argv[]) {
@@ -277,6 +339,7 @@ int main(int argc, char* argv[]) {
     std::string socket_path = "/tmp/rt-stt.sock";
     bool json_output = false;
     bool timestamps = false;
+    bool prometheus = false;
     std::vector<std::string> args;
     
     for (int i = 1; i < argc; i++) {
@@ -293,6 +356,8 @@ int main(int argc, char* argv[]) {
             json_output = true;
         } else if (arg == "-t" || arg == "--timestamp") {
             timestamps = true;
+        } else if (arg == "-p" || arg == "--prometheus") {
+            prometheus = true;
         } else if (arg[0] != '-') {
             if (command == "stream") {
                 command = arg;
@@ -329,7 +394,7 @@ int main(int argc, char* argv[]) {
     } else if (command == "get-config") {
         success = client.get_config(json_output);
     } else if (command == "get-metrics") {
-        success = client.get_metrics(json_output);
+        success = client.get_metrics(json_output, prometheus);
     } else {
         std::cerr << "Unknown command: " << command << std::endl;
         print_usage(argv[0]);
@@ -1,10 +1,667 @@
 #include "config/config.h"
+#include <sys/stat.h>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <set>
 
 namespace rt_stt {
 namespace config {
 
-// Placeholder implementation
-// Full configuration system will be implemented in Phase 5
+using json = nlohmann::json;
+using Engine = stt::STTEngine;
+using VADType = audio::VADConfig::Type;
+
+// Missing sections parse like empty ones, so every default lives in parse()
+static const json& section(const json& parent, const char* key) {
+    static const json empty = json::object();
+    auto it = parent.find(key);
+    return it != parent.end() && it->is_object() ? *it : empty;
+}
+
+static const char* vad_type_name(VADType type) {
+    switch (type) {
+        case VADType::SPECTRAL: return "spectral";
+        case VADType::NEURAL: return "neural";
+        default: return "energy";
+    }
+}
+
+static const char* overflow_policy_name(Engine::OverflowPolicy policy) {
+    switch (policy) {
+        case Engine::OverflowPolicy::MERGE: return "merge";
+        case Engine::OverflowPolicy::DOWNGRADE: return "downgrade";
+        default: return "drop_oldest";
+    }
+}
+
+// Counts and durations held as size_t are read signed, so a negative
+// value is reported instead of wrapping to a huge one
+static size_t unsigned_value(const json& parent, const char* key, int64_t fallback,
+                             const std::string& name, std::vector<std::string>& errors) {
+    int64_t value = parent.value(key, fallback);
+    if (value < 0) {
+        errors.push_back(name + " must not be negative");
+        return static_cast<size_t>(fallback);
+    }
+    return static_cast<size_t>(value);
+}
+
+ConfigManager::ConfigManager() {
+    Config defaults;
+    std::vector<std::string> errors;
+    parse(json::object(), defaults, errors);
+    current_ = std::make_shared<const Config>(std::move(defaults));
+}
+
+ConfigManager::~ConfigManager() {
+    stop_watching();
+}
+
+static bool read_file(const std::string& path, Config& config, std::vector<std::string>& errors) {
+    std::ifstream stream(path);
+    if (!stream) {
+        errors.push_back("cannot open " + path);
+        return false;
+    }
+
+    json document;
+    try {
+        stream >> document;
+    } catch (const std::exception& e) {
+        errors.push_back(e.what());
+        return false;
+    }
+    return ConfigManager::parse(document, config, errors);
+}
+
+static void report(const std::string& what, const std::vector<std::string>& errors) {
+    std::cerr << what << std::endl;
+    for (const auto& error : errors) {
+        std::cerr << "  " << error << std::endl;
+    }
+}
+
+bool ConfigManager::load(const std::string& path) {
+    path_ = path;
+
+    Config config;
+    std::vector<std::string> errors;
+    if (!read_file(path, config, errors)) {
+        report("Invalid configuration in " + path + ":", errors);
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(update_mutex_);
+    publish(std::make_shared<const Config>(std::move(config)));
+    return true;
+}
+
+bool ConfigManager::save(const std::string& path) const {
+    const std::string& target = path.empty() ? path_ : path;
+    if (target.empty()) return false;
+
+    // Rename over the target so the watcher sees the old or the new file
+    const std::string temp = target + ".tmp";
+    {
+        std::ofstream stream(temp);
+        if (!stream) {
+            std::cerr << "Cannot write configuration to " << temp << std::endl;
+            return false;
+        }
+        stream << to_json(*get()).dump(4) << std::endl;
+        if (!stream) {
+            std::cerr << "Cannot write configuration to " << temp << std::endl;
+            return false;
+        }
+    }
+    if (std::rename(temp.c_str(), target.c_str()) != 0) {
+        std::cerr << "Cannot replace " << target << std::endl;
+        std::remove(temp.c_str());
+        return false;
+    }
+    return true;
+}
+
+Snapshot ConfigManager::update(const json& patch, std::vector<std::string>& errors) {
+    // Merged under the lock so a concurrent reload is not lost
+    std::lock_guard<std::mutex> lock(update_mutex_);
+    json document = to_json(*get());
+    document.merge_patch(patch);
+
+    Config config;
+    if (!parse(document, config, errors)) {
+        return nullptr;
+    }
+    return publish(std::make_shared<const Config>(std::move(config)));
+}
+
+Snapshot ConfigManager::publish(Snapshot next) {
+    Snapshot previous = std::atomic_exchange(&current_, next);
+    if (change_callback_) {
+        change_callback_(previous, next);
+    }
+    return previous;
+}
+
+// Identity of the file's current contents as far as stat can tell
+struct FileStamp {
+    bool exists = false;
+    ino_t inode = 0;
+    off_t size = 0;
+    time_t mtime = 0;
+    long mtime_nsec = 0;
+
+    bool operator==(const FileStamp& other) const {
+        return exists == other.exists && inode == other.inode && size == other.size &&
+               mtime == other.mtime && mtime_nsec == other.mtime_nsec;
+    }
+    bool operator!=(const FileStamp& other) const { return !(*this == other); }
+};
+
+static FileStamp stamp_file(const std::string& path) {
+    FileStamp stamp;
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) return stamp;
+
+    stamp.exists = true;
+    stamp.inode = st.st_ino;
+    stamp.size = st.st_size;
+    stamp.mtime = st.st_mtime;
+#ifdef __APPLE__
+    stamp.mtime_nsec = st.st_mtimespec.tv_nsec;
+#else
+    stamp.mtime_nsec = st.st_mtim.tv_nsec;
+#endif
+    return stamp;
+}
+
+bool ConfigManager::watch(std::chrono::milliseconds interval) {
+    if (path_.empty()) {
+        std::cerr << "No configuration file to watch" << std::endl;
+        return false;
+    }
+    if (watching_.exchange(true)) return true;
+
+    watcher_ = std::thread(&ConfigManager::watch_loop, this, interval);
+    return true;
+}
+
+void ConfigManager::stop_watching() {
+    {
+        std::lock_guard<std::mutex> lock(watch_mutex_);
+        if (!watching_.exchange(false)) return;
+    }
+    watch_cv_.notify_all();
+
+    if (watcher_.joinable()) {
+        watcher_.join();
+    }
+}
+
+void ConfigManager::watch_loop(std::chrono::milliseconds interval) {
+    FileStamp last = stamp_file(path_);
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(watch_mutex_);
+            watch_cv_.wait_for(lock, interval, [this] { return !watching_.load(); });
+            if (!watching_.load()) break;
+        }
+
+        // Gone means an editor is between unlink and rename; wait for the
+        // file to come back rather than treating it as a change
+        FileStamp stamp = stamp_file(path_);
+        if (!stamp.exists || stamp == last) continue;
+        last = stamp;
+
+        Config config;
+        std::vector<std::string> errors;
+        if (!read_file(path_, config, errors)) {
+            report("Ignoring configuration change in " + path_ + ":", errors);
+            continue;
+        }
+
+        // Our own save(), or a touch: nothing to apply
+        std::lock_guard<std::mutex> lock(update_mutex_);
+        if (to_json(config) == to_json(*get())) continue;
+
+        std::cout << "Configuration reloaded from " << path_ << std::endl;
+        publish(std::make_shared<const Config>(std::move(config)));
+    }
+}
+
+bool ConfigManager::parse(const json& document, Config& config, std::vector<std::string>& errors) {
+    if (!document.is_object()) {
+        errors.push_back("configuration must be a JSON object");
+        return false;
+    }
+
+    config = Config();
+    Engine::Config& engine = config.engine;
+
+    // A value of the wrong JSON type throws from value(); report which
+    // section it was in and carry on with the others
+    auto guarded = [&errors](const char* name, const std::function<void()>& parse_section) {
+        try {
+            parse_section();
+        } catch (const std::exception& e) {
+            errors.push_back(std::string(name) + ": " + e.what());
+        }
+    };
+
+    const json& stt = section(document, "stt");
+    guarded("stt", [&] {
+        std::string mode = stt.value("mode", "utterance");
+        if (mode == "streaming") {
+            engine.mode = Engine::TranscriptionMode::STREAMING;
+        } else if (mode != "utterance") {
+            errors.push_back("stt.mode must be \"utterance\" or \"streaming\", not \"" + mode + "\"");
+        }
+        engine.partial_step_ms = unsigned_value(stt, "partial_step_ms", 1000, "stt.partial_step_ms", errors);
+        engine.max_queue_size = unsigned_value(stt, "max_queue_size", 100, "stt.max_queue_size", errors);
+        engine.batch_short_utterances = stt.value("batch_short_utterances", false);
+        engine.batch_max_utterance_ms = unsigned_value(stt, "batch_max_utterance_ms", 2000, "stt.batch_max_utterance_ms", errors);
+        engine.batch_max_ms = unsigned_value(stt, "batch_max_ms", 20000, "stt.batch_max_ms", errors);
+        engine.segment_metadata = stt.value("segment_metadata", true);
+        engine.carry_context = stt.value("carry_context", false);
+        engine.context_max_tokens = unsigned_value(stt, "context_max_tokens", 64, "stt.context_max_tokens", errors);
+        engine.context_max_gap_ms = unsigned_value(stt, "context_max_gap_ms", 30000, "stt.context_max_gap_ms", errors);
+        engine.tap_path = stt.value("tap_path", "");
+        engine.tap_seconds = unsigned_value(stt, "tap_seconds", 300, "stt.tap_seconds", errors);
+
+        std::string overflow_policy = stt.value("overflow_policy", "drop_oldest");
+        if (overflow_policy == "merge") {
+            engine.overflow_policy = Engine::OverflowPolicy::MERGE;
+        } else if (overflow_policy == "downgrade") {
+            engine.overflow_policy = Engine::OverflowPolicy::DOWNGRADE;
+        } else if (overflow_policy != "drop_oldest") {
+            errors.push_back("stt.overflow_policy must be \"drop_oldest\", \"merge\" or \"downgrade\", not \"" +
+                             overflow_policy + "\"");
+        }
+    });
+
+    const json& model = section(stt, "model");
+    guarded("stt.model", [&] {
+        stt::ModelConfig& m = engine.model_config;
+        m.model_path = model.value("path", "models/ggml-small.en.bin");
+        m.language = model.value("language", "en");
+        m.use_gpu = model.value("use_gpu", true);
+        m.n_threads = model.value("n_threads", 4);
+        m.n_decoders = model.value("n_decoders", 1);
+        m.beam_size = model.value("beam_size", 5);
+        m.temperature = model.value("temperature", 0.0f);
+        m.translate = model.value("translate", false);
+        m.adaptive_audio_ctx = model.value("adaptive_audio_ctx", false);
+        m.audio_ctx_margin_ms = model.value("audio_ctx_margin_ms", 500);
+        m.audio_ctx_granularity = model.value("audio_ctx_granularity", 64);
+        m.cascade_decode = model.value("cascade_decode", false);
+        m.cascade_min_confidence = model.value("cascade_min_confidence", 0.6f);
+        m.cascade_min_avg_logprob = model.value("cascade_min_avg_logprob", -1.0f);
+        m.use_mmap = model.value("use_mmap", true);
+        engine.warm_up = model.value("warm_up", true);
+    });
+
+    // Streaming partials on a faster model; language follows the main model
+    const json& partial = section(stt, "partial_model");
+    guarded("stt.partial_model", [&] {
+        stt::ModelConfig& p = engine.partial_model_config;
+        p.model_path = partial.value("path", "");
+        p.language = engine.model_config.language;
+        p.translate = engine.model_config.translate;
+        p.use_gpu = partial.value("use_gpu", engine.model_config.use_gpu);
+        p.n_threads = partial.value("n_threads", 2);
+        p.n_decoders = partial.value("n_decoders", 1);
+    });
+
+    const json& vad = section(stt, "vad");
+    guarded("stt.vad", [&] {
+        audio::VADConfig& v = engine.vad_config;
+        std::string type = vad.value("type", "energy");
+        if (type == "spectral") {
+            v.type = VADType::SPECTRAL;
+        } else if (type == "neural") {
+            v.type = VADType::NEURAL;
+        } else if (type != "energy") {
+            errors.push_back("stt.vad.type must be \"energy\", \"spectral\" or \"neural\", not \"" + type + "\"");
+        }
+        v.energy_threshold = vad.value("energy_threshold", 0.001f);
+        v.speech_start_ms = vad.value("speech_start_ms", 150);
+        v.speech_end_ms = vad.value("speech_end_ms", 1000);
+        v.min_speech_ms = vad.value("min_speech_ms", 500);
+        v.speech_start_threshold = vad.value("speech_start_threshold", 1.08f);
+        v.speech_end_threshold = vad.value("speech_end_threshold", 0.85f);
+        v.pre_speech_buffer_ms = vad.value("pre_speech_buffer_ms", 500);
+        v.noise_floor_adaptation_rate = vad.value("noise_floor_adaptation_rate", 0.01f);
+        v.noise_floor_history_frames = vad.value("noise_floor_history_frames", 100);
+        v.noise_floor_percentile = vad.value("noise_floor_percentile", 0.2f);
+        v.spectral_flatness_max = vad.value("spectral_flatness_max", 0.30f);
+        v.spectral_entropy_max = vad.value("spectral_entropy_max", 0.90f);
+        v.spectral_centroid_min_hz = vad.value("spectral_centroid_min_hz", 300.0f);
+        v.spectral_centroid_max_hz = vad.value("spectral_centroid_max_hz", 3500.0f);
+        v.spectral_rolloff_max_hz = vad.value("spectral_rolloff_max_hz", 5000.0f);
+        v.neural_model_path = vad.value("neural_model_path", v.neural_model_path);
+        v.neural_threshold = vad.value("neural_threshold", 0.5f);
+        v.neural_batch_ms = vad.value("neural_batch_ms", 96);
+        v.neural_context_ms = vad.value("neural_context_ms", 192);
+        v.use_adaptive_threshold = vad.value("use_adaptive_threshold", true);
+    });
+
+    const json& audio_section = section(stt, "audio");
+    guarded("stt.audio", [&] {
+        audio::CaptureConfig& a = config.capture;
+        a.device_name = audio_section.value("device_name", "MOTU M2");
+        a.sample_rate = audio_section.value("sample_rate", 16000);
+        a.native_rate = audio_section.value("native_rate", false);
+        a.channels = audio_section.value("channels", 1);
+        a.buffer_size_ms = audio_section.value("buffer_size_ms", 30);
+        a.input_channel_index = audio_section.value("input_channel_index", 1);
+        a.force_single_channel = audio_section.value("force_single_channel", true);
+    });
+
+    // One capture per stream; each "stt.streams" entry overrides the device
+    // and channel of the base "stt.audio" settings
+    guarded("stt.streams", [&] {
+        auto streams = stt.find("streams");
+        if (streams == stt.end() || !streams->is_array() || streams->empty()) {
+            engine.stream_ids.push_back("default");
+            config.stream_captures.push_back(config.capture);
+            return;
+        }
+        for (const auto& def : *streams) {
+            audio::CaptureConfig capture = config.capture;
+            capture.device_name = def.value("device_name", config.capture.device_name);
+            capture.input_channel_index = def.value("input_channel_index", config.capture.input_channel_index);
+            capture.force_single_channel = def.value("force_single_channel", config.capture.force_single_channel);
+            engine.stream_ids.push_back(def.value("id", "stream" + std::to_string(config.stream_captures.size())));
+            config.stream_captures.push_back(capture);
+        }
+    });
+
+    guarded("ipc", [&] {
+        config.socket_path = section(document, "ipc").value("socket_path", config.socket_path);
+    });
+
+    bool parsed = errors.empty();
+    return validate(config, errors) && parsed;
+}
+
+bool ConfigManager::validate(const Config& config, std::vector<std::string>& errors) {
+    const size_t before = errors.size();
+    auto check = [&errors](bool ok, const std::string& message) {
+        if (!ok) errors.push_back(message);
+    };
+
+    const Engine::Config& engine = config.engine;
+    check(engine.partial_step_ms > 0, "stt.partial_step_ms must be positive");
+    check(engine.batch_max_ms >= engine.batch_max_utterance_ms,
+          "stt.batch_max_ms must be at least stt.batch_max_utterance_ms");
+    check(engine.tap_seconds > 0, "stt.tap_seconds must be positive");
+
+    const stt::ModelConfig& model = engine.model_config;
+    check(!model.model_path.empty(), "stt.model.path must not be empty");
+    check(!model.language.empty(), "stt.model.language must not be empty (\"auto\" detects it)");
+    check(model.n_threads >= 1, "stt.model.n_threads must be at least 1");
+    check(model.n_decoders >= 1, "stt.model.n_decoders must be at least 1");
+    check(model.beam_size >= 1, "stt.model.beam_size must be at least 1");
+    check(model.temperature >= 0.0f && model.temperature <= 1.0f, "stt.model.temperature must be within 0..1");
+    check(model.audio_ctx_margin_ms >= 0, "stt.model.audio_ctx_margin_ms must not be negative");
+    check(model.audio_ctx_granularity >= 1, "stt.model.audio_ctx_granularity must be at least 1");
+    check(model.cascade_min_confidence >= 0.0f && model.cascade_min_confidence <= 1.0f,
+          "stt.model.cascade_min_confidence must be within 0..1");
+    check(model.cascade_min_avg_logprob <= 0.0f, "stt.model.cascade_min_avg_logprob must not be positive");
+
+    if (!engine.partial_model_config.model_path.empty()) {
+        check(engine.partial_model_config.n_threads >= 1, "stt.partial_model.n_threads must be at least 1");
+        check(engine.partial_model_config.n_decoders >= 1, "stt.partial_model.n_decoders must be at least 1");
+    }
+
+    const audio::VADConfig& vad = engine.vad_config;
+    check(vad.energy_threshold >= 0.0f, "stt.vad.energy_threshold must not be negative");
+    check(vad.speech_start_threshold >= 0.0f, "stt.vad.speech_start_threshold must not be negative");
+    check(vad.speech_end_threshold >= 0.0f, "stt.vad.speech_end_threshold must not be negative");
+    check(vad.speech_start_ms >= 0, "stt.vad.speech_start_ms must not be negative");
+    check(vad.speech_end_ms > 0, "stt.vad.speech_end_ms must be positive");
+    check(vad.min_speech_ms >= 0, "stt.vad.min_speech_ms must not be negative");
+    check(vad.pre_speech_buffer_ms >= 0, "stt.vad.pre_speech_buffer_ms must not be negative");
+    check(vad.noise_floor_adaptation_rate >= 0.0f && vad.noise_floor_adaptation_rate <= 1.0f,
+          "stt.vad.noise_floor_adaptation_rate must be within 0..1");
+    check(vad.noise_floor_history_frames >= 1, "stt.vad.noise_floor_history_frames must be at least 1");
+    check(vad.noise_floor_percentile >= 0.0f && vad.noise_floor_percentile <= 1.0f,
+          "stt.vad.noise_floor_percentile must be within 0..1");
+    check(vad.spectral_centroid_min_hz <= vad.spectral_centroid_max_hz,
+          "stt.vad.spectral_centroid_min_hz must not exceed spectral_centroid_max_hz");
+    if (vad.type == VADType::NEURAL) {
+        check(!vad.neural_model_path.empty(), "stt.vad.neural_model_path must be set for the neural VAD");
+        check(vad.neural_threshold >= 0.0f && vad.neural_threshold <= 1.0f,
+              "stt.vad.neural_threshold must be within 0..1");
+        check(vad.neural_batch_ms > 0, "stt.vad.neural_batch_ms must be positive");
+        check(vad.neural_context_ms >= 0, "stt.vad.neural_context_ms must not be negative");
+    }
+
+    const audio::CaptureConfig& capture = config.capture;
+    check(capture.sample_rate > 0, "stt.audio.sample_rate must be positive");
+    check(capture.channels >= 1, "stt.audio.channels must be at least 1");
+    check(capture.buffer_size_ms > 0, "stt.audio.buffer_size_ms must be positive");
+    check(capture.input_channel_index >= 0, "stt.audio.input_channel_index must not be negative");
+
+    check(!engine.stream_ids.empty() && engine.stream_ids.size() == config.stream_captures.size(),
+          "stt.streams must list at least one stream");
+    std::set<std::string> ids;
+    for (const auto& id : engine.stream_ids) {
+        check(!id.empty(), "stt.streams ids must not be empty");
+        check(ids.insert(id).second, "stt.streams id \"" + id + "\" is used twice");
+    }
+    for (const auto& stream : config.stream_captures) {
+        check(stream.input_channel_index >= 0, "stt.streams input_channel_index must not be negative");
+    }
+
+    check(!config.socket_path.empty(), "ipc.socket_path must not be empty");
+
+    return errors.size() == before;
+}
+
+json ConfigManager::to_json(const Config& config) {
+    const Engine::Config& engine = config.engine;
+    const stt::ModelConfig& model = engine.model_config;
+    const audio::VADConfig& vad = engine.vad_config;
+    const audio::CaptureConfig& capture = config.capture;
+
+    json stt = {
+        {"mode", engine.mode == Engine::TranscriptionMode::STREAMING ? "streaming" : "utterance"},
+        {"partial_step_ms", engine.partial_step_ms},
+        {"max_queue_size", engine.max_queue_size},
+        {"overflow_policy", overflow_policy_name(engine.overflow_policy)},
+        {"batch_short_utterances", engine.batch_short_utterances},
+        {"batch_max_utterance_ms", engine.batch_max_utterance_ms},
+        {"batch_max_ms", engine.batch_max_ms},
+        {"segment_metadata", engine.segment_metadata},
+        {"carry_context", engine.carry_context},
+        {"context_max_tokens", engine.context_max_tokens},
+        {"context_max_gap_ms", engine.context_max_gap_ms},
+        {"tap_path", engine.tap_path},
+        {"tap_seconds", engine.tap_seconds}
+    };
+    stt["model"] = {
+        {"path", model.model_path},
+        {"language", model.language},
+        {"use_gpu", model.use_gpu},
+        {"n_threads", model.n_threads},
+        {"n_decoders", model.n_decoders},
+        {"beam_size", model.beam_size},
+        {"temperature", model.temperature},
+        {"translate", model.translate},
+        {"adaptive_audio_ctx", model.adaptive_audio_ctx},
+        {"audio_ctx_margin_ms", model.audio_ctx_margin_ms},
+        {"audio_ctx_granularity", model.audio_ctx_granularity},
+        {"cascade_decode", model.cascade_decode},
+        {"cascade_min_confidence", model.cascade_min_confidence},
+        {"cascade_min_avg_logprob", model.cascade_min_avg_logprob},
+        {"use_mmap", model.use_mmap},
+        {"warm_up", engine.warm_up}
+    };
+    if (!engine.partial_model_config.model_path.empty()) {
+        stt["partial_model"] = {
+            {"path", engine.partial_model_config.model_path},
+            {"use_gpu", engine.partial_model_config.use_gpu},
+            {"n_threads", engine.partial_model_config.n_threads},
+            {"n_decoders", engine.partial_model_config.n_decoders}
+        };
+    }
+    stt["vad"] = {
+        {"type", vad_type_name(vad.type)},
+        {"energy_threshold", vad.energy_threshold},
+        {"speech_start_ms", vad.speech_start_ms},
+        {"speech_end_ms", vad.speech_end_ms},
+        {"min_speech_ms", vad.min_speech_ms},
+        {"speech_start_threshold", vad.speech_start_threshold},
+        {"speech_end_threshold", vad.speech_end_threshold},
+        {"pre_speech_buffer_ms", vad.pre_speech_buffer_ms},
+        {"noise_floor_adaptation_rate", vad.noise_floor_adaptation_rate},
+        {"noise_floor_history_frames", vad.noise_floor_history_frames},
+        {"noise_floor_percentile", vad.noise_floor_percentile},
+        {"use_adaptive_threshold", vad.use_adaptive_threshold},
+        {"spectral_flatness_max", vad.spectral_flatness_max},
+        {"spectral_entropy_max", vad.spectral_entropy_max},
+        {"spectral_centroid_min_hz", vad.spectral_centroid_min_hz},
+        {"spectral_centroid_max_hz", vad.spectral_centroid_max_hz},
+        {"spectral_rolloff_max_hz", vad.spectral_rolloff_max_hz},
+        {"neural_model_path", vad.neural_model_path},
+        {"neural_threshold", vad.neural_threshold},
+        {"neural_batch_ms", vad.neural_batch_ms},
+        {"neural_context_ms", vad.neural_context_ms}
+    };
+    stt["audio"] = {
+        {"device_name", capture.device_name},
+        {"sample_rate", capture.sample_rate},
+        {"native_rate", capture.native_rate},
+        {"channels", capture.channels},
+        {"buffer_size_ms", capture.buffer_size_ms},
+        {"input_channel_index", capture.input_channel_index},
+        {"force_single_channel", capture.force_single_channel}
+    };
+
+    // The implicit single stream needs no entry
+    bool implicit = engine.stream_ids.size() == 1 && engine.stream_ids[0] == "default";
+    if (!implicit) {
+        stt["streams"] = json::array();
+        for (size_t i = 0; i < engine.stream_ids.size() && i < config.stream_captures.size(); ++i) {
+            stt["streams"].push_back({
+                {"id", engine.stream_ids[i]},
+                {"device_name", config.stream_captures[i].device_name},
+                {"input_channel_index", config.stream_captures[i].input_channel_index},
+                {"force_single_channel", config.stream_captures[i].force_single_channel}
+            });
+        }
+    }
+
+    return {
+        {"stt", stt},
+        {"ipc", {{"socket_path", config.socket_path}}}
+    };
+}
+
+json ConfigManager::to_ipc_json(const Config& config) {
+    json file = to_json(config);
+    json& stt = file["stt"];
+
+    json ipc;
+    ipc["model_config"] = stt["model"];
+    ipc["model_config"]["model_path"] = ipc["model_config"]["path"];
+    ipc["model_config"].erase("path");
+
+    const stt::ModelConfig& partial = config.engine.partial_model_config;
+    ipc["partial_model_config"] = {
+        {"model_path", partial.model_path},
+        {"use_gpu", partial.use_gpu},
+        {"n_threads", partial.n_threads},
+        {"n_decoders", partial.n_decoders}
+    };
+    ipc["vad_config"] = stt["vad"];
+    ipc["audio_capture_config"] = stt["audio"];
+
+    ipc["streams"] = json::array();
+    for (size_t i = 0; i < config.engine.stream_ids.size() && i < config.stream_captures.size(); ++i) {
+        ipc["streams"].push_back({
+            {"id", config.engine.stream_ids[i]},
+            {"device_name", config.stream_captures[i].device_name},
+            {"input_channel_index", config.stream_captures[i].input_channel_index},
+            {"force_single_channel", config.stream_captures[i].force_single_channel}
+        });
+    }
+    ipc["ipc_socket_path"] = config.socket_path;
+    return ipc;
+}
+
+json ConfigManager::ipc_patch_to_file(const json& patch) {
+    json file = json::object();
+    if (!patch.is_object()) return file;
+
+    auto model_section = [](json section) {
+        if (section.is_object() && section.contains("model_path")) {
+            section["path"] = section["model_path"];
+            section.erase("model_path");
+        }
+        return section;
+    };
+
+    for (auto it = patch.begin(); it != patch.end(); ++it) {
+        const std::string& key = it.key();
+        if (key == "model_config") {
+            file["stt"]["model"] = model_section(it.value());
+        } else if (key == "partial_model_config") {
+            file["stt"]["partial_model"] = model_section(it.value());
+        } else if (key == "vad_config") {
+            file["stt"]["vad"] = it.value();
+        } else if (key == "audio_capture_config") {
+            file["stt"]["audio"] = it.value();
+        } else if (key == "streams") {
+            file["stt"]["streams"] = it.value();
+        } else if (key == "ipc_socket_path") {
+            file["ipc"]["socket_path"] = it.value();
+        } else {
+            // Already in the file schema ("stt", "ipc", ...)
+            file[key] = it.value();
+        }
+    }
+    return file;
+}
+
+std::vector<std::string> ConfigManager::restart_required(const Config& previous, const Config& current) {
+    std::vector<std::string> settings;
+    json before = to_json(previous);
+    json after = to_json(current);
+
+    // Model and VAD settings apply live (STTEngine::update_model_config,
+    // update_vad_config); everything else is read once at startup
+    std::set<std::string> keys;
+    for (auto it = before["stt"].begin(); it != before["stt"].end(); ++it) keys.insert(it.key());
+    for (auto it = after["stt"].begin(); it != after["stt"].end(); ++it) keys.insert(it.key());
+    for (const auto& key : keys) {
+        if (key == "model" || key == "vad") continue;
+        const json& old_value = before["stt"].contains(key) ? before["stt"][key] : json();
+        const json& new_value = after["stt"].contains(key) ? after["stt"][key] : json();
+        if (old_value != new_value) {
+            settings.push_back("stt." + key);
+        }
+    }
+
+    // Load-time model settings wait for the next model load
+    const stt::ModelConfig& old_model = previous.engine.model_config;
+    const stt::ModelConfig& new_model = current.engine.model_config;
+    if (old_model.model_path == new_model.model_path) {
+        for (const char* key : {"n_threads", "n_decoders", "use_gpu", "use_mmap", "warm_up"}) {
+            if (before["stt"]["model"][key] != after["stt"]["model"][key]) {
+                settings.push_back(std::string("stt.model.") + key);
+            }
+        }
+    }
+
+    if (before["ipc"] != after["ipc"]) {
+        settings.push_back("ipc");
+    }
+    return settings;
+}
 
 } // namespace config
 } // namespace rt_stt
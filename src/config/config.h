@@ -1,31 +1,104 @@
 #ifndef CONFIG_H
 #define CONFIG_H
 
+#include "stt/engine.h"
+#include "audio/capture.h"
+#include <nlohmann/json.hpp>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <vector>
 
 namespace rt_stt {
 namespace config {
 
+// Everything the daemon reads from its configuration file, parsed and
+// validated in one go
 struct Config {
-    std::string model_path = "models/ggml-base.en.bin";
-    std::string language = "en";
-    int threads = 4;
-    bool gpu_enabled = true;
+    stt::STTEngine::Config engine;
+    audio::CaptureConfig capture;                    // stt.audio
+    std::vector<audio::CaptureConfig> stream_captures; // One per engine.stream_ids entry
+    std::string socket_path = "/tmp/rt-stt.sock";    // ipc.socket_path
 };
 
+// Snapshots are never modified once published: a change builds a new one
+// and swaps the pointer, so a reader holding one never sees half a file
+using Snapshot = std::shared_ptr<const Config>;
+
 class ConfigManager {
 public:
-    ConfigManager() = default;
-    ~ConfigManager() = default;
-    
-    bool load(const std::string& path) { return true; }
-    bool save(const std::string& path) { return true; }
-    
-    Config get() const { return config_; }
-    void set(const Config& config) { config_ = config; }
-    
+    // Called after every published change, on the thread that published it
+    // (update() caller or the file watcher), one change at a time
+    using ChangeCallback = std::function<void(const Snapshot& previous, const Snapshot& current)>;
+
+    ConfigManager();   // Starts out with the defaults of an empty file
+    ~ConfigManager();
+
+    ConfigManager(const ConfigManager&) = delete;
+    ConfigManager& operator=(const ConfigManager&) = delete;
+
+    // Parse and validate path and publish the result. On any error the
+    // current snapshot stays and the problems go to std::cerr. The path is
+    // remembered for save() and watch() either way.
+    bool load(const std::string& path);
+
+    // Write the current snapshot to path (default: the loaded one),
+    // through a temporary file so the watcher never reads a partial file
+    bool save(const std::string& path = "") const;
+
+    Snapshot get() const { return std::atomic_load(&current_); }
+    const std::string& get_path() const { return path_; }
+    void set_path(const std::string& path) { path_ = path; }  // For a file that does not exist yet
+
+    // Merge patch (file schema, RFC 7396 merge) into the current config,
+    // validate the result and publish it. Returns the snapshot it replaced,
+    // or null with errors filled in, in which case nothing changes.
+    Snapshot update(const nlohmann::json& patch, std::vector<std::string>& errors);
+
+    void set_change_callback(ChangeCallback callback) { change_callback_ = std::move(callback); }
+
+    // Reload the file whenever it changes on disk. The watcher polls its
+    // modification time, size and inode, so in-place edits and editors
+    // that replace the file both count; an invalid edit is reported and
+    // ignored until the file changes again.
+    bool watch(std::chrono::milliseconds interval = std::chrono::milliseconds(1000));
+    void stop_watching();
+
+    // File schema <-> Config. parse fills config from the document, taking
+    // defaults for anything missing, and then validates it; every problem
+    // found is appended to errors.
+    static bool parse(const nlohmann::json& json, Config& config, std::vector<std::string>& errors);
+    static bool validate(const Config& config, std::vector<std::string>& errors);
+    static nlohmann::json to_json(const Config& config);
+
+    // The flatter view get_config/set_config use over IPC ("model_config",
+    // "vad_config", "audio_capture_config", ...), and the translation of a
+    // set_config patch into the file schema
+    static nlohmann::json to_ipc_json(const Config& config);
+    static nlohmann::json ipc_patch_to_file(const nlohmann::json& patch);
+
+    // Top-level settings (e.g. "stt.audio") that differ between two
+    // configs but only take effect when the daemon restarts
+    static std::vector<std::string> restart_required(const Config& previous, const Config& current);
+
 private:
-    Config config_;
+    Snapshot current_;            // atomic_load / atomic_store only
+    std::string path_;
+    mutable std::mutex update_mutex_;  // Serializes publishing and the change callback
+    ChangeCallback change_callback_;
+
+    std::thread watcher_;
+    std::atomic<bool> watching_{false};
+    std::mutex watch_mutex_;
+    std::condition_variable watch_cv_;
+
+    Snapshot publish(Snapshot next);   // Under update_mutex_
+    void watch_loop(std::chrono::milliseconds interval);
 };
 
 } // namespace config
@@ -1,18 +1,27 @@
 #include "ipc/server.h"
 #include <sys/socket.h>
 #include <sys/un.h>
+#include <sys/uio.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <iostream>
 #include <cstring>
+#include <cerrno>
 #include <algorithm>
 #include <mutex>
+#include <condition_variable>
 #include <map>
+#include <set>
 #include <sstream>
 #include <chrono>
 #include <arpa/inet.h>
 
-// macOS doesn't have MSG_NOSIGNAL, use SO_NOSIGPIPE instead
+#ifdef __APPLE__
+#include <sys/event.h>
+#else
+#include <sys/epoll.h>
+#endif
+
 // macOS doesn't have MSG_NOSIGNAL, we use SO_NOSIGPIPE instead
 #ifndef MSG_NOSIGNAL
 #ifdef __APPLE__
@@ -25,18 +34,309 @@
 namespace rt_stt {
 namespace ipc {
 
+namespace {
+
+constexpr uint32_t MAX_MESSAGE_BYTES = 1024 * 1024;
+constexpr int MAX_EVENTS = 64;
+constexpr size_t READ_CHUNK_BYTES = 64 * 1024;
+constexpr int MAX_WRITE_IOVECS = 64;    // Well under IOV_MAX everywhere
+constexpr size_t COMMAND_THREADS = 4;   // Commands that may run at once, one per client
+
+bool set_nonblocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+bool would_block(int err) {
+    return err == EAGAIN || err == EWOULDBLOCK;
+}
+
+// Thin readiness layer over kqueue (macOS) and epoll (Linux). Every fd is
+// watched for reads; write interest is toggled only while a client has
+// queued output.
+struct PollEvent {
+    int fd;
+    bool readable;
+    bool writable;
+    bool hangup;
+};
+
+int poller_create() {
+#ifdef __APPLE__
+    return kqueue();
+#else
+    return epoll_create1(EPOLL_CLOEXEC);
+#endif
+}
+
+bool poller_add(int poller, int fd) {
+#ifdef __APPLE__
+    struct kevent ev;
+    EV_SET(&ev, fd, EVFILT_READ, EV_ADD, 0, 0, nullptr);
+    return kevent(poller, &ev, 1, nullptr, 0, nullptr) == 0;
+#else
+    struct epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.fd = fd;
+    return epoll_ctl(poller, EPOLL_CTL_ADD, fd, &ev) == 0;
+#endif
+}
+
+bool poller_set_write(int poller, int fd, bool enable) {
+#ifdef __APPLE__
+    struct kevent ev;
+    EV_SET(&ev, fd, EVFILT_WRITE, enable ? EV_ADD : EV_DELETE, 0, 0, nullptr);
+    return kevent(poller, &ev, 1, nullptr, 0, nullptr) == 0;
+#else
+    struct epoll_event ev = {};
+    ev.events = enable ? (EPOLLIN | EPOLLOUT) : EPOLLIN;
+    ev.data.fd = fd;
+    return epoll_ctl(poller, EPOLL_CTL_MOD, fd, &ev) == 0;
+#endif
+}
+
+void poller_remove(int poller, int fd) {
+#ifdef __APPLE__
+    // Closing the fd drops its kevents; this just makes removal explicit
+    struct kevent ev[2];
+    EV_SET(&ev[0], fd, EVFILT_READ, EV_DELETE, 0, 0, nullptr);
+    EV_SET(&ev[1], fd, EVFILT_WRITE, EV_DELETE, 0, 0, nullptr);
+    kevent(poller, ev, 2, nullptr, 0, nullptr);
+#else
+    epoll_ctl(poller, EPOLL_CTL_DEL, fd, nullptr);
+#endif
+}
+
+int poller_wait(int poller, PollEvent* events, int max_events) {
+#ifdef __APPLE__
+    struct kevent raw[MAX_EVENTS];
+    int n = kevent(poller, nullptr, 0, raw, std::min(max_events, MAX_EVENTS), nullptr);
+    for (int i = 0; i < n; ++i) {
+        events[i].fd = static_cast<int>(raw[i].ident);
+        events[i].readable = raw[i].filter == EVFILT_READ;
+        events[i].writable = raw[i].filter == EVFILT_WRITE;
+        events[i].hangup = (raw[i].flags & (EV_EOF | EV_ERROR)) != 0;
+    }
+    return n;
+#else
+    struct epoll_event raw[MAX_EVENTS];
+    int n = epoll_wait(poller, raw, std::min(max_events, MAX_EVENTS), -1);
+    for (int i = 0; i < n; ++i) {
+        events[i].fd = raw[i].data.fd;
+        events[i].readable = (raw[i].events & EPOLLIN) != 0;
+        events[i].writable = (raw[i].events & EPOLLOUT) != 0;
+        events[i].hangup = (raw[i].events & (EPOLLHUP | EPOLLERR)) != 0;
+    }
+    return n;
+#endif
+}
+
+bool parse_encoding(const std::string& name, Encoding& encoding) {
+    if (name == "json") encoding = Encoding::JSON;
+    else if (name == "msgpack") encoding = Encoding::MSGPACK;
+    else if (name == "cbor") encoding = Encoding::CBOR;
+    else return false;
+    return true;
+}
+
+const char* encoding_name(Encoding encoding) {
+    switch (encoding) {
+        case Encoding::MSGPACK: return "msgpack";
+        case Encoding::CBOR: return "cbor";
+        default: return "json";
+    }
+}
+
+// Serialize and length-prefix a message; null if it cannot be encoded
+Frame frame_message(const Message& msg, Encoding encoding = Encoding::JSON) {
+    nlohmann::json json_msg = {
+        {"type", msg.type},
+        {"id", msg.id},
+        {"data", msg.data}
+    };
+    
+    std::string serialized;
+    try {
+        switch (encoding) {
+            case Encoding::MSGPACK: {
+                auto bytes = nlohmann::json::to_msgpack(json_msg);
+                serialized.assign(bytes.begin(), bytes.end());
+                break;
+            }
+            case Encoding::CBOR: {
+                auto bytes = nlohmann::json::to_cbor(json_msg);
+                serialized.assign(bytes.begin(), bytes.end());
+                break;
+            }
+            default:
+                serialized = json_msg.dump();
+                break;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Failed to serialize message: " << e.what() << std::endl;
+        return nullptr;
+    }
+    
+    // Length prefix for proper framing (not including newline)
+    uint32_t length = htonl(static_cast<uint32_t>(serialized.length()));
+    auto frame = std::make_shared<std::string>();
+    frame->reserve(sizeof(length) + serialized.length());
+    frame->append(reinterpret_cast<const char*>(&length), sizeof(length));
+    frame->append(serialized);
+    return frame;
+}
+
+// Broadcast helper: encodes the message at most once per encoding in use
+struct FrameCache {
+    const Message& msg;
+    Frame frames[3];
+    bool failed[3] = {false, false, false};
+    
+    explicit FrameCache(const Message& m) : msg(m) {}
+    
+    const Frame& get(Encoding encoding) {
+        size_t i = static_cast<size_t>(encoding);
+        if (!frames[i] && !failed[i]) {
+            frames[i] = frame_message(msg, encoding);
+            failed[i] = !frames[i];
+        }
+        return frames[i];
+    }
+};
+
+// Validate and apply SUBSCRIBE options; a bare SUBSCRIBE resets to the full stream
+bool parse_subscription(const nlohmann::json& data, Subscription& subscription, std::string& error) {
+    Subscription parsed;
+    if (data.is_object()) {
+        try {
+            if (data.contains("fields")) {
+                for (const auto& field : data["fields"]) {
+                    parsed.fields.push_back(field.get<std::string>());
+                }
+                std::sort(parsed.fields.begin(), parsed.fields.end());
+                parsed.fields.erase(std::unique(parsed.fields.begin(), parsed.fields.end()),
+                                    parsed.fields.end());
+            }
+            parsed.min_confidence = data.value("min_confidence", 0.0f);
+            parsed.finals_only = data.value("finals_only", false);
+            parsed.partials_only = data.value("partials_only", false);
+            parsed.stream_id = data.value("stream_id", "");
+        } catch (const std::exception& e) {
+            error = std::string("Invalid subscription: ") + e.what();
+            return false;
+        }
+    }
+    
+    if (parsed.finals_only && parsed.partials_only) {
+        error = "Invalid subscription: finals_only and partials_only are exclusive";
+        return false;
+    }
+    
+    subscription = std::move(parsed);
+    return true;
+}
+
+nlohmann::json subscription_to_json(const Subscription& subscription) {
+    return {
+        {"fields", subscription.fields},
+        {"min_confidence", subscription.min_confidence},
+        {"finals_only", subscription.finals_only},
+        {"partials_only", subscription.partials_only},
+        {"stream_id", subscription.stream_id}
+    };
+}
+
+// Transcription restricted to a field list, with its per-encoding frames
+struct Projection {
+    Message msg;
+    FrameCache frames;
+    
+    Projection(const Message& full, const std::vector<std::string>& fields)
+        : msg{full.type, full.id, nlohmann::json::object()}, frames(msg) {
+        for (const auto& field : fields) {
+            auto it = full.data.find(field);
+            if (it != full.data.end()) {
+                msg.data[field] = *it;
+            }
+        }
+    }
+};
+
+// Msgpack maps start 0x80-0x8f/0xde/0xdf and CBOR maps 0xa0-0xbf; neither
+// can be confused with a JSON object
+nlohmann::json decode_payload(const char* data, size_t size) {
+    uint8_t first = size > 0 ? static_cast<uint8_t>(data[0]) : 0;
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+    
+    if ((first & 0xF0) == 0x80 || first == 0xde || first == 0xdf) {
+        return nlohmann::json::from_msgpack(bytes, bytes + size);
+    }
+    if ((first & 0xE0) == 0xA0) {
+        return nlohmann::json::from_cbor(bytes, bytes + size);
+    }
+    return nlohmann::json::parse(data, data + size);
+}
+
+} // namespace
+
+bool Subscription::matches(const nlohmann::json& transcription) const {
+    bool is_final = transcription.value("is_final", true);
+    if (finals_only && !is_final) return false;
+    if (partials_only && is_final) return false;
+    if (transcription.value("confidence", 1.0f) < min_confidence) return false;
+    if (!stream_id.empty() && transcription.value("stream_id", "default") != stream_id) return false;
+    return true;
+}
+
+bool Subscription::wants(const std::string& field) const {
+    return fields.empty() || std::binary_search(fields.begin(), fields.end(), field);
+}
+
 struct Server::Impl {
     std::string socket_path;
     int server_socket = -1;
-    std::thread accept_thread;
     
-    // Client management
+    // Event loop
+    int poller = -1;
+    int wake_pipe[2] = {-1, -1};
+    std::thread loop_thread;
+    
+    // Client management. The map is only modified on the loop thread;
+    // broadcasts from other threads lock it to queue output.
     std::mutex clients_mutex;
     std::map<int, std::unique_ptr<ClientInfo>> clients;
     int next_client_id = 1;
     
+    // Commands run on worker threads so a slow handler never stalls the
+    // loop; one client's commands still run, and are answered, in order
+    struct CommandJob {
+        int client_fd;
+        std::string client_id;  // The fd may be reused once the client leaves
+        Message msg;
+    };
+    std::mutex command_mutex;
+    std::condition_variable command_cv;
+    std::deque<CommandJob> command_queue;
+    std::set<std::string> busy_clients;  // Clients with a command running
+    std::vector<std::thread> command_threads;
+    bool commands_running = false;       // Guarded by command_mutex
+    
+    void close_loop_fds() {
+        if (poller >= 0) {
+            close(poller);
+            poller = -1;
+        }
+        for (int& fd : wake_pipe) {
+            if (fd >= 0) {
+                close(fd);
+                fd = -1;
+            }
+        }
+    }
+    
     // Socket cleanup on destruction
     ~Impl() {
+        close_loop_fds();
         if (server_socket >= 0) {
             close(server_socket);
         }
@@ -84,7 +384,7 @@ bool Server::initialize(const std::string& socket_path) {
     }
     
     // Listen for connections
-    if (listen(impl_->server_socket, 10) < 0) {
+    if (listen(impl_->server_socket, 64) < 0 || !set_nonblocking(impl_->server_socket)) {
         std::cerr << "Failed to listen on socket: " << strerror(errno) << std::endl;
         close(impl_->server_socket);
         impl_->server_socket = -1;
@@ -106,11 +406,29 @@ bool Server::start() {
         return false;
     }
     
+    // The wake pipe lets other threads interrupt the poll (stop, evictions)
+    impl_->poller = poller_create();
+    if (impl_->poller < 0 || pipe(impl_->wake_pipe) < 0 ||
+        !set_nonblocking(impl_->wake_pipe[0]) || !set_nonblocking(impl_->wake_pipe[1]) ||
+        !poller_add(impl_->poller, impl_->server_socket) ||
+        !poller_add(impl_->poller, impl_->wake_pipe[0])) {
+        std::cerr << "Failed to set up IPC event loop: " << strerror(errno) << std::endl;
+        impl_->close_loop_fds();
+        return false;
+    }
+    
     running_ = true;
     shutdown_requested_ = false;
     
-    // Start accept thread
-    impl_->accept_thread = std::thread(&Server::accept_connections, this);
+    impl_->loop_thread = std::thread(&Server::event_loop, this);
+    
+    {
+        std::lock_guard<std::mutex> lock(impl_->command_mutex);
+        impl_->commands_running = true;
+    }
+    for (size_t i = 0; i < COMMAND_THREADS; ++i) {
+        impl_->command_threads.emplace_back(&Server::command_loop, this);
+    }
     
     std::cout << "IPC server started" << std::endl;
     return true;
@@ -122,27 +440,36 @@ void Server::stop() {
     }
     
     shutdown_requested_ = true;
+    wake_loop();
     
-    // Close server socket to wake up accept()
-    if (impl_->server_socket >= 0) {
-        ::shutdown(impl_->server_socket, SHUT_RDWR);
+    if (impl_->loop_thread.joinable()) {
+        impl_->loop_thread.join();
     }
     
-    // Wait for accept thread
-    if (impl_->accept_thread.joinable()) {
-        impl_->accept_thread.join();
+    // Commands not started yet are dropped; running ones finish first
+    {
+        std::lock_guard<std::mutex> lock(impl_->command_mutex);
+        impl_->commands_running = false;
+        impl_->command_queue.clear();
     }
+    impl_->command_cv.notify_all();
+    for (auto& worker : impl_->command_threads) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+    impl_->command_threads.clear();
     
     // Close all client connections
     {
         std::lock_guard<std::mutex> lock(impl_->clients_mutex);
         for (auto& [fd, client] : impl_->clients) {
             close(fd);
-            if (client->handler_thread.joinable()) {
-                client->handler_thread.join();
-            }
         }
         impl_->clients.clear();
+        
+        // Broadcasts touch the poller and wake pipe under this lock
+        impl_->close_loop_fds();
     }
     
     running_ = false;
@@ -163,8 +490,64 @@ void Server::shutdown() {
     }
 }
 
-void Server::accept_connections() {
+void Server::wake_loop() {
+    if (impl_->wake_pipe[1] >= 0) {
+        char byte = 1;
+        // A full pipe already guarantees a wakeup
+        (void)!write(impl_->wake_pipe[1], &byte, 1);
+    }
+}
+
+void Server::event_loop() {
+    PollEvent events[MAX_EVENTS];
+    
     while (!shutdown_requested_.load()) {
+        int n = poller_wait(impl_->poller, events, MAX_EVENTS);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "IPC event loop failed: " << strerror(errno) << std::endl;
+            break;
+        }
+        
+        for (int i = 0; i < n && !shutdown_requested_.load(); ++i) {
+            const PollEvent& ev = events[i];
+            
+            if (ev.fd == impl_->server_socket) {
+                accept_clients();
+                continue;
+            }
+            
+            if (ev.fd == impl_->wake_pipe[0]) {
+                char drain[64];
+                while (read(impl_->wake_pipe[0], drain, sizeof(drain)) > 0) {}
+                continue;
+            }
+            
+            bool keep = true;
+            if (ev.readable || ev.hangup) {
+                keep = read_client(ev.fd);
+            }
+            
+            std::lock_guard<std::mutex> lock(impl_->clients_mutex);
+            auto it = impl_->clients.find(ev.fd);
+            if (it == impl_->clients.end()) continue;
+            
+            if (keep && ev.writable && !it->second->evict) {
+                keep = flush_client(*it->second);
+            }
+            if (!keep) {
+                it->second->evict = true;
+            }
+        }
+        
+        // Close disconnected and evicted clients only after the batch, so a
+        // stale event can never touch a reused fd
+        update_clients();
+    }
+}
+
+void Server::accept_clients() {
+    while (true) {
         struct sockaddr_un client_addr;
         socklen_t client_len = sizeof(client_addr);
         
@@ -172,11 +555,11 @@ void Server::accept_connections() {
                              (struct sockaddr*)&client_addr, &client_len);
         
         if (client_fd < 0) {
-            if (shutdown_requested_.load()) {
-                break;
+            if (errno == EINTR) continue;
+            if (!would_block(errno)) {
+                std::cerr << "Failed to accept connection: " << strerror(errno) << std::endl;
             }
-            std::cerr << "Failed to accept connection: " << strerror(errno) << std::endl;
-            continue;
+            return;
         }
         
         // On macOS, disable SIGPIPE on the socket
@@ -185,169 +568,273 @@ void Server::accept_connections() {
         setsockopt(client_fd, SOL_SOCKET, SO_NOSIGPIPE, &nosigpipe, sizeof(nosigpipe));
 #endif
         
+        if (!set_nonblocking(client_fd) || !poller_add(impl_->poller, client_fd)) {
+            std::cerr << "Failed to register client: " << strerror(errno) << std::endl;
+            close(client_fd);
+            continue;
+        }
+        
         // Create client info
         auto client = std::make_unique<ClientInfo>();
         client->socket_fd = client_fd;
         client->id = "client_" + std::to_string(impl_->next_client_id++);
         client->subscribed_to_transcriptions = true; // Default to subscribed
         
-        // Start client handler thread
-        client->handler_thread = std::thread(&Server::handle_client, this, client_fd);
-        
-        // Store client
         {
             std::lock_guard<std::mutex> lock(impl_->clients_mutex);
             impl_->clients[client_fd] = std::move(client);
         }
         
         std::cout << "Client connected: fd=" << client_fd << std::endl;
+        notify_subscriptions();
     }
 }
 
-void Server::handle_client(int client_fd) {
-    while (!shutdown_requested_.load()) {
+bool Server::read_client(int client_fd) {
+    // Only the loop thread erases clients, so the pointer outlives the lock
+    ClientInfo* client = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(impl_->clients_mutex);
+        auto it = impl_->clients.find(client_fd);
+        if (it == impl_->clients.end() || it->second->evict) {
+            return true;
+        }
+        client = it->second.get();
+    }
+    
+    bool connected = true;
+    char chunk[READ_CHUNK_BYTES];
+    while (true) {
+        ssize_t received = recv(client_fd, chunk, sizeof(chunk), 0);
+        if (received > 0) {
+            client->read_buffer.append(chunk, received);
+            continue;
+        }
+        if (received < 0 && errno == EINTR) continue;
+        if (received < 0 && would_block(errno)) break;
+        connected = false;  // EOF or error; still handle what already arrived
+        break;
+    }
+    
+    // Dispatch every complete length-prefixed frame
+    std::string& buffer = client->read_buffer;
+    size_t offset = 0;
+    while (buffer.size() - offset >= sizeof(uint32_t)) {
+        uint32_t length_prefix;
+        memcpy(&length_prefix, buffer.data() + offset, sizeof(length_prefix));
+        uint32_t length = ntohl(length_prefix);
+        if (length > MAX_MESSAGE_BYTES) {
+            std::cerr << "Message too large: " << length << std::endl;
+            return false;
+        }
+        if (buffer.size() - offset - sizeof(length_prefix) < length) {
+            break;
+        }
+        
         Message msg;
-        if (!receive_message(client_fd, msg)) {
-            break; // Client disconnected
+        try {
+            auto json_msg = decode_payload(buffer.data() + offset + sizeof(length_prefix), length);
+            
+            msg.type = static_cast<Message::Type>(json_msg["type"].get<int>());
+            msg.id = json_msg.value("id", "");
+            msg.data = json_msg["data"];
+        } catch (const std::exception& e) {
+            std::cerr << "Failed to receive message: " << e.what() << std::endl;
+            return false;
         }
+        offset += sizeof(length_prefix) + length;
         
         process_message(client_fd, msg);
     }
+    buffer.erase(0, offset);
     
-    cleanup_client(client_fd);
+    return connected;
 }
 
-bool Server::send_message(int client_fd, const Message& msg) {
-    try {
-        nlohmann::json json_msg = {
-            {"type", msg.type},
-            {"id", msg.id},
-            {"data", msg.data}
-        };
-        
-        std::string serialized = json_msg.dump();
-        
-        // Send with length prefix for proper framing (not including newline)
-        uint32_t length = htonl(serialized.length());
-        if (send(client_fd, &length, sizeof(length), MSG_NOSIGNAL) != sizeof(length)) {
-            return false;
-        }
-        
-        // Send message
-        size_t total_sent = 0;
-        while (total_sent < serialized.length()) {
-            ssize_t sent = send(client_fd, serialized.c_str() + total_sent, 
-                              serialized.length() - total_sent, MSG_NOSIGNAL);
-            if (sent <= 0) {
-                return false;
+void Server::update_clients() {
+    std::vector<int> closing;
+    {
+        std::lock_guard<std::mutex> lock(impl_->clients_mutex);
+        for (auto& [fd, client] : impl_->clients) {
+            if (client->evict) {
+                closing.push_back(fd);
             }
-            total_sent += sent;
         }
-        
-        return true;
-    } catch (const std::exception& e) {
-        std::cerr << "Failed to send message: " << e.what() << std::endl;
+    }
+    
+    for (int fd : closing) {
+        cleanup_client(fd);
+    }
+}
+
+bool Server::send_message(int client_fd, const Message& msg, const std::string& client_id) {
+    // Framed under the lock: a command reply may race a SUBSCRIBE that
+    // switches the client's encoding
+    std::lock_guard<std::mutex> lock(impl_->clients_mutex);
+    auto it = impl_->clients.find(client_fd);
+    if (it == impl_->clients.end() || it->second->evict) {
+        return false;
+    }
+    if (!client_id.empty() && it->second->id != client_id) {
+        return false;
+    }
+    
+    Frame frame = frame_message(msg, it->second->encoding);
+    if (!frame) {
         return false;
     }
+    queue_frame(*it->second, frame);
+    return !it->second->evict;
 }
 
-bool Server::receive_message(int client_fd, Message& msg) {
-    try {
-        // Read length prefix
-        uint32_t length_prefix;
-        if (recv(client_fd, &length_prefix, sizeof(length_prefix), MSG_WAITALL) != sizeof(length_prefix)) {
-            return false;
+void Server::queue_frame(ClientInfo& client, const Frame& frame) {
+    if (client.evict) return;
+    
+    client.queued_bytes += frame->size();
+    client.write_queue.push_back(frame);
+    
+    // Write straight through when the socket has room; only the remainder
+    // waits for the loop
+    if (!flush_client(client)) {
+        client.evict = true;
+        evicted_count_++;
+        wake_loop();
+        return;
+    }
+    
+    if (client.queued_bytes > client_high_water_.load()) {
+        std::cerr << "Disconnecting slow client " << client.id << " ("
+                  << client.queued_bytes << " bytes unsent)" << std::endl;
+        client.evict = true;
+        evicted_count_++;
+        wake_loop();
+    }
+}
+
+bool Server::flush_client(ClientInfo& client) {
+    while (!client.write_queue.empty()) {
+        // Gather as many queued frames as fit into one call
+        struct iovec iov[MAX_WRITE_IOVECS];
+        int n_iov = 0;
+        for (const Frame& frame : client.write_queue) {
+            if (n_iov == MAX_WRITE_IOVECS) break;
+            size_t skip = n_iov == 0 ? client.write_offset : 0;
+            iov[n_iov].iov_base = const_cast<char*>(frame->data() + skip);
+            iov[n_iov].iov_len = frame->size() - skip;
+            n_iov++;
         }
         
-        uint32_t length = ntohl(length_prefix);
-        if (length > 1024 * 1024) { // Max 1MB message
-            std::cerr << "Message too large: " << length << std::endl;
+        // sendmsg is writev with flags, so MSG_NOSIGNAL still applies
+        struct msghdr msg = {};
+        msg.msg_iov = iov;
+        msg.msg_iovlen = n_iov;
+        ssize_t sent = sendmsg(client.socket_fd, &msg, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            if (would_block(errno)) break;
             return false;
         }
         
-        // Read message
-        std::vector<char> buffer(length);
-        size_t total_received = 0;
-        while (total_received < length) {
-            ssize_t received = recv(client_fd, buffer.data() + total_received,
-                                  length - total_received, 0);
-            if (received <= 0) {
-                return false;
+        client.queued_bytes -= sent;
+        size_t remaining = static_cast<size_t>(sent);
+        while (remaining > 0) {
+            size_t left = client.write_queue.front()->size() - client.write_offset;
+            if (remaining < left) {
+                client.write_offset += remaining;
+                break;
             }
-            total_received += received;
+            remaining -= left;
+            client.write_queue.pop_front();
+            client.write_offset = 0;
         }
-        
-        // Parse JSON
-        std::string json_str(buffer.data(), length);
-        auto json_msg = nlohmann::json::parse(json_str);
-        
-        msg.type = static_cast<Message::Type>(json_msg["type"].get<int>());
-        msg.id = json_msg.value("id", "");
-        msg.data = json_msg["data"];
-        
-        return true;
-    } catch (const std::exception& e) {
-        std::cerr << "Failed to receive message: " << e.what() << std::endl;
-        return false;
     }
+    
+    // Watch for writability only while output is pending
+    bool want_write = !client.write_queue.empty();
+    if (want_write != client.write_armed) {
+        if (!poller_set_write(impl_->poller, client.socket_fd, want_write)) {
+            return false;
+        }
+        client.write_armed = want_write;
+    }
+    return true;
 }
 
 void Server::process_message(int client_fd, const Message& msg) {
     switch (msg.type) {
         case Message::COMMAND: {
             if (command_handler_) {
-                std::string action = msg.data.value("action", "");
-                auto params = msg.data.value("params", nlohmann::json::object());
-                
-                try {
-                    auto result = command_handler_(action, params);
-                    
-                    Message response;
-                    response.type = Message::ACKNOWLEDGMENT;
-                    response.id = msg.id;
-                    response.data = {
-                        {"success", true},
-                        {"result", result}
-                    };
-                    send_message(client_fd, response);
-                } catch (const std::exception& e) {
-                    Message error;
-                    error.type = Message::ERROR;
-                    error.id = msg.id;
-                    error.data = {
-                        {"message", e.what()}
-                    };
-                    send_message(client_fd, error);
+                std::string client_id;
+                {
+                    std::lock_guard<std::mutex> lock(impl_->clients_mutex);
+                    auto it = impl_->clients.find(client_fd);
+                    if (it == impl_->clients.end()) break;
+                    client_id = it->second->id;
                 }
+                {
+                    std::lock_guard<std::mutex> lock(impl_->command_mutex);
+                    impl_->command_queue.push_back({client_fd, std::move(client_id), msg});
+                }
+                impl_->command_cv.notify_one();
             }
             break;
         }
         
-        case Message::SUBSCRIBE: {
-            std::lock_guard<std::mutex> lock(impl_->clients_mutex);
-            if (auto it = impl_->clients.find(client_fd); it != impl_->clients.end()) {
-                it->second->subscribed_to_transcriptions = true;
-                
-                Message ack;
-                ack.type = Message::ACKNOWLEDGMENT;
-                ack.id = msg.id;
-                ack.data = {{"subscribed", true}};
-                send_message(client_fd, ack);
-            }
-            break;
-        }
-        
+        case Message::SUBSCRIBE:
         case Message::UNSUBSCRIBE: {
-            std::lock_guard<std::mutex> lock(impl_->clients_mutex);
-            if (auto it = impl_->clients.find(client_fd); it != impl_->clients.end()) {
-                it->second->subscribed_to_transcriptions = false;
+            bool subscribe = msg.type == Message::SUBSCRIBE;
+            
+            Subscription subscription;
+            std::string error;
+            if (subscribe && !parse_subscription(msg.data, subscription, error)) {
+                Message reply;
+                reply.type = Message::ERROR;
+                reply.id = msg.id;
+                reply.data = {{"message", error}};
+                send_message(client_fd, reply);
+                break;
+            }
+            
+            {
+                std::lock_guard<std::mutex> lock(impl_->clients_mutex);
+                auto it = impl_->clients.find(client_fd);
+                if (it == impl_->clients.end()) break;
+                ClientInfo& client = *it->second;
+                client.subscribed_to_transcriptions = subscribe;
+                if (subscribe) {
+                    client.subscription = std::move(subscription);
+                }
+                
+                // An unknown encoding keeps the current one; the ack says which
+                // is in effect
+                Encoding encoding = client.encoding;
+                if (subscribe && msg.data.is_object() && msg.data.contains("encoding")) {
+                    const auto& requested = msg.data["encoding"];
+                    if (!requested.is_string() || !parse_encoding(requested.get<std::string>(), encoding)) {
+                        std::cerr << "Client " << client.id << " requested unsupported encoding "
+                                  << requested.dump() << std::endl;
+                    }
+                }
                 
+                // The ack goes out in the old encoding and everything after it in
+                // the new one; holding the lock keeps broadcasts from interleaving
                 Message ack;
                 ack.type = Message::ACKNOWLEDGMENT;
                 ack.id = msg.id;
-                ack.data = {{"subscribed", false}};
-                send_message(client_fd, ack);
+                ack.data = {
+                    {"subscribed", subscribe},
+                    {"encoding", encoding_name(encoding)}
+                };
+                if (subscribe) {
+                    ack.data["subscription"] = subscription_to_json(client.subscription);
+                }
+                if (Frame frame = frame_message(ack, client.encoding)) {
+                    queue_frame(client, frame);
+                }
+                client.encoding = encoding;
             }
+            
+            notify_subscriptions();
             break;
         }
         
@@ -357,6 +844,71 @@ void Server::process_message(int client_fd, const Message& msg) {
     }
 }
 
+void Server::command_loop() {
+    std::unique_lock<std::mutex> lock(impl_->command_mutex);
+    
+    while (true) {
+        // The oldest command whose client has nothing else running
+        auto next = impl_->command_queue.end();
+        impl_->command_cv.wait(lock, [this, &next] {
+            if (!impl_->commands_running) return true;
+            next = std::find_if(impl_->command_queue.begin(), impl_->command_queue.end(),
+                                [this](const Impl::CommandJob& job) {
+                                    return impl_->busy_clients.count(job.client_id) == 0;
+                                });
+            return next != impl_->command_queue.end();
+        });
+        if (!impl_->commands_running) break;
+        
+        Impl::CommandJob job = std::move(*next);
+        impl_->command_queue.erase(next);
+        impl_->busy_clients.insert(job.client_id);
+        lock.unlock();
+        
+        std::string action = job.msg.data.value("action", "");
+        auto params = job.msg.data.value("params", nlohmann::json::object());
+        
+        Message reply;
+        reply.id = job.msg.id;
+        try {
+            auto result = command_handler_(action, params);
+            reply.type = Message::ACKNOWLEDGMENT;
+            reply.data = {
+                {"success", true},
+                {"result", result}
+            };
+        } catch (const std::exception& e) {
+            reply.type = Message::ERROR;
+            reply.data = {
+                {"message", e.what()}
+            };
+        }
+        send_message(job.client_fd, reply, job.client_id);
+        
+        lock.lock();
+        impl_->busy_clients.erase(job.client_id);
+        // The client may have more queued behind this one
+        impl_->command_cv.notify_all();
+    }
+}
+
+void Server::notify_subscriptions() {
+    if (subscription_handler_) {
+        subscription_handler_();
+    }
+}
+
+bool Server::wants_field(const std::string& field) const {
+    std::lock_guard<std::mutex> lock(impl_->clients_mutex);
+    for (const auto& [fd, client] : impl_->clients) {
+        if (client->subscribed_to_transcriptions && !client->evict &&
+            client->subscription.wants(field)) {
+            return true;
+        }
+    }
+    return false;
+}
+
 void Server::broadcast_transcription(const std::string& text, float confidence) {
     Message msg;
     msg.type = Message::TRANSCRIPTION;
@@ -367,11 +919,18 @@ void Server::broadcast_transcription(const std::string& text, float confidence)
         {"timestamp", std::chrono::system_clock::now().time_since_epoch().count()}
     };
     
+    // Serialized once per encoding; subscribers share the buffers
+    FrameCache frames(msg);
+    
     std::lock_guard<std::mutex> lock(impl_->clients_mutex);
     size_t sent_count = 0;
     for (auto& [fd, client] : impl_->clients) {
-        if (client->subscribed_to_transcriptions) {
-            if (send_message(fd, msg)) {
+        if (client->subscribed_to_transcriptions && !client->evict &&
+            client->subscription.matches(msg.data)) {
+            if (const Frame& frame = frames.get(client->encoding)) {
+                queue_frame(*client, frame);
+            }
+            if (!client->evict) {
                 sent_count++;
             } else {
                 std::cerr << "Failed to send transcription to client " << client->id << std::endl;
@@ -390,9 +949,13 @@ void Server::broadcast_status(const nlohmann::json& status) {
     msg.id = std::to_string(std::chrono::system_clock::now().time_since_epoch().count());
     msg.data = status;
     
+    FrameCache frames(msg);
+    
     std::lock_guard<std::mutex> lock(impl_->clients_mutex);
     for (auto& [fd, client] : impl_->clients) {
-        send_message(fd, msg);
+        if (const Frame& frame = frames.get(client->encoding)) {
+            queue_frame(*client, frame);
+        }
     }
 }
 
@@ -402,10 +965,28 @@ void Server::broadcast_transcription_full(const nlohmann::json& transcription_da
     msg.id = std::to_string(std::chrono::system_clock::now().time_since_epoch().count());
     msg.data = transcription_data;
     
+    // Full frames plus one projection per distinct field list, each built
+    // only if a matching client asked for it
+    FrameCache frames(msg);
+    std::map<std::vector<std::string>, std::unique_ptr<Projection>> projections;
+    
     std::lock_guard<std::mutex> lock(impl_->clients_mutex);
     for (auto& [fd, client] : impl_->clients) {
-        if (client->subscribed_to_transcriptions) {
-            if (!send_message(fd, msg)) {
+        if (client->subscribed_to_transcriptions && !client->evict &&
+            client->subscription.matches(msg.data)) {
+            FrameCache* cache = &frames;
+            const auto& fields = client->subscription.fields;
+            if (!fields.empty()) {
+                auto& projection = projections[fields];
+                if (!projection) {
+                    projection = std::make_unique<Projection>(msg, fields);
+                }
+                cache = &projection->frames;
+            }
+            if (const Frame& frame = cache->get(client->encoding)) {
+                queue_frame(*client, frame);
+            }
+            if (client->evict) {
                 std::cerr << "Failed to send full transcription to client " << client->id << std::endl;
             }
         }
@@ -421,18 +1002,20 @@ void Server::cleanup_client(int client_fd) {
     {
         std::lock_guard<std::mutex> lock(impl_->clients_mutex);
         
-        if (auto it = impl_->clients.find(client_fd); it != impl_->clients.end()) {
-            std::cout << "Client disconnected: " << it->second->id << std::endl;
-            
-            // Note: We don't join the thread here as we're in the thread
-            it->second->handler_thread.detach();
-            impl_->clients.erase(it);
+        auto it = impl_->clients.find(client_fd);
+        if (it == impl_->clients.end()) {
+            return;
         }
+        std::cout << "Client disconnected: " << it->second->id << std::endl;
+        impl_->clients.erase(it);
     }
     
-    // Close socket after releasing the lock
+    // Deregister and close after releasing the lock
+    poller_remove(impl_->poller, client_fd);
     close(client_fd);
+    
+    notify_subscriptions();
 }
 
 } // namespace ipc
-} // namespace rt_stt
\ No newline at end of file
+} // namespace rt_stt
@@ -7,6 +7,7 @@
 #include <vector>
 #include <atomic>
 #include <thread>
+#include <deque>
 #include <nlohmann/json.hpp>
 
 namespace rt_stt {
@@ -32,18 +33,51 @@ struct Message {
     nlohmann::json data;
 };
 
-// Client connection info
+// Frame payload encoding, chosen per client with SUBSCRIBE {"encoding": ...}.
+// Incoming frames are recognised by their first byte in any encoding.
+enum class Encoding {
+    JSON,
+    MSGPACK,
+    CBOR
+};
+
+// Serialized, length-prefixed frame; broadcasts share one per message
+using Frame = std::shared_ptr<const std::string>;
+
+// What a client receives from the transcription stream, set by SUBSCRIBE
+struct Subscription {
+    std::vector<std::string> fields;  // Top-level fields to send, sorted; empty = all
+    float min_confidence = 0.0f;
+    bool finals_only = false;
+    bool partials_only = false;
+    std::string stream_id;            // Empty = every stream
+    
+    bool matches(const nlohmann::json& transcription) const;
+    bool wants(const std::string& field) const;
+};
+
+// Client connection info. Sockets are non-blocking and serviced by the
+// server's event loop; outgoing frames wait in the client's own queue.
 struct ClientInfo {
     int socket_fd;
     std::string id;
     bool subscribed_to_transcriptions;
-    std::thread handler_thread;
+    Subscription subscription;
+    Encoding encoding = Encoding::JSON;  // For frames sent to this client
+    
+    std::string read_buffer;            // Bytes received but not yet framed
+    std::deque<Frame> write_queue;      // Frames not yet fully sent
+    size_t write_offset = 0;            // Bytes of write_queue.front() already sent
+    size_t queued_bytes = 0;
+    bool write_armed = false;           // Registered for writability
+    bool evict = false;                 // Disconnected or too slow; closed by the event loop
 };
 
 class Server {
 public:
     using TranscriptionCallback = std::function<void(const std::string&, float confidence)>;
     using CommandHandler = std::function<nlohmann::json(const std::string& action, const nlohmann::json& params)>;
+    using SubscriptionHandler = std::function<void()>;
     
     Server();
     ~Server();
@@ -59,6 +93,14 @@ public:
     // Register handlers
     void set_command_handler(CommandHandler handler) { command_handler_ = handler; }
     
+    // Called on the event loop thread whenever clients subscribe,
+    // unsubscribe, connect or disconnect
+    void set_subscription_handler(SubscriptionHandler handler) { subscription_handler_ = handler; }
+    
+    // True if any subscribed client receives this transcription field, so
+    // producers can skip building fields nobody reads
+    bool wants_field(const std::string& field) const;
+    
     // Broadcast transcription to all subscribed clients
     void broadcast_transcription(const std::string& text, float confidence = 1.0f);
     void broadcast_transcription_full(const nlohmann::json& transcription_data);
@@ -72,6 +114,13 @@ public:
     // Check if server is running
     bool is_running() const { return running_.load(); }
     
+    // A client whose unsent output exceeds this is disconnected rather than
+    // allowed to delay everyone else
+    void set_client_high_water(size_t bytes) { client_high_water_ = bytes; }
+    
+    // Clients disconnected for falling behind or for a failed write
+    size_t get_evicted_count() const { return evicted_count_.load(); }
+    
 private:
     struct Impl;
     std::unique_ptr<Impl> impl_;
@@ -80,15 +129,28 @@ private:
     std::atomic<bool> shutdown_requested_{false};
     
     CommandHandler command_handler_;
+    SubscriptionHandler subscription_handler_;
+    std::atomic<size_t> client_high_water_{4 * 1024 * 1024};
+    std::atomic<size_t> evicted_count_{0};
     
-    // Server thread functions
-    void accept_connections();
-    void handle_client(int client_fd);
+    // Event loop (kqueue on macOS, epoll on Linux): accepts, reads and
+    // flushes every client on one thread
+    void event_loop();
+    void accept_clients();
+    bool read_client(int client_fd);
+    void update_clients();
+    void wake_loop();
     
-    // Message handling
-    bool send_message(int client_fd, const Message& msg);
-    bool receive_message(int client_fd, Message& msg);
+    // Message handling. A non-empty client_id makes send_message drop the
+    // reply if the fd now belongs to a different client.
+    bool send_message(int client_fd, const Message& msg, const std::string& client_id = "");
     void process_message(int client_fd, const Message& msg);
+    void command_loop();  // Runs COMMAND messages through command_handler_
+    void notify_subscriptions();
+    
+    // Output queueing; called with clients_mutex held
+    void queue_frame(ClientInfo& client, const Frame& frame);
+    bool flush_client(ClientInfo& client);
     
     // Cleanup
     void cleanup_client(int client_fd);
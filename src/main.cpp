@@ -11,6 +11,7 @@
 #include <chrono>
 #include <nlohmann/json.hpp>
 #include <sys/stat.h>
+#include <sstream>
 
 // Global flag for graceful shutdown
 std::atomic<bool> g_shutdown_requested(false);
@@ -22,17 +23,97 @@ void signal_handler(int signal) {
     }
 }
 
+// get_metrics with {"format": "prometheus"}: text exposition format, for a
+// scraper or node_exporter's textfile collector
+std::string prometheus_metrics(const rt_stt::stt::STTEngine& engine, size_t clients) {
+    using Stage = rt_stt::stt::STTEngine::LatencyStage;
+    auto metrics = engine.get_metrics();
+    std::ostringstream out;
+    
+    out << "# HELP rt_stt_stage_latency_seconds Latency per pipeline stage\n";
+    out << "# TYPE rt_stt_stage_latency_seconds summary\n";
+    for (size_t i = 0; i < static_cast<size_t>(Stage::COUNT); ++i) {
+        auto stage = static_cast<Stage>(i);
+        rt_stt::utils::write_prometheus_summary(out, "rt_stt_stage_latency_seconds",
+            std::string("stage=\"") + rt_stt::stt::STTEngine::latency_stage_name(stage) + "\"",
+            engine.get_latency_snapshot(stage));
+    }
+    
+    auto counter = [&out](const char* name, const char* help, size_t value) {
+        out << "# HELP " << name << " " << help << "\n";
+        out << "# TYPE " << name << " counter\n";
+        out << name << " " << value << "\n";
+    };
+    auto gauge = [&out](const char* name, const char* help, double value) {
+        out << "# HELP " << name << " " << help << "\n";
+        out << "# TYPE " << name << " gauge\n";
+        out << name << " " << value << "\n";
+    };
+    counter("rt_stt_transcriptions_total", "Final transcriptions delivered", metrics.transcriptions_count);
+    counter("rt_stt_dropped_chunks_total", "Finals discarded on queue overflow", metrics.dropped_chunks);
+    counter("rt_stt_merged_chunks_total", "Finals merged into a waiting one on overflow", metrics.merged_chunks);
+    counter("rt_stt_downgraded_chunks_total", "Finals decoded on the partial model", metrics.downgraded_chunks);
+    counter("rt_stt_batched_decodes_total", "Decodes covering several utterances", metrics.batched_decodes);
+    gauge("rt_stt_queue_depth", "Finals waiting for a decoder", metrics.queue_depth);
+    gauge("rt_stt_rtf", "Mean real-time factor", metrics.avg_rtf);
+    gauge("rt_stt_clients", "Connected IPC clients", clients);
+    
+    return out.str();
+}
+
+// Push what changed between two configuration snapshots into the running
+// engine. VAD and decode settings apply live; the rest waits for a restart.
+static void apply_config_change(rt_stt::stt::STTEngine& engine, const rt_stt::config::Config& previous,
+                                const rt_stt::config::Config& current) {
+    using rt_stt::config::ConfigManager;
+    auto before = ConfigManager::to_json(previous);
+    auto after = ConfigManager::to_json(current);
+    
+    if (before["stt"]["vad"] != after["stt"]["vad"]) {
+        engine.update_vad_config(current.engine.vad_config);
+    }
+    if (before["stt"]["model"] != after["stt"]["model"]) {
+        engine.update_model_config(current.engine.model_config);
+    }
+    for (const auto& setting : ConfigManager::restart_required(previous, current)) {
+        std::cout << "Configuration: " << setting << " takes effect after a restart" << std::endl;
+    }
+}
+
+// Single-setting IPC commands go through the same validation as set_config
+static void update_config(rt_stt::config::ConfigManager& config_manager, const nlohmann::json& patch) {
+    std::vector<std::string> errors;
+    if (!config_manager.update(patch, errors)) {
+        std::string message = "Invalid configuration";
+        for (const auto& error : errors) {
+            message += ": " + error;
+        }
+        throw std::runtime_error(message);
+    }
+}
+
 int main(int argc, char* argv[]) {
     // Set up signal handlers
     signal(SIGINT, signal_handler);
     signal(SIGTERM, signal_handler);
     
+    // Startup phases, reported by get_status once the daemon is ready
+    auto startup_begin = std::chrono::steady_clock::now();
+    auto phase_start = startup_begin;
+    nlohmann::json startup_info;
+    std::atomic<bool> daemon_ready{false};
+    auto end_phase = [&phase_start, &startup_info](const std::string& name) {
+        auto now = std::chrono::steady_clock::now();
+        startup_info[name + "_ms"] = std::chrono::duration<float, std::milli>(now - phase_start).count();
+        phase_start = now;
+    };
+    
     std::cout << "RT-STT Daemon v1.0" << std::endl;
     std::cout << "==================" << std::endl;
     
     // Parse command line arguments
     std::string config_file;
-    std::string socket_path = "/tmp/rt-stt.sock";
+    std::string socket_path;   // Overrides ipc.socket_path
     
     // Default config path
     std::string home = std::getenv("HOME") ? std::getenv("HOME") : "";
@@ -56,146 +137,62 @@ int main(int argc, char* argv[]) {
         }
     }
     
-    // Initialize STT engine
-    rt_stt::stt::STTEngine stt_engine;
-    rt_stt::stt::STTEngine::Config stt_config;
-    rt_stt::audio::CaptureConfig capture_config;
-    
-    // Load configuration from file if it exists
-    bool config_loaded = false;
+    // Parse and validate the configuration once. Without a usable file the
+    // defaults apply; the watcher picks the file up once it appears or is fixed.
+    rt_stt::config::ConfigManager config_manager;
     struct stat buffer;
     if (!config_file.empty() && stat(config_file.c_str(), &buffer) == 0) {
-        try {
-            std::ifstream config_stream(config_file);
-            nlohmann::json config_json;
-            config_stream >> config_json;
-            
-            // Parse STT configuration
-            if (config_json.contains("stt")) {
-                auto& stt = config_json["stt"];
-                if (stt.contains("model")) {
-                    auto& model = stt["model"];
-                    stt_config.model_config.model_path = model.value("path", "models/ggml-small.en.bin");
-                    stt_config.model_config.language = model.value("language", "en");
-                    stt_config.model_config.use_gpu = model.value("use_gpu", true);
-                    stt_config.model_config.n_threads = model.value("n_threads", 4);
-                    stt_config.model_config.beam_size = model.value("beam_size", 5);
-                    stt_config.model_config.temperature = model.value("temperature", 0.0f);
-                }
-                if (stt.contains("vad")) {
-                    auto& vad = stt["vad"];
-                    stt_config.vad_config.energy_threshold = vad.value("energy_threshold", 0.001f);
-                    stt_config.vad_config.speech_start_ms = vad.value("speech_start_ms", 150);
-                    stt_config.vad_config.speech_end_ms = vad.value("speech_end_ms", 1000);
-                    stt_config.vad_config.min_speech_ms = vad.value("min_speech_ms", 500);
-                    stt_config.vad_config.speech_start_threshold = vad.value("speech_start_threshold", 1.08f);
-                    stt_config.vad_config.speech_end_threshold = vad.value("speech_end_threshold", 0.85f);
-                    stt_config.vad_config.pre_speech_buffer_ms = vad.value("pre_speech_buffer_ms", 500);
-                    stt_config.vad_config.noise_floor_adaptation_rate = vad.value("noise_floor_adaptation_rate", 0.01f);
-                    stt_config.vad_config.use_adaptive_threshold = vad.value("use_adaptive_threshold", true);
-                }
-                if (stt.contains("audio")) {
-                    auto& audio = stt["audio"];
-                    capture_config.device_name = audio.value("device_name", "MOTU M2");
-                    capture_config.sample_rate = audio.value("sample_rate", 16000);
-                    capture_config.channels = audio.value("channels", 1);
-                    capture_config.buffer_size_ms = audio.value("buffer_size_ms", 30);
-                    capture_config.input_channel_index = audio.value("input_channel_index", 1);
-                    capture_config.force_single_channel = audio.value("force_single_channel", true);
-                    capture_config.use_callback = true;
-                }
-            }
-            
-            // Parse IPC configuration
-            if (config_json.contains("ipc")) {
-                auto& ipc = config_json["ipc"];
-                socket_path = ipc.value("socket_path", socket_path);
-            }
-            
-            config_loaded = true;
+        if (config_manager.load(config_file)) {
             std::cout << "Loaded configuration from: " << config_file << std::endl;
-        } catch (const std::exception& e) {
-            std::cerr << "Failed to load configuration: " << e.what() << std::endl;
+        } else {
             std::cerr << "Using default configuration" << std::endl;
         }
+    } else {
+        config_manager.set_path(config_file);
     }
     
-    // Use default configuration if not loaded from file
-    if (!config_loaded) {
-        // Configure STT with defaults
-        stt_config.model_config.model_path = "models/ggml-small.en.bin";
-        stt_config.model_config.language = "en";
-        stt_config.model_config.use_gpu = true;
-        
-        // Configure VAD with tuned settings
-        stt_config.vad_config.energy_threshold = 0.001f;
-        stt_config.vad_config.speech_start_ms = 150;
-        stt_config.vad_config.speech_end_ms = 1000;
-        stt_config.vad_config.min_speech_ms = 500;
-        stt_config.vad_config.speech_start_threshold = 1.08f;
-        stt_config.vad_config.speech_end_threshold = 0.85f;
-        stt_config.vad_config.pre_speech_buffer_ms = 500;
-        stt_config.vad_config.noise_floor_adaptation_rate = 0.01f;
-        stt_config.vad_config.use_adaptive_threshold = true;
-        
-        // Configure audio capture
-        capture_config.device_name = "MOTU M2";
-        capture_config.sample_rate = 16000;
-        capture_config.channels = 1;
-        capture_config.buffer_size_ms = 30;
-        capture_config.use_callback = true;
-        capture_config.input_channel_index = 1;
-        capture_config.force_single_channel = true;
+    // Startup reads one snapshot; later changes arrive through the change
+    // callback below
+    const rt_stt::config::Snapshot startup_config = config_manager.get();
+    rt_stt::stt::STTEngine stt_engine;
+    const rt_stt::stt::STTEngine::Config& stt_config = startup_config->engine;
+    if (socket_path.empty()) {
+        socket_path = startup_config->socket_path;
     }
     
-    // Create audio capture instance
-    rt_stt::audio::AudioCapture audio_capture;
+    // One capture per stream. The engine pulls captured audio via
+    // read_samples (see set_audio_source below).
+    std::vector<rt_stt::audio::CaptureConfig> stream_capture_configs = startup_config->stream_captures;
+    for (auto& stream_config : stream_capture_configs) {
+        stream_config.use_callback = false;
+    }
+    
+    end_phase("config");
+    
+    // Create audio capture instances
+    std::vector<std::unique_ptr<rt_stt::audio::AudioCapture>> audio_captures;
     
     std::cout << "Initializing audio capture..." << std::endl;
-    if (!audio_capture.initialize(capture_config)) {
-        std::cerr << "Failed to initialize audio capture" << std::endl;
-        return 1;
+    for (size_t i = 0; i < stream_capture_configs.size(); ++i) {
+        auto capture = std::make_unique<rt_stt::audio::AudioCapture>();
+        if (!capture->initialize(stream_capture_configs[i])) {
+            std::cerr << "Failed to initialize audio capture for stream '" 
+                      << stt_config.stream_ids[i] << "'" << std::endl;
+            return 1;
+        }
+        audio_captures.push_back(std::move(capture));
     }
     
+    end_phase("capture_init");
+    
     std::cout << "Initializing STT engine..." << std::endl;
     if (!stt_engine.initialize(stt_config)) {
         std::cerr << "Failed to initialize STT engine" << std::endl;
         return 1;
     }
-    
-    // Keep config path for saving
-    std::string config_path = config_file;
-    
-    // Keep config as mutable JSON for runtime updates
-    nlohmann::json current_config;
-    current_config["model_config"] = {
-        {"model_path", stt_config.model_config.model_path},
-        {"language", stt_config.model_config.language},
-        {"n_threads", stt_config.model_config.n_threads},
-        {"use_gpu", stt_config.model_config.use_gpu},
-        {"beam_size", stt_config.model_config.beam_size},
-        {"temperature", stt_config.model_config.temperature}
-    };
-    current_config["vad_config"] = {
-        {"use_adaptive_threshold", stt_config.vad_config.use_adaptive_threshold},
-        {"energy_threshold", stt_config.vad_config.energy_threshold},
-        {"speech_start_ms", stt_config.vad_config.speech_start_ms},
-        {"speech_end_ms", stt_config.vad_config.speech_end_ms},
-        {"min_speech_ms", stt_config.vad_config.min_speech_ms},
-        {"pre_speech_buffer_ms", stt_config.vad_config.pre_speech_buffer_ms},
-        {"noise_floor_adaptation_rate", stt_config.vad_config.noise_floor_adaptation_rate},
-        {"speech_start_threshold", stt_config.vad_config.speech_start_threshold},
-        {"speech_end_threshold", stt_config.vad_config.speech_end_threshold}
-    };
-    current_config["audio_capture_config"] = {
-        {"device_name", capture_config.device_name},
-        {"sample_rate", capture_config.sample_rate},
-        {"channels", capture_config.channels},
-        {"buffer_size_ms", capture_config.buffer_size_ms},
-        {"force_single_channel", capture_config.force_single_channel},
-        {"input_channel_index", capture_config.input_channel_index}
-    };
-    current_config["ipc_socket_path"] = socket_path;
+    end_phase("engine_init");
+    startup_info["model_load_ms"] = stt_engine.get_startup_timing().model_load_ms;
+    startup_info["warm_up_ms"] = stt_engine.get_startup_timing().warm_up_ms;
     
     // Initialize IPC server
     rt_stt::ipc::Server ipc_server;
@@ -208,7 +205,7 @@ int main(int argc, char* argv[]) {
     
     // Set up transcription callback
     stt_engine.set_transcription_callback(
-        [&ipc_server](const rt_stt::stt::TranscriptionResult& result) {
+        [&ipc_server, segment_metadata = stt_config.segment_metadata](const rt_stt::stt::TranscriptionResult& result) {
             if (!result.text.empty()) {
                 std::cout << "[TRANSCRIPTION] " << result.text << std::endl;
                 std::cout << "[DEBUG] Broadcasting to IPC clients..." << std::endl;
@@ -224,22 +221,28 @@ int main(int argc, char* argv[]) {
                 transcription_data["audio_duration_ms"] = result.audio_duration_ms;
                 transcription_data["model"] = result.model_name;
                 transcription_data["is_final"] = result.is_final;
+                transcription_data["stream_id"] = result.stream_id;
+                transcription_data["audio_ctx"] = result.audio_ctx;
+                transcription_data["fallback_used"] = result.fallback_used;
                 
-                // Add segments with full metadata
+                // Add segments with full metadata (stt.segment_metadata), unless
+                // every subscriber projected them away
                 transcription_data["segments"] = nlohmann::json::array();
-                for (const auto& segment : result.segments) {
-                    nlohmann::json seg;
-                    seg["id"] = segment.id;
-                    seg["seek"] = segment.seek;
-                    seg["start"] = segment.start;
-                    seg["end"] = segment.end;
-                    seg["text"] = segment.text;
-                    seg["tokens"] = segment.tokens;
-                    seg["temperature"] = segment.temperature;
-                    seg["avg_logprob"] = segment.avg_logprob;
-                    seg["compression_ratio"] = segment.compression_ratio;
-                    seg["no_speech_prob"] = segment.no_speech_prob;
-                    transcription_data["segments"].push_back(seg);
+                if (segment_metadata && ipc_server.wants_field("segments")) {
+                    for (const auto& segment : result.segments) {
+                        nlohmann::json seg;
+                        seg["id"] = segment.id;
+                        seg["seek"] = segment.seek;
+                        seg["start"] = segment.start;
+                        seg["end"] = segment.end;
+                        seg["text"] = segment.text;
+                        seg["tokens"] = segment.tokens;
+                        seg["temperature"] = segment.temperature;
+                        seg["avg_logprob"] = segment.avg_logprob;
+                        seg["compression_ratio"] = segment.compression_ratio;
+                        seg["no_speech_prob"] = segment.no_speech_prob;
+                        transcription_data["segments"].push_back(std::move(seg));
+                    }
                 }
                 
                 ipc_server.broadcast_transcription_full(transcription_data);
@@ -248,9 +251,39 @@ int main(int argc, char* argv[]) {
         }
     );
     
+    // Only extract segment text and token ids while some subscriber takes
+    // the segments field
+    ipc_server.set_subscription_handler(
+        [&stt_engine, &ipc_server, segment_metadata = stt_config.segment_metadata]() {
+            stt_engine.set_segment_metadata(segment_metadata && ipc_server.wants_field("segments"));
+        }
+    );
+    stt_engine.set_segment_metadata(false);  // No clients yet
+    
+    // Model switches load in the background; tell clients when one lands
+    stt_engine.set_model_load_callback(
+        [&ipc_server](const std::string& model_path, bool success) {
+            std::cout << (success ? "Model loaded: " : "Failed to load model: ") << model_path << std::endl;
+            ipc_server.broadcast_status({
+                {"model", model_path},
+                {"model_loaded", success}
+            });
+        }
+    );
+    
+    // Every published configuration change (set_config and the setters
+    // below, or an edit of the file) reaches the engine here, in order
+    config_manager.set_change_callback(
+        [&stt_engine](const rt_stt::config::Snapshot& previous, const rt_stt::config::Snapshot& current) {
+            apply_config_change(stt_engine, *previous, *current);
+        }
+    );
+    
     // Set up command handler
     ipc_server.set_command_handler(
-        [&stt_engine, &stt_config, &capture_config, &current_config, config_path, &ipc_server](const std::string& action, const nlohmann::json& params) -> nlohmann::json {
+        [&stt_engine, &config_manager, &ipc_server,
+         &daemon_ready, &startup_info](const std::string& action, const nlohmann::json& params) -> nlohmann::json {
+            using rt_stt::config::ConfigManager;
             nlohmann::json result;
             
             try {
@@ -264,95 +297,112 @@ int main(int argc, char* argv[]) {
                     result["listening"] = true;
                 } else if (action == "get_status") {
                     result["listening"] = stt_engine.is_running();
-                    result["model"] = stt_config.model_config.model_path;
-                    result["language"] = stt_config.model_config.language;
-                    result["vad_enabled"] = stt_config.vad_config.use_adaptive_threshold;
+                    result["model"] = stt_engine.get_model_path();
+                    result["model_loading"] = stt_engine.is_model_loading();
+                    auto config = config_manager.get();
+                    result["language"] = config->engine.model_config.language;
+                    result["vad_enabled"] = config->engine.vad_config.use_adaptive_threshold;
                     result["clients"] = ipc_server.get_client_count();
+                    result["ready"] = daemon_ready.load();
+                    if (daemon_ready.load()) {
+                        result["startup"] = startup_info;
+                    }
                 } else if (action == "get_config") {
                     // Return full configuration
-                    result = current_config;
+                    result = ConfigManager::to_ipc_json(*config_manager.get());
                 } else if (action == "set_config") {
-                    // Update configuration with validation
-                    auto new_config = params.value("config", nlohmann::json::object());
-                    
-                    // Merge with existing config
-                    current_config.merge_patch(new_config);
-                    
-                    // Apply changes
-                    bool needs_restart = false;
+                    // The merged result is validated as a whole; nothing
+                    // applies unless all of it is valid
+                    auto patch = ConfigManager::ipc_patch_to_file(params.value("config", nlohmann::json::object()));
+                    std::vector<std::string> errors;
+                    auto previous = config_manager.update(patch, errors);
+                    if (!previous) {
+                        result["success"] = false;
+                        result["error"] = "Invalid configuration";
+                        result["errors"] = errors;
+                        return result;
+                    }
                     
-                    // VAD settings
-                    if (new_config.contains("vad_config")) {
-                        stt_config.vad_config.use_adaptive_threshold = current_config["vad_config"]["use_adaptive_threshold"].get<bool>();
-                        stt_config.vad_config.energy_threshold = current_config["vad_config"]["energy_threshold"].get<float>();
-                        stt_config.vad_config.speech_start_ms = current_config["vad_config"]["speech_start_ms"].get<int>();
-                        stt_config.vad_config.speech_end_ms = current_config["vad_config"]["speech_end_ms"].get<int>();
-                        stt_config.vad_config.min_speech_ms = current_config["vad_config"]["min_speech_ms"].get<int>();
-                        stt_config.vad_config.pre_speech_buffer_ms = current_config["vad_config"]["pre_speech_buffer_ms"].get<int>();
-                        stt_config.vad_config.noise_floor_adaptation_rate = current_config["vad_config"]["noise_floor_adaptation_rate"].get<float>();
-                        stt_config.vad_config.speech_start_threshold = current_config["vad_config"]["speech_start_threshold"].get<float>();
-                        stt_config.vad_config.speech_end_threshold = current_config["vad_config"]["speech_end_threshold"].get<float>();
-                        stt_config.vad_config.use_adaptive_threshold = current_config["vad_config"]["use_adaptive_threshold"].get<bool>();
-                        
-                        stt_engine.update_vad_config(stt_config.vad_config);
+                    // Applied by the change callback; report what it did
+                    auto current = config_manager.get();
+                    const auto& old_model = previous->engine.model_config;
+                    const auto& new_model = current->engine.model_config;
+                    auto before = ConfigManager::to_json(*previous);
+                    auto after = ConfigManager::to_json(*current);
+                    if (before["stt"]["vad"] != after["stt"]["vad"]) {
                         result["vad_updated"] = true;
                     }
-                    
-                    // Model settings
-                    if (new_config.contains("model_config")) {
-                        if (new_config["model_config"].contains("model_path")) {
-                            std::string new_model = current_config["model_config"]["model_path"].get<std::string>();
-                            stt_engine.set_model(new_model);
-                            stt_config.model_config.model_path = new_model;
-                            result["model_updated"] = true;
-                        }
-                        
-                        if (new_config["model_config"].contains("language")) {
-                            std::string new_lang = current_config["model_config"]["language"].get<std::string>();
-                            stt_engine.set_language(new_lang);
-                            stt_config.model_config.language = new_lang;
-                            result["language_updated"] = true;
-                        }
+                    if (old_model.model_path != new_model.model_path) {
+                        result["model_updated"] = true;
+                        result["model_loading"] = true;
                     }
+                    if (old_model.language != new_model.language) {
+                        result["language_updated"] = true;
+                    }
+                    if (old_model.adaptive_audio_ctx != new_model.adaptive_audio_ctx) {
+                        result["adaptive_audio_ctx_updated"] = true;
+                    }
+                    result["restart_required"] = ConfigManager::restart_required(*previous, *current);
                     
                     // Save config to file if requested
                     if (params.value("save", true)) {
-                        std::ofstream config_file(config_path);
-                        if (config_file) {
-                            config_file << current_config.dump(4);
-                            config_file.close();
-                            result["config_saved"] = true;
-                        }
+                        result["config_saved"] = config_manager.save();
                     }
                     
                     result["success"] = true;
                 } else if (action == "set_language") {
                     std::string lang = params.value("language", "en");
-                    stt_engine.set_language(lang);
-                    stt_config.model_config.language = lang;
-                        current_config["model_config"]["language"] = lang;
+                    update_config(config_manager, {{"stt", {{"model", {{"language", lang}}}}}});
                     result["language"] = lang;
                 } else if (action == "set_model") {
                     std::string model = params.value("model", "");
                     if (!model.empty()) {
-                        stt_engine.set_model(model);
-                        stt_config.model_config.model_path = model;
-                        current_config["model_config"]["model_path"] = model;
+                        update_config(config_manager, {{"stt", {{"model", {{"path", model}}}}}});
                         result["model"] = model;
+                        result["model_loading"] = stt_engine.is_model_loading();
                     }
                 } else if (action == "set_vad_sensitivity") {
                     float sensitivity = params.value("sensitivity", 1.08f);
-                    stt_config.vad_config.speech_start_threshold = sensitivity;
-                        current_config["vad_config"]["speech_start_threshold"] = sensitivity;
-                    stt_engine.update_vad_config(stt_config.vad_config);
+                    update_config(config_manager, {{"stt", {{"vad", {{"speech_start_threshold", sensitivity}}}}}});
                     result["sensitivity"] = sensitivity;
                 } else if (action == "get_metrics") {
                     auto metrics = stt_engine.get_metrics();
                     result["avg_latency_ms"] = metrics.avg_latency_ms;
                     result["avg_rtf"] = metrics.avg_rtf;
+                    result["avg_audio_ctx"] = metrics.avg_audio_ctx;
+                    result["cascade_decodes"] = metrics.cascade_decodes;
+                    result["cascade_fallbacks"] = metrics.cascade_fallbacks;
+                    result["queue_depth"] = metrics.queue_depth;
+                    result["avg_queue_wait_ms"] = metrics.avg_queue_wait_ms;
+                    result["dropped_chunks"] = metrics.dropped_chunks;
+                    result["merged_chunks"] = metrics.merged_chunks;
+                    result["downgraded_chunks"] = metrics.downgraded_chunks;
+                    result["batched_decodes"] = metrics.batched_decodes;
+                    result["batched_chunks"] = metrics.batched_chunks;
                     result["cpu_usage"] = metrics.cpu_usage;
                     result["memory_usage_mb"] = metrics.memory_usage_mb;
                     result["transcriptions_count"] = metrics.transcriptions_count;
+                    
+                    // Per-stage latency percentiles
+                    using Stage = rt_stt::stt::STTEngine::LatencyStage;
+                    nlohmann::json latency = nlohmann::json::object();
+                    for (size_t i = 0; i < static_cast<size_t>(Stage::COUNT); ++i) {
+                        auto stage = static_cast<Stage>(i);
+                        auto snapshot = stt_engine.get_latency_snapshot(stage);
+                        latency[rt_stt::stt::STTEngine::latency_stage_name(stage)] = {
+                            {"count", snapshot.count},
+                            {"p50_ms", snapshot.percentile_ms(0.50)},
+                            {"p90_ms", snapshot.percentile_ms(0.90)},
+                            {"p99_ms", snapshot.percentile_ms(0.99)},
+                            {"max_ms", snapshot.max_ms()},
+                            {"mean_ms", snapshot.mean_ms()}
+                        };
+                    }
+                    result["latency"] = latency;
+                    
+                    if (params.value("format", "") == "prometheus") {
+                        result["prometheus"] = prometheus_metrics(stt_engine, ipc_server.get_client_count());
+                    }
                 } else {
                     throw std::runtime_error("Unknown action: " + action);
                 }
@@ -371,19 +421,24 @@ int main(int argc, char* argv[]) {
         return 1;
     }
     
-    // Start STT engine
-    // Set up audio callback to feed the STT engine
-    audio_capture.set_callback(
-        [&stt_engine](const float* samples, size_t n_samples) {
-            stt_engine.feed_audio(samples, n_samples);
-        }
-    );
+    // Let the STT engine drain captured audio on its own ingest thread so
+    // the audio thread never runs VAD or buffer management
+    for (size_t i = 0; i < audio_captures.size(); ++i) {
+        rt_stt::audio::AudioCapture* capture = audio_captures[i].get();
+        stt_engine.set_audio_source(i,
+            [capture](float* buffer, size_t max_samples) {
+                return capture->read_samples(buffer, max_samples);
+            }
+        );
+    }
     
     // Start audio capture
     std::cout << "Starting audio capture..." << std::endl;
-    if (!audio_capture.start()) {
-        std::cerr << "Failed to start audio capture" << std::endl;
-        return 1;
+    for (auto& capture : audio_captures) {
+        if (!capture->start()) {
+            std::cerr << "Failed to start audio capture" << std::endl;
+            return 1;
+        }
     }
     
     // Start STT engine
@@ -395,9 +450,27 @@ int main(int argc, char* argv[]) {
         return 1;
     }
     
+    // Pick up edits of the configuration file from here on
+    if (!config_manager.get_path().empty()) {
+        config_manager.watch();
+    }
+    
+    end_phase("start");
+    startup_info["total_ms"] = std::chrono::duration<float, std::milli>(
+        std::chrono::steady_clock::now() - startup_begin).count();
+    daemon_ready = true;
+    ipc_server.broadcast_status({
+        {"ready", true},
+        {"startup", startup_info}
+    });
+    
     std::cout << "RT-STT daemon is running" << std::endl;
+    std::cout << "Startup: " << startup_info.dump() << std::endl;
     std::cout << "Listening on: " << socket_path << std::endl;
-    std::cout << "Audio device: " << capture_config.device_name << " (Input " << (capture_config.input_channel_index + 1) << ")" << std::endl;
+    for (size_t i = 0; i < stream_capture_configs.size(); ++i) {
+        std::cout << "Audio device [" << stt_config.stream_ids[i] << "]: " << stream_capture_configs[i].device_name 
+                  << " (Input " << (stream_capture_configs[i].input_channel_index + 1) << ")" << std::endl;
+    }
     std::cout << "Model: " << stt_config.model_config.model_path << std::endl;
     std::cout << "Press Ctrl+C to stop" << std::endl;
     std::cout << std::endl;
@@ -425,12 +498,17 @@ int main(int argc, char* argv[]) {
     std::cout << "Shutting down..." << std::endl;
     
     // Stop services
-    audio_capture.stop();
+    config_manager.stop_watching();
+    for (auto& capture : audio_captures) {
+        capture->stop();
+    }
     stt_engine.stop();
     ipc_server.stop();
     
     // Cleanup
-    audio_capture.shutdown();
+    for (auto& capture : audio_captures) {
+        capture->shutdown();
+    }
     stt_engine.shutdown();
     ipc_server.shutdown();
     
@@ -0,0 +1,289 @@
+#include "stt/engine.h"
+#include "audio/audio_tap.h"
+#include "utils/tool_common.h"
+#include "miniaudio.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+// Offline replay of an audio tap (STTEngine::Config::tap_path). Lists the
+// utterances the live VAD found, exports a window as WAV, or feeds a window
+// back through STTEngine::feed_audio in 30 ms frames from this thread, so
+// a bad transcription can be re-run against another model or VAD setting.
+
+namespace {
+
+using rt_stt::utils::format_time;
+using rt_stt::utils::running;
+
+constexpr int FRAME_MS = 30;   // As captured live
+
+struct Utterance {
+    uint64_t start;   // Absolute tap positions
+    uint64_t end;
+};
+
+// Speech the live VAD confirmed: SPEECH_MAYBE that reached SPEECH, up to
+// the return to SILENCE. One still open at the end of the tap runs to it.
+std::vector<Utterance> recorded_utterances(const rt_stt::audio::AudioTapReader& tap) {
+    using State = rt_stt::audio::VAD::State;
+    std::vector<Utterance> utterances;
+    uint64_t start = 0;
+    bool candidate = false;
+    bool confirmed = false;
+
+    for (const auto& event : tap.events()) {
+        if (event.old_state == State::SILENCE && event.new_state == State::SPEECH_MAYBE) {
+            start = event.position;
+            candidate = true;
+            confirmed = false;
+        } else if (event.new_state == State::SPEECH) {
+            confirmed = candidate;
+        } else if (event.new_state == State::SILENCE) {
+            if (confirmed) {
+                utterances.push_back({start, event.position});
+            }
+            candidate = confirmed = false;
+        }
+    }
+    if (confirmed) {
+        utterances.push_back({start, tap.first_position() + tap.samples().size()});
+    }
+    return utterances;
+}
+
+std::string format_wall_clock(int64_t unix_ms) {
+    std::time_t seconds = static_cast<std::time_t>(unix_ms / 1000);
+    std::tm local{};
+    localtime_r(&seconds, &local);
+    char buffer[32];
+    std::strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", &local);
+    char with_ms[40];
+    std::snprintf(with_ms, sizeof(with_ms), "%s.%03d", buffer, static_cast<int>(unix_ms % 1000));
+    return with_ms;
+}
+
+bool export_wav(const std::string& path, const float* samples, size_t n_samples, uint32_t sample_rate) {
+    ma_encoder_config config = ma_encoder_config_init(ma_encoding_format_wav, ma_format_f32, 1, sample_rate);
+    ma_encoder encoder;
+    if (ma_encoder_init_file(path.c_str(), &config, &encoder) != MA_SUCCESS) {
+        std::cerr << "Failed to create " << path << std::endl;
+        return false;
+    }
+    ma_uint64 written = 0;
+    ma_result result = ma_encoder_write_pcm_frames(&encoder, samples, n_samples, &written);
+    ma_encoder_uninit(&encoder);
+    if (result != MA_SUCCESS || written != n_samples) {
+        std::cerr << "Failed to write " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void print_usage(const char* program) {
+    std::cout << "Usage: " << program << " [options] TAP_FILE\n";
+    std::cout << "Replay audio recorded by the daemon's tap (stt.tap_path) through the engine.\n";
+    std::cout << "Selection (default: everything the tap retains):\n";
+    std::cout << "  --list              List the recorded utterances and exit\n";
+    std::cout << "  --utterance N       Only utterance N from --list, with some context\n";
+    std::cout << "  --from S --to S     Only this window, in seconds from the start of the tap\n";
+    std::cout << "  --wav FILE          Write the selection to a WAV file instead of decoding\n";
+    std::cout << "Engine:\n";
+    rt_stt::utils::print_model_usage();
+    std::cout << "  --mode MODE         utterance or streaming (default: utterance)\n";
+    std::cout << "  --vad TYPE          energy or spectral (default: energy)\n";
+    std::cout << "  --vad-threshold T   Speech start threshold\n";
+    std::cout << "  --speech-start-ms N Speech needed to start an utterance\n";
+    std::cout << "  --speech-end-ms N   Silence needed to end an utterance\n";
+    std::cout << "  --json              One JSON object per result\n";
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    rt_stt::utils::install_stop_handlers();
+
+    rt_stt::stt::STTEngine::Config config;
+    config.model_config.model_path = "models/ggml-base.en.bin";
+    config.model_config.language = "en";
+    config.enable_terminal_output = false;
+    config.max_queue_size = 0;   // Replay everything; nothing is dropped
+
+    std::string tap_path;
+    std::string wav_path;
+    bool list_only = false;
+    bool json_output = false;
+    int utterance = 0;
+    double from_s = -1.0;
+    double to_s = -1.0;
+
+    for (int i = 1; i < argc; i++) {
+        if (rt_stt::utils::parse_model_option(argc, argv, i, config.model_config)) continue;
+        std::string arg = argv[i];
+        if (arg == "--list") {
+            list_only = true;
+        } else if (arg == "--utterance" && i + 1 < argc) {
+            utterance = std::stoi(argv[++i]);
+        } else if (arg == "--from" && i + 1 < argc) {
+            from_s = std::stod(argv[++i]);
+        } else if (arg == "--to" && i + 1 < argc) {
+            to_s = std::stod(argv[++i]);
+        } else if (arg == "--wav" && i + 1 < argc) {
+            wav_path = argv[++i];
+        } else if (arg == "--mode" && i + 1 < argc) {
+            config.mode = std::string(argv[++i]) == "streaming"
+                ? rt_stt::stt::STTEngine::TranscriptionMode::STREAMING
+                : rt_stt::stt::STTEngine::TranscriptionMode::UTTERANCE;
+        } else if (arg == "--vad" && i + 1 < argc) {
+            // The neural VAD scores asynchronously, so its decisions would
+            // depend on replay timing; it is not offered here
+            config.vad_config.type = std::string(argv[++i]) == "spectral"
+                ? rt_stt::audio::VADConfig::Type::SPECTRAL
+                : rt_stt::audio::VADConfig::Type::ENERGY;
+        } else if (arg == "--vad-threshold" && i + 1 < argc) {
+            config.vad_config.speech_start_threshold = std::stof(argv[++i]);
+        } else if (arg == "--speech-start-ms" && i + 1 < argc) {
+            config.vad_config.speech_start_ms = std::stoi(argv[++i]);
+        } else if (arg == "--speech-end-ms" && i + 1 < argc) {
+            config.vad_config.speech_end_ms = std::stoi(argv[++i]);
+        } else if (arg == "--json") {
+            json_output = true;
+        } else if (arg == "--help" || arg == "-h") {
+            print_usage(argv[0]);
+            return 0;
+        } else if (!arg.empty() && arg[0] != '-' && tap_path.empty()) {
+            tap_path = arg;
+        } else {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (tap_path.empty()) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    rt_stt::audio::AudioTapReader tap;
+    if (!tap.open(tap_path)) {
+        return 1;
+    }
+
+    const uint32_t rate = tap.sample_rate();
+    const uint64_t first = tap.first_position();
+    const uint64_t last = first + tap.samples().size();
+    auto offset_of = [&](uint64_t position) { return static_cast<double>(position - first) / rate; };
+    auto wall_clock_of = [&](uint64_t position) {
+        return format_wall_clock(tap.start_unix_ms() + static_cast<int64_t>(position * 1000 / rate));
+    };
+
+    std::vector<Utterance> utterances = recorded_utterances(tap);
+
+    if (list_only) {
+        std::cout << tap_path << ": " << format_time(offset_of(last)) << " of audio at " << rate
+                  << " Hz, " << wall_clock_of(first) << " to " << wall_clock_of(last) << "\n";
+        for (size_t i = 0; i < utterances.size(); ++i) {
+            std::cout << "  " << (i + 1) << ". [" << format_time(offset_of(utterances[i].start)) << " --> "
+                      << format_time(offset_of(utterances[i].end)) << "] " << wall_clock_of(utterances[i].start)
+                      << "\n";
+        }
+        return 0;
+    }
+
+    // Resolve the selection to absolute positions
+    uint64_t begin = first;
+    uint64_t end = last;
+    if (utterance > 0) {
+        if (static_cast<size_t>(utterance) > utterances.size()) {
+            std::cerr << "No utterance " << utterance << " (the tap has " << utterances.size() << ")" << std::endl;
+            return 1;
+        }
+        // Enough lead-in for the VAD's noise floor and pre-speech buffer
+        const uint64_t lead_in = rate;
+        const uint64_t tail = static_cast<uint64_t>(rate) / 5;
+        const Utterance& u = utterances[utterance - 1];
+        begin = u.start - std::min(u.start - first, lead_in);
+        end = std::min(last, u.end + tail);
+    }
+    if (from_s >= 0.0) {
+        begin = std::min(last, first + static_cast<uint64_t>(from_s * rate));
+    }
+    if (to_s >= 0.0) {
+        end = std::min(last, first + static_cast<uint64_t>(to_s * rate));
+    }
+    if (end <= begin) {
+        std::cerr << "Empty selection" << std::endl;
+        return 1;
+    }
+
+    const float* selection = tap.samples().data() + (begin - first);
+    const size_t n_selected = static_cast<size_t>(end - begin);
+
+    if (!wav_path.empty()) {
+        if (!export_wav(wav_path, selection, n_selected, rate)) return 1;
+        std::cerr << "Wrote " << format_time(static_cast<double>(n_selected) / rate) << " to " << wav_path
+                  << std::endl;
+        return 0;
+    }
+
+    config.vad_config.sample_rate = static_cast<int>(rate);
+    config.audio_buffer_size_ms = FRAME_MS;
+
+    rt_stt::stt::STTEngine engine;
+    if (!engine.initialize(config)) {
+        std::cerr << "Failed to initialize STT engine" << std::endl;
+        return 1;
+    }
+
+    size_t result_index = 0;
+    engine.set_transcription_callback([&](const rt_stt::stt::TranscriptionResult& result) {
+        result_index++;
+        if (json_output) {
+            nlohmann::json line = {
+                {"index", result_index},
+                {"is_final", result.is_final},
+                {"text", result.text},
+                {"confidence", result.confidence},
+                {"audio_duration_ms", result.audio_duration_ms},
+                {"latency_ms", result.processing_time.count()}
+            };
+            std::cout << line.dump() << std::endl;
+        } else {
+            std::cout << (result.is_final ? "final  " : "partial") << " (conf " << result.confidence << ", "
+                      << result.audio_duration_ms / 1000.0 << " s) " << result.text << std::endl;
+        }
+    });
+
+    std::cerr << "Replaying " << format_time(static_cast<double>(n_selected) / rate) << " from "
+              << wall_clock_of(begin) << std::endl;
+    engine.start();
+
+    // Fixed frames from one thread: the VAD and chunking see exactly the
+    // same sequence on every run
+    const size_t frame_samples = static_cast<size_t>(rate) * FRAME_MS / 1000;
+    for (size_t offset = 0; offset < n_selected && running(); offset += frame_samples) {
+        engine.feed_audio(selection + offset, std::min(frame_samples, n_selected - offset));
+    }
+
+    // Trailing silence closes an utterance cut off by the selection
+    std::vector<float> silence(frame_samples, 0.0f);
+    const int silence_ms = config.vad_config.speech_end_ms + config.vad_config.speech_start_ms + 300;
+    for (int ms = 0; ms < silence_ms && running(); ms += FRAME_MS) {
+        engine.feed_audio(silence.data(), silence.size());
+    }
+    while (running() && engine.get_pending_finals() > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    engine.stop();
+    engine.shutdown();
+    return 0;
+}
@@ -1,4 +1,5 @@
 #include "stt/engine.h"
+#include "audio/dsp.h"
 #include <iostream>
 #include <chrono>
 #include <thread>
@@ -14,9 +15,22 @@
 namespace rt_stt {
 namespace stt {
 
+// How long the ingest thread sleeps when its source has less than a frame
+static constexpr int INGEST_POLL_MS = 5;
+
+// How long update_vad_config waits for pushed streams to take a new VAD
+static constexpr int VAD_SWAP_WAIT_MS = 500;
+
+// Silence inserted between utterances merged on queue overflow
+static constexpr size_t MERGE_GAP_MS = 200;
+
+// Batched decodes: silence between utterances, long enough that whisper
+// ends a segment in it, and a cap on utterances per decode
+static constexpr int BATCH_GAP_MS = 1000;
+static constexpr size_t BATCH_MAX_UTTERANCES = 8;
+
 STTEngine::STTEngine() {
-    whisper_ = std::make_unique<WhisperWrapper>();
-    vad_ = std::make_unique<audio::VAD>();
+    whisper_ = std::make_shared<WhisperWrapper>();
 }
 
 STTEngine::~STTEngine() {
@@ -34,6 +48,7 @@ bool STTEngine::initialize(const Config& config) {
     }
     
     // Initialize Whisper
+    auto load_start = std::chrono::steady_clock::now();
     if (!whisper_->initialize(config.model_config)) {
         if (terminal_output_) {
             terminal_output_->print_error("Failed to initialize Whisper model");
@@ -41,108 +56,234 @@ bool STTEngine::initialize(const Config& config) {
         return false;
     }
     
-    // Configure VAD
-    vad_->update_config(config.vad_config);
-    vad_->set_state_callback([this](audio::VAD::State old_state, audio::VAD::State new_state) {
-        if (terminal_output_) {
-            bool is_speaking = (new_state == audio::VAD::State::SPEECH || 
-                               new_state == audio::VAD::State::SPEECH_ENDING);
-            terminal_output_->print_vad_status(is_speaking);
-            
-            // Debug: show all state transitions
-            if (old_state == audio::VAD::State::SPEECH_ENDING && new_state == audio::VAD::State::SILENCE) {
-                terminal_output_->print_status("VAD: SPEECH_ENDING -> SILENCE transition detected");
-            }
-        }
-        
-        // Clear buffer ONLY when starting fresh from silence
-        if (old_state == audio::VAD::State::SILENCE && new_state == audio::VAD::State::SPEECH_MAYBE) {
-            speech_buffer_.clear();
+    // Fast partial model, used when streaming and to catch up on a backlog
+    partial_whisper_.reset();
+    bool wants_partial_model = config_.mode == TranscriptionMode::STREAMING ||
+                               config_.overflow_policy == OverflowPolicy::DOWNGRADE;
+    if (wants_partial_model && !config_.partial_model_config.model_path.empty()) {
+        partial_whisper_ = std::make_shared<WhisperWrapper>();
+        if (!partial_whisper_->initialize(config_.partial_model_config)) {
             if (terminal_output_) {
-                terminal_output_->print_status("Starting new utterance - cleared speech buffer");
+                terminal_output_->print_error("Failed to initialize partial Whisper model");
             }
+            partial_whisper_.reset();
+            return false;
         }
-        
-        // Handle speech start - Include pre-speech buffer
-        if (old_state == audio::VAD::State::SPEECH_MAYBE && new_state == audio::VAD::State::SPEECH) {
-            // Get pre-speech buffer to capture the beginning
-            auto pre_speech = vad_->get_buffered_audio();
-            if (!pre_speech.empty()) {
-                if (terminal_output_) {
-                    // Calculate actual energy in pre-speech buffer for debugging
-                    float max_energy = 0.0f;
-                    for (size_t i = 0; i < pre_speech.size(); ++i) {
-                        max_energy = std::max(max_energy, std::abs(pre_speech[i]));
-                    }
-                    terminal_output_->print_status("Pre-speech buffer: " + 
-                                                 std::to_string(pre_speech.size() / 16000.0f) + 
-                                                 " seconds, max amplitude: " + 
-                                                 std::to_string(max_energy));
-                }
-                // Prepend pre-speech audio to our buffer
-                speech_buffer_.insert(speech_buffer_.begin(), pre_speech.begin(), pre_speech.end());
-            }
+    }
+    
+    whisper_->set_segment_metadata(config_.segment_metadata || config_.carry_context);
+    if (partial_whisper_) {
+        partial_whisper_->set_segment_metadata(config_.segment_metadata || config_.carry_context);
+    }
+    
+    auto warm_up_start = std::chrono::steady_clock::now();
+    if (config_.warm_up) {
+        if (terminal_output_) {
+            terminal_output_->print_status("Warming up model...");
         }
-        
-        // Handle speech end - Process COMPLETE utterances only
-        // Note: VAD goes SPEECH -> SPEECH_ENDING -> SILENCE
-        if (old_state == audio::VAD::State::SPEECH_ENDING && new_state == audio::VAD::State::SILENCE) {
-            
-            // Process accumulated speech buffer
-            size_t min_samples = 8000; // 0.5 seconds minimum
-            if (!speech_buffer_.empty() && speech_buffer_.size() > min_samples && !paused_.load()) {
-                if (terminal_output_) {
-                    float duration = speech_buffer_.size() / 16000.0f;
-                    terminal_output_->print_status("Processing utterance: " + 
-                                                 std::to_string(duration) + " seconds");
-                }
-                
-                AudioChunk chunk;
-                chunk.samples = speech_buffer_;  // Copy instead of move for debugging
-                chunk.timestamp = std::chrono::steady_clock::now();
-                chunk.is_speech_end = true;
-                
-                // Debug: Check first 0.5 seconds of audio
-                if (terminal_output_ && chunk.samples.size() > 8000) {
-                    float max_in_first_half_sec = 0.0f;
-                    for (size_t i = 0; i < 8000; ++i) {
-                        max_in_first_half_sec = std::max(max_in_first_half_sec, std::abs(chunk.samples[i]));
-                    }
-                    terminal_output_->print_status("First 0.5s max amplitude: " + 
-                                                 std::to_string(max_in_first_half_sec));
-                }
-                
-                std::lock_guard<std::mutex> lock(queue_mutex_);
-                audio_queue_.push(std::move(chunk));
-                queue_cv_.notify_one();
-                
-                speech_buffer_.clear();
-                
-                speech_buffer_.clear();
-            } else if (!speech_buffer_.empty()) {
-                // Too short, discard
-                if (terminal_output_) {
-                    float duration = speech_buffer_.size() / 16000.0f;
-                    terminal_output_->print_status("Discarding short utterance: " + 
-                                                 std::to_string(duration) + " seconds (min: 0.5s)");
-                }
-                speech_buffer_.clear();
+        whisper_->warm_up();
+        if (partial_whisper_) {
+            partial_whisper_->warm_up();
+        }
+    }
+    auto warm_up_end = std::chrono::steady_clock::now();
+    
+    startup_timing_.model_load_ms =
+        std::chrono::duration<float, std::milli>(warm_up_start - load_start).count();
+    startup_timing_.warm_up_ms =
+        std::chrono::duration<float, std::milli>(warm_up_end - warm_up_start).count();
+    
+    // One VAD and speech buffer per stream
+    std::vector<std::string> stream_ids = config_.stream_ids;
+    if (stream_ids.empty()) {
+        stream_ids.push_back("default");
+    }
+    
+    streams_.clear();
+    for (const auto& id : stream_ids) {
+        auto stream = std::make_unique<Stream>();
+        stream->id = id;
+        stream->index = streams_.size();
+        stream->vad = create_stream_vad(*stream, config_.vad_config);
+        stream->newest_vad = stream->vad;
+        streams_.push_back(std::move(stream));
+    }
+    std::atomic_store(&vad_config_, std::make_shared<const audio::VADConfig>(config_.vad_config));
+    
+    // A tap that cannot be created is reported and skipped; capture goes on
+    if (!config_.tap_path.empty()) {
+        for (auto& stream : streams_) {
+            std::string path = stream->index == 0 ? config_.tap_path : config_.tap_path + "." + stream->id;
+            auto tap = std::make_unique<audio::AudioTap>();
+            if (tap->open(path, config_.vad_config.sample_rate, config_.tap_seconds)) {
+                stream->tap = std::move(tap);
             }
         }
-    });
+    }
+    
+    // Warm the buffer pool: each stream's speech buffer and one utterance
+    // per decoder
+    buffer_capacity_ = (config_.max_utterance_ms * config.vad_config.sample_rate) / 1000;
+    {
+        std::lock_guard<std::mutex> lock(buffer_pool_mutex_);
+        buffer_pool_.clear();
+        size_t n_buffers = streams_.size() + whisper_->get_pool_size() + 1;
+        for (size_t i = 0; i < n_buffers; ++i) {
+            std::vector<float> buffer;
+            buffer.reserve(buffer_capacity_);
+            buffer_pool_.push_back(std::move(buffer));
+        }
+    }
+    for (auto& stream : streams_) {
+        stream->speech_buffer = acquire_buffer();
+    }
     
     if (terminal_output_) {
         terminal_output_->print_status("STT Engine initialized successfully");
         terminal_output_->print_status("Model: " + whisper_->get_model_type() + 
                                      (whisper_->is_multilingual() ? " (multilingual)" : " (English)"));
+        if (partial_whisper_) {
+            terminal_output_->print_status("Partial model: " + partial_whisper_->get_model_type());
+        }
     }
     
     return true;
 }
 
+std::shared_ptr<audio::VAD> STTEngine::create_stream_vad(Stream& stream, const audio::VADConfig& config) {
+    std::shared_ptr<audio::VAD> vad = audio::create_vad(config);
+    
+    Stream* stream_ptr = &stream;
+    vad->set_state_callback([this, stream_ptr](audio::VAD::State old_state, audio::VAD::State new_state) {
+        on_vad_state_change(*stream_ptr, old_state, new_state);
+    });
+    return vad;
+}
+
+void STTEngine::swap_stream_vad(Stream& stream) {
+    // Wait for the previous VAD to be collected, so the audio thread never
+    // has to destroy one
+    if (std::atomic_load(&stream.retired_vad)) return;
+    stream.vad_swap_pending.store(false, std::memory_order_relaxed);
+    std::shared_ptr<audio::VAD> next = std::atomic_exchange(&stream.next_vad, std::shared_ptr<audio::VAD>());
+    if (!next) return;
+    
+    // The new VAD starts in silence: end the utterance the old one was in,
+    // so it is transcribed rather than dropped at the next speech start
+    audio::VAD::State state = stream.vad->get_state();
+    if (state == audio::VAD::State::SPEECH) {
+        on_vad_state_change(stream, audio::VAD::State::SPEECH, audio::VAD::State::SPEECH_ENDING);
+    }
+    if (state == audio::VAD::State::SPEECH || state == audio::VAD::State::SPEECH_ENDING) {
+        on_vad_state_change(stream, audio::VAD::State::SPEECH_ENDING, audio::VAD::State::SILENCE);
+    }
+    stream.in_speech = false;
+    stream.last_vad_state = audio::VAD::State::SILENCE;
+    
+    std::atomic_store(&stream.retired_vad, std::move(stream.vad));
+    stream.vad = std::move(next);
+    vads_retired_.store(true, std::memory_order_release);
+}
+
+void STTEngine::collect_retired_vads() {
+    if (!vads_retired_.exchange(false, std::memory_order_acquire)) return;
+    for (auto& stream : streams_) {
+        std::atomic_store(&stream->retired_vad, std::shared_ptr<audio::VAD>());
+    }
+}
+
+void STTEngine::on_vad_state_change(Stream& stream, audio::VAD::State old_state, audio::VAD::State new_state) {
+    if (stream.tap) {
+        stream.tap->mark(old_state, new_state);
+    }
+    
+    if (terminal_output_) {
+        bool is_speaking = (new_state == audio::VAD::State::SPEECH || 
+                           new_state == audio::VAD::State::SPEECH_ENDING);
+        terminal_output_->print_vad_status(is_speaking);
+        
+        // Debug: show all state transitions
+        if (old_state == audio::VAD::State::SPEECH_ENDING && new_state == audio::VAD::State::SILENCE) {
+            terminal_output_->print_status("VAD: SPEECH_ENDING -> SILENCE transition detected");
+        }
+    }
+    
+    if (new_state == audio::VAD::State::SPEECH_ENDING) {
+        stream.speech_ending_time = std::chrono::steady_clock::now();
+    }
+    
+    // Start fresh from silence, seeding the buffer with the pre-speech audio.
+    // The onset frame itself is appended by feed_audio once process() returns,
+    // so the pre-roll goes in first and nothing has to be front-inserted later.
+    if (old_state == audio::VAD::State::SILENCE && new_state == audio::VAD::State::SPEECH_MAYBE) {
+        stream.speech_buffer.clear();
+        stream.partial_sent_samples = 0;
+        stream.vad->append_buffered_audio(stream.speech_buffer, stream.frame_samples);
+        
+        if (terminal_output_ && !stream.speech_buffer.empty()) {
+            // Calculate actual energy in pre-speech buffer for debugging
+            float max_energy = audio::dsp::analyze(stream.speech_buffer.data(), stream.speech_buffer.size()).peak;
+            terminal_output_->print_status("Pre-speech buffer: " + 
+                                         std::to_string(stream.speech_buffer.size() / 16000.0f) + 
+                                         " seconds, max amplitude: " + 
+                                         std::to_string(max_energy));
+        }
+    }
+    
+    // Handle speech end - Process COMPLETE utterances only
+    // Note: VAD goes SPEECH -> SPEECH_ENDING -> SILENCE
+    if (old_state == audio::VAD::State::SPEECH_ENDING && new_state == audio::VAD::State::SILENCE) {
+        
+        // Process accumulated speech buffer
+        size_t min_samples = 8000; // 0.5 seconds minimum
+        if (!stream.speech_buffer.empty() && stream.speech_buffer.size() > min_samples && !paused_.load()) {
+            if (terminal_output_) {
+                float duration = stream.speech_buffer.size() / 16000.0f;
+                terminal_output_->print_status("Processing utterance: " + 
+                                             std::to_string(duration) + " seconds");
+            }
+            
+            AudioChunk chunk;
+            chunk.samples = std::move(stream.speech_buffer);
+            chunk.timestamp = std::chrono::steady_clock::now();
+            chunk.is_speech_end = true;
+            chunk.stream = stream.index;
+            chunk.speech_ended = stream.speech_ending_time;
+            record_latency(LatencyStage::VAD_HANGOVER, chunk.timestamp - stream.speech_ending_time);
+            
+            // Debug: Check first 0.5 seconds of audio
+            if (terminal_output_ && chunk.samples.size() > 8000) {
+                float max_in_first_half_sec = audio::dsp::analyze(chunk.samples.data(), 8000).peak;
+                terminal_output_->print_status("First 0.5s max amplitude: " + 
+                                             std::to_string(max_in_first_half_sec));
+            }
+            
+            finish_streaming_utterance(stream);
+            enqueue_chunk(std::move(chunk));
+            
+            stream.speech_buffer = acquire_buffer();
+            stream.partial_sent_samples = 0;
+        } else if (!stream.speech_buffer.empty()) {
+            // Too short, discard
+            if (terminal_output_) {
+                float duration = stream.speech_buffer.size() / 16000.0f;
+                terminal_output_->print_status("Discarding short utterance: " + 
+                                             std::to_string(duration) + " seconds (min: 0.5s)");
+            }
+            stream.speech_buffer.clear();
+            stream.partial_sent_samples = 0;
+            finish_streaming_utterance(stream);
+        }
+    }
+}
+
 void STTEngine::shutdown() {
+    stop_loader();
     stop();
-    whisper_->shutdown();
+    current_whisper()->shutdown();
+    if (partial_whisper_) {
+        partial_whisper_->shutdown();
+    }
     
     if (terminal_output_) {
         terminal_output_->print_status("STT Engine shut down");
@@ -157,8 +298,26 @@ void STTEngine::start() {
     
     // Starting processing thread
     
-    // Start processing thread
-    processing_thread_ = std::thread(&STTEngine::processing_loop, this);
+    // One processing worker per decoder state, so back-to-back utterances
+    // decode concurrently instead of queueing behind each other
+    size_t n_workers = std::max<size_t>(1, current_whisper()->get_pool_size());
+    for (size_t i = 0; i < n_workers; ++i) {
+        processing_threads_.emplace_back(&STTEngine::processing_loop, this);
+    }
+    
+    if (config_.mode == TranscriptionMode::STREAMING) {
+        size_t n_partial_workers = partial_whisper_ ? std::max<size_t>(1, partial_whisper_->get_pool_size()) : 1;
+        for (size_t i = 0; i < n_partial_workers; ++i) {
+            partial_threads_.emplace_back(&STTEngine::partial_loop, this);
+        }
+    }
+    
+    // Start ingest thread if any stream is pulled rather than pushed
+    bool any_source = std::any_of(streams_.begin(), streams_.end(),
+                                  [](const std::unique_ptr<Stream>& stream) { return bool(stream->source); });
+    if (any_source) {
+        ingest_thread_ = std::thread(&STTEngine::ingest_loop, this);
+    }
     
     if (terminal_output_) {
         terminal_output_->print_status("STT Engine started");
@@ -170,11 +329,27 @@ void STTEngine::stop() {
     
     running_ = false;
     queue_cv_.notify_all();
+    partial_cv_.notify_all();
+    
+    if (ingest_thread_.joinable()) {
+        ingest_thread_.join();
+    }
     
-    if (processing_thread_.joinable()) {
-        processing_thread_.join();
+    for (auto& worker : processing_threads_) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+    processing_threads_.clear();
+    
+    for (auto& worker : partial_threads_) {
+        if (worker.joinable()) {
+            worker.join();
+        }
     }
+    partial_threads_.clear();
     
+    collect_retired_vads();
     clear_buffers();
     
     if (terminal_output_) {
@@ -192,40 +367,54 @@ void STTEngine::pause() {
 void STTEngine::resume() {
     paused_ = false;
     queue_cv_.notify_all();
+    partial_cv_.notify_all();
     if (terminal_output_) {
         terminal_output_->print_status("STT Engine resumed");
     }
 }
 
 void STTEngine::feed_audio(const float* samples, size_t n_samples) {
+    feed_audio(0, samples, n_samples);
+}
+
+void STTEngine::feed_audio(size_t stream_index, const float* samples, size_t n_samples) {
     if (!running_.load() || paused_.load()) return;
+    if (stream_index >= streams_.size()) return;
+    
+    Stream& stream = *streams_[stream_index];
+    
+    // A new VAD type from update_vad_config, taken at this frame boundary
+    if (stream.vad_swap_pending.load(std::memory_order_acquire)) {
+        swap_stream_vad(stream);
+    }
     
     // Debug: Check audio samples
     static size_t total_calls = 0;
     static size_t non_zero_calls = 0;
     total_calls++;
     
-    float max_sample = 0.0f;
-    float avg_sample = 0.0f;
-    for (size_t i = 0; i < n_samples; ++i) {
-        avg_sample += std::abs(samples[i]);
-        max_sample = std::max(max_sample, std::abs(samples[i]));
-    }
-    avg_sample /= n_samples;
+    // Peak and mean level in a single vectorized pass
+    audio::dsp::FrameStats level = audio::dsp::analyze(samples, n_samples);
     
-    if (max_sample > 0.0001f) {
+    if (level.peak > 0.0001f) {
         non_zero_calls++;
     }
     
     // Audio stats (debug output disabled)
     
     // Check if VAD is effectively disabled (threshold = 0)
-    bool vad_disabled = config_.vad_config.energy_threshold == 0.0f;
+    bool vad_disabled = stream.vad->get_config().energy_threshold == 0.0f;
     
     // VAD configuration applied
     
+    // Recorded before the VAD sees it, so marks land after their frame
+    if (stream.tap) {
+        stream.tap->write(samples, n_samples);
+    }
+    
     // Run VAD
-    auto vad_state = vad_->process(samples, n_samples);
+    stream.frame_samples = n_samples;
+    auto vad_state = stream.vad->process(samples, n_samples);
     
     // Force SPEECH state if VAD is disabled
     if (vad_disabled) {
@@ -235,11 +424,10 @@ void STTEngine::feed_audio(const float* samples, size_t n_samples) {
     
     // Update audio level display
     if (terminal_output_ && config_.enable_terminal_output) {
-        terminal_output_->print_audio_level(vad_->get_current_energy());
+        terminal_output_->print_audio_level(stream.vad->get_current_energy());
         
         // Debug VAD state changes
-        static audio::VAD::State last_vad_state = audio::VAD::State::SILENCE;
-        if (vad_state != last_vad_state) {
+        if (vad_state != stream.last_vad_state) {
             std::string state_str;
             switch(vad_state) {
                 case audio::VAD::State::SILENCE: state_str = "SILENCE"; break;
@@ -247,10 +435,10 @@ void STTEngine::feed_audio(const float* samples, size_t n_samples) {
                 case audio::VAD::State::SPEECH: state_str = "SPEECH"; break;
                 case audio::VAD::State::SPEECH_ENDING: state_str = "SPEECH_ENDING"; break;
             }
-            terminal_output_->print_status("VAD State: " + state_str + ", Energy: " + 
-                                         std::to_string(vad_->get_current_energy()) + 
-                                         ", Noise floor: " + std::to_string(vad_->get_noise_floor()));
-            last_vad_state = vad_state;
+            terminal_output_->print_status("VAD State [" + stream.id + "]: " + state_str + ", Energy: " + 
+                                         std::to_string(stream.vad->get_current_energy()) + 
+                                         ", Noise floor: " + std::to_string(stream.vad->get_noise_floor()));
+            stream.last_vad_state = vad_state;
         }
     }
     
@@ -262,24 +450,30 @@ void STTEngine::feed_audio(const float* samples, size_t n_samples) {
         vad_state == audio::VAD::State::SPEECH_MAYBE) {
         
         // Add to speech buffer
-        speech_buffer_.insert(speech_buffer_.end(), samples, samples + n_samples);
+        stream.speech_buffer.insert(stream.speech_buffer.end(), samples, samples + n_samples);
+        
+        // In streaming mode, hand confirmed speech to the decoder every step
+        if (config_.mode == TranscriptionMode::STREAMING &&
+            vad_state != audio::VAD::State::SPEECH_MAYBE) {
+            queue_partial_audio(stream);
+        }
         
         // Buffer is growing...
         
         // DON'T process while speaking - just accumulate audio
         // Processing happens only when speech ends (in the VAD callback)
-        in_speech_ = true;
+        stream.in_speech = true;
         
         // Debug: show buffer growth periodically
         static size_t debug_counter = 0;
         if (++debug_counter % 100 == 0 && terminal_output_) {
-            float duration = speech_buffer_.size() / 16000.0f;
+            float duration = stream.speech_buffer.size() / 16000.0f;
             terminal_output_->print_status("Speech buffer: " + 
                                          std::to_string(duration) + " seconds");
         }
     } else if (vad_state == audio::VAD::State::SILENCE) {
-        if (in_speech_) {
-            in_speech_ = false;
+        if (stream.in_speech) {
+            stream.in_speech = false;
         }
     }
     
@@ -287,71 +481,427 @@ void STTEngine::feed_audio(const float* samples, size_t n_samples) {
     metrics_.processed_samples += n_samples;
 }
 
+void STTEngine::set_audio_source(AudioSource source) {
+    set_audio_source(0, std::move(source));
+}
+
+void STTEngine::set_audio_source(size_t stream_index, AudioSource source) {
+    if (stream_index >= streams_.size()) return;
+    streams_[stream_index]->source = std::move(source);
+}
+
+void STTEngine::ingest_loop() {
+    // Feed the VAD whole frames so its timing matches callback-driven input
+    const size_t frame_samples = std::max<size_t>(
+        1, (config_.audio_buffer_size_ms * config_.vad_config.sample_rate) / 1000);
+    for (auto& stream : streams_) {
+        stream->ingest_frame.assign(frame_samples, 0.0f);
+        stream->ingest_filled = 0;
+    }
+    
+    // One thread services every pulled stream; sleep only when all are dry
+    while (running_.load()) {
+        bool fed_any = false;
+        
+        for (auto& stream : streams_) {
+            if (!stream->source) continue;
+            
+            stream->ingest_filled += stream->source(stream->ingest_frame.data() + stream->ingest_filled,
+                                                    frame_samples - stream->ingest_filled);
+            if (stream->ingest_filled == frame_samples) {
+                feed_audio(stream->index, stream->ingest_frame.data(), frame_samples);
+                stream->ingest_filled = 0;
+                fed_any = true;
+            }
+        }
+        
+        // Free VADs replaced by update_vad_config as soon as they are out
+        if (fed_any) {
+            collect_retired_vads();
+        } else {
+            std::this_thread::sleep_for(std::chrono::milliseconds(INGEST_POLL_MS));
+        }
+    }
+}
+
+void STTEngine::queue_partial_audio(Stream& stream) {
+    const size_t step_samples = (config_.partial_step_ms * config_.vad_config.sample_rate) / 1000;
+    if (stream.speech_buffer.size() - stream.partial_sent_samples < step_samples) return;
+    
+    // The window is updated here, in feed order, so the partial workers
+    // only ever snapshot it and the request itself carries no audio
+    auto decoder = partial_decoder();
+    if (stream.partial_sent_samples == 0) {
+        decoder->reset_streaming_state(stream.streaming);
+    }
+    decoder->append_partial(stream.streaming, stream.speech_buffer.data() + stream.partial_sent_samples,
+                           stream.speech_buffer.size() - stream.partial_sent_samples);
+    stream.partial_sent_samples = stream.speech_buffer.size();
+    
+    AudioChunk chunk;
+    chunk.timestamp = std::chrono::steady_clock::now();
+    chunk.is_partial = true;
+    chunk.stream = stream.index;
+    chunk.utterance = stream.utterance.load();
+    
+    enqueue_chunk(std::move(chunk));
+}
+
+void STTEngine::finish_streaming_utterance(Stream& stream) {
+    if (config_.mode != TranscriptionMode::STREAMING) return;
+    
+    // Partials still queued or decoding for this utterance are now stale
+    stream.utterance++;
+    partial_decoder()->reset_streaming_state(stream.streaming);
+}
+
+std::vector<float> STTEngine::acquire_buffer() {
+    {
+        std::lock_guard<std::mutex> lock(buffer_pool_mutex_);
+        if (!buffer_pool_.empty()) {
+            std::vector<float> buffer = std::move(buffer_pool_.back());
+            buffer_pool_.pop_back();
+            buffer.clear();
+            return buffer;
+        }
+    }
+    
+    // Pool ran dry; the buffer joins the pool when it is released
+    std::vector<float> buffer;
+    buffer.reserve(buffer_capacity_);
+    return buffer;
+}
+
+void STTEngine::release_buffer(std::vector<float>&& buffer) {
+    // Only keep buffers with the pooled capacity
+    if (buffer.capacity() < buffer_capacity_) return;
+    
+    std::lock_guard<std::mutex> lock(buffer_pool_mutex_);
+    buffer_pool_.push_back(std::move(buffer));
+}
+
+void STTEngine::enqueue_chunk(AudioChunk&& chunk) {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    if (chunk.is_partial) {
+        // The window is already updated, so a request still waiting for this
+        // utterance will decode the new audio as well
+        Stream& stream = *streams_[chunk.stream];
+        if (stream.queued_partials > 0 && stream.queued_partial_utterance == chunk.utterance) return;
+        
+        stream.queued_partials++;
+        stream.queued_partial_utterance = chunk.utterance;
+        partial_queue_.push(std::move(chunk));
+        partial_cv_.notify_one();
+        return;
+    }
+    
+    if (config_.max_queue_size > 0 && audio_queue_.size() >= config_.max_queue_size) {
+        if (config_.overflow_policy == OverflowPolicy::MERGE && merge_into_queued(chunk)) {
+            release_buffer(std::move(chunk.samples));
+            std::lock_guard<std::mutex> metrics_lock(metrics_mutex_);
+            metrics_.merged_chunks++;
+            return;
+        }
+        
+        AudioChunk dropped = std::move(audio_queue_.front());
+        audio_queue_.pop_front();
+        skip_chunk(dropped);
+        release_buffer(std::move(dropped.samples));
+        {
+            std::lock_guard<std::mutex> metrics_lock(metrics_mutex_);
+            metrics_.dropped_chunks++;
+        }
+        if (terminal_output_) {
+            terminal_output_->print_status("Queue full: dropped oldest utterance");
+        }
+    }
+    
+    chunk.sequence = next_sequence_++;
+    audio_queue_.push_back(std::move(chunk));
+    queue_depth_ = audio_queue_.size();
+    queue_cv_.notify_one();
+}
+
+bool STTEngine::merge_into_queued(AudioChunk& chunk) {
+    // Newest waiting utterance from the same stream, if the two still fit
+    // in one pooled buffer; nothing in the queue is being decoded yet
+    const size_t gap_samples = (MERGE_GAP_MS * config_.vad_config.sample_rate) / 1000;
+    for (auto it = audio_queue_.rbegin(); it != audio_queue_.rend(); ++it) {
+        if (it->stream != chunk.stream) continue;
+        if (it->samples.size() + gap_samples + chunk.samples.size() > buffer_capacity_) return false;
+        
+        it->samples.insert(it->samples.end(), gap_samples, 0.0f);
+        it->samples.insert(it->samples.end(), chunk.samples.begin(), chunk.samples.end());
+        return true;
+    }
+    return false;
+}
+
+void STTEngine::skip_chunk(const AudioChunk& chunk) {
+    // Fill the chunk's delivery slot so later results are not held back;
+    // the next completion releases it
+    std::lock_guard<std::mutex> lock(delivery_mutex_);
+    completed_chunks_[chunk.sequence] = CompletedChunk{chunk.timestamp, {}};
+}
+
 void STTEngine::processing_loop() {
-    // Processing thread started
+    // Processing worker started
     
     while (running_.load()) {
         std::unique_lock<std::mutex> lock(queue_mutex_);
         
-        // Wait for audio or shutdown
+        // Wait for audio or shutdown (resume() wakes us when unpaused)
         queue_cv_.wait(lock, [this] {
-            return !audio_queue_.empty() || !running_.load() || paused_.load();
+            return (!audio_queue_.empty() && !paused_.load()) || !running_.load();
         });
         
         if (!running_.load()) break;
-        if (paused_.load()) continue;
         
         if (!audio_queue_.empty()) {
-            size_t queue_size = audio_queue_.size();
-            AudioChunk chunk = std::move(audio_queue_.front());
-            audio_queue_.pop();
+            std::vector<AudioChunk> batch;
+            batch.push_back(std::move(audio_queue_.front()));
+            audio_queue_.pop_front();
+            
+            // Short utterances from the same stream waiting right behind this
+            // one share its decode; another stream's audio would condition
+            // the decoder on unrelated speech
+            if (config_.batch_short_utterances) {
+                const size_t rate = config_.vad_config.sample_rate;
+                const size_t max_utterance = config_.batch_max_utterance_ms * rate / 1000;
+                const size_t max_batch = config_.batch_max_ms * rate / 1000;
+                const size_t gap = BATCH_GAP_MS * rate / 1000;
+                
+                size_t total = batch.front().samples.size() + gap;
+                if (batch.front().samples.size() <= max_utterance) {
+                    while (!audio_queue_.empty() && batch.size() < BATCH_MAX_UTTERANCES) {
+                        if (audio_queue_.front().stream != batch.front().stream) break;
+                        size_t n = audio_queue_.front().samples.size();
+                        if (n > max_utterance || total + n + gap > max_batch) break;
+                        total += n + gap;
+                        batch.push_back(std::move(audio_queue_.front()));
+                        audio_queue_.pop_front();
+                    }
+                }
+            }
+            queue_depth_ = audio_queue_.size();
+            
+            // Under a backlog, catch up on the faster model
+            bool downgrade = config_.overflow_policy == OverflowPolicy::DOWNGRADE && partial_whisper_ &&
+                             config_.max_queue_size > 0 && audio_queue_.size() >= config_.max_queue_size / 2;
             lock.unlock();
             
-            // Processing chunk from queue
+            {
+                std::lock_guard<std::mutex> metrics_lock(metrics_mutex_);
+                auto now = std::chrono::steady_clock::now();
+                for (const auto& chunk : batch) {
+                    total_queue_wait_ms_ += std::chrono::duration<double, std::milli>(now - chunk.timestamp).count();
+                    queue_wait_count_++;
+                    record_latency(LatencyStage::QUEUE_WAIT, now - chunk.timestamp);
+                }
+                metrics_.avg_queue_wait_ms = static_cast<float>(total_queue_wait_ms_ / queue_wait_count_);
+                if (downgrade) {
+                    metrics_.downgraded_chunks += batch.size();
+                }
+                if (batch.size() > 1) {
+                    metrics_.batched_decodes++;
+                    metrics_.batched_chunks += batch.size();
+                }
+            }
+            
+            // Process the chunk(s)
+            std::vector<std::vector<TranscriptionResult>> results(batch.size());
+            auto decode_start = std::chrono::steady_clock::now();
+            if (batch.size() == 1) {
+                process_audio_chunk(batch.front(), downgrade, results.front());
+            } else {
+                process_audio_batch(batch, downgrade, results);
+            }
+            record_latency(LatencyStage::DECODE, std::chrono::steady_clock::now() - decode_start);
+            
+            for (size_t i = 0; i < batch.size(); ++i) {
+                complete_chunk(batch[i], std::move(results[i]));
+                release_buffer(std::move(batch[i].samples));
+            }
             
-            // Process the chunk
-            process_audio_chunk(chunk);
+            // Pushed streams that swapped VADs after update_vad_config
+            // stopped waiting
+            collect_retired_vads();
         }
     }
     
-    // Processing thread stopped
+    // Processing worker stopped
 }
 
-void STTEngine::process_audio_chunk(const AudioChunk& chunk) {
-    auto start_time = std::chrono::steady_clock::now();
-    
-    // Processing audio chunk
+void STTEngine::partial_loop() {
+    while (running_.load()) {
+        std::unique_lock<std::mutex> lock(queue_mutex_);
+        
+        partial_cv_.wait(lock, [this] {
+            return (!partial_queue_.empty() && !paused_.load()) || !running_.load();
+        });
+        
+        if (!running_.load()) break;
+        
+        AudioChunk chunk = std::move(partial_queue_.front());
+        partial_queue_.pop();
+        
+        Stream& stream = *streams_[chunk.stream];
+        stream.queued_partials--;
+        
+        // Only worth decoding if nothing newer is waiting for this stream,
+        // the utterance is still open, and no other worker is already
+        // decoding its partial
+        bool decode = stream.queued_partials == 0 &&
+                      chunk.utterance == stream.utterance.load() &&
+                      !stream.partial_decode_busy.exchange(true);
+        lock.unlock();
+        
+        if (!decode) continue;
+        
+        std::vector<TranscriptionResult> results;
+        process_partial_chunk(chunk, results);
+        stream.partial_decode_busy = false;
+        
+        complete_partial(chunk, std::move(results));
+    }
+}
+
+void STTEngine::process_audio_chunk(const AudioChunk& chunk, bool downgrade, std::vector<TranscriptionResult>& results) {
+    if (chunk.samples.empty()) return;
     
-    // Process with Whisper
-    whisper_->process_stream(
+    // Process with Whisper; a model swapped in meanwhile applies from the next chunk
+    auto whisper = downgrade ? partial_whisper_ : current_whisper();
+    Stream& stream = *streams_[chunk.stream];
+    whisper->process_stream(
         chunk.samples.data(), 
         chunk.samples.size(),
-        [this, start_time, &chunk](const TranscriptionResult& result) {
+        [&results](TranscriptionResult&& result) {
+            results.push_back(std::move(result));
+        },
+        stream_prompt(stream, whisper, chunk)
+    );
+    update_stream_context(stream, whisper, chunk, results);
+    
+    update_metrics();
+}
+
+std::vector<int> STTEngine::stream_prompt(Stream& stream, const std::shared_ptr<WhisperWrapper>& whisper,
+                                          const AudioChunk& chunk) {
+    if (!config_.carry_context) return {};
+    
+    std::lock_guard<std::mutex> lock(stream.context_mutex);
+    if (stream.context_tokens.empty() || stream.context_model.lock() != whisper) return {};
+    if (chunk.timestamp - stream.context_time > std::chrono::milliseconds(config_.context_max_gap_ms)) return {};
+    return stream.context_tokens;
+}
+
+void STTEngine::update_stream_context(Stream& stream, const std::shared_ptr<WhisperWrapper>& whisper,
+                                      const AudioChunk& chunk, const std::vector<TranscriptionResult>& results) {
+    if (!config_.carry_context || results.empty()) return;
+    
+    // Finals of one stream may finish out of order; keep the newest
+    std::lock_guard<std::mutex> lock(stream.context_mutex);
+    if (chunk.sequence + 1 <= stream.context_sequence) return;
+    
+    stream.context_tokens = whisper->get_prompt_tokens(results.back(), config_.context_max_tokens);
+    stream.context_model = whisper;
+    stream.context_sequence = chunk.sequence + 1;
+    stream.context_time = chunk.timestamp;
+}
+
+void STTEngine::process_audio_batch(const std::vector<AudioChunk>& batch, bool downgrade,
+                                    std::vector<std::vector<TranscriptionResult>>& results) {
+    std::vector<std::pair<const float*, size_t>> utterances;
+    utterances.reserve(batch.size());
+    for (const auto& chunk : batch) {
+        utterances.emplace_back(chunk.samples.data(), chunk.samples.size());
+    }
+    
+    // The joined audio is prompted with its stream's context. Batches are
+    // built from one stream; should one ever span several, no stream's
+    // text is fed as context to another's audio.
+    auto whisper = downgrade ? partial_whisper_ : current_whisper();
+    bool one_stream = std::all_of(batch.begin(), batch.end(), [&batch](const AudioChunk& chunk) {
+        return chunk.stream == batch.front().stream;
+    });
+    whisper->process_batch(utterances, BATCH_GAP_MS,
+        [&results](size_t utterance, TranscriptionResult&& result) {
+            results[utterance].push_back(std::move(result));
+        },
+        one_stream ? stream_prompt(*streams_[batch.front().stream], whisper, batch.front()) : std::vector<int>()
+    );
+    for (size_t i = 0; i < batch.size(); ++i) {
+        update_stream_context(*streams_[batch[i].stream], whisper, batch[i], results[i]);
+    }
+    
+    update_metrics();
+}
+
+void STTEngine::process_partial_chunk(const AudioChunk& chunk, std::vector<TranscriptionResult>& results) {
+    partial_decoder()->decode_partial(
+        streams_[chunk.stream]->streaming,
+        [&results](TranscriptionResult&& result) {
+            results.push_back(std::move(result));
+        }
+    );
+}
+
+void STTEngine::complete_chunk(const AudioChunk& chunk, std::vector<TranscriptionResult>&& results) {
+    // Workers finish out of order; release results strictly by sequence
+    std::lock_guard<std::mutex> lock(delivery_mutex_);
+    for (auto& result : results) {
+        result.stream_id = streams_[chunk.stream]->id;
+    }
+    completed_chunks_[chunk.sequence] = CompletedChunk{chunk.timestamp, std::move(results),
+                                                       std::chrono::steady_clock::now(), chunk.speech_ended};
+    
+    auto it = completed_chunks_.begin();
+    while (it != completed_chunks_.end() && it->first == next_delivery_sequence_) {
+        if (!it->second.results.empty()) {
+            record_latency(LatencyStage::REORDER_WAIT, std::chrono::steady_clock::now() - it->second.decoded);
+        }
+        for (auto& result : it->second.results) {
             // Calculate latency
-            auto end_time = std::chrono::steady_clock::now();
-            auto latency = std::chrono::duration_cast<std::chrono::milliseconds>(
-                end_time - chunk.timestamp
-            );
-            
-            // Update result with latency
-            TranscriptionResult final_result = result;
-            final_result.processing_time = latency;
+            auto now = std::chrono::steady_clock::now();
+            auto elapsed = now - it->second.timestamp;
+            auto latency = std::chrono::duration_cast<std::chrono::milliseconds>(elapsed);
+            result.processing_time = latency;
+            result.speech_latency = std::chrono::duration_cast<std::chrono::milliseconds>(now - it->second.speech_ended);
+            record_latency(LatencyStage::DECISION_TO_DELIVERY, elapsed);
+            record_latency(LatencyStage::SPEECH_TO_DELIVERY, now - it->second.speech_ended);
             
             // Handle the transcription
-            handle_transcription(final_result);
+            handle_transcription(result);
             
             // Update metrics
-            {
-                std::lock_guard<std::mutex> lock(metrics_mutex_);
+            if (result.is_final) {
+                std::lock_guard<std::mutex> metrics_lock(metrics_mutex_);
                 metrics_.transcriptions_count++;
                 metrics_.avg_latency_ms = 
                     (metrics_.avg_latency_ms * (metrics_.transcriptions_count - 1) + 
                      latency.count()) / metrics_.transcriptions_count;
             }
         }
-    );
+        
+        it = completed_chunks_.erase(it);
+        next_delivery_sequence_++;
+    }
+}
+
+void STTEngine::complete_partial(const AudioChunk& chunk, std::vector<TranscriptionResult>&& results) {
+    // Partials skip the reorder map: only the newest per stream is decoded,
+    // so there is nothing to order them against except their own final
+    std::lock_guard<std::mutex> lock(delivery_mutex_);
+    const Stream& stream = *streams_[chunk.stream];
+    if (chunk.utterance != stream.utterance.load()) return;
     
-    update_metrics();
+    for (auto& result : results) {
+        result.stream_id = stream.id;
+        auto elapsed = std::chrono::steady_clock::now() - chunk.timestamp;
+        result.processing_time = std::chrono::duration_cast<std::chrono::milliseconds>(elapsed);
+        record_latency(LatencyStage::PARTIAL, elapsed);
+        handle_transcription(result);
+    }
 }
 
 void STTEngine::handle_transcription(const TranscriptionResult& result) {
@@ -363,7 +913,11 @@ void STTEngine::handle_transcription(const TranscriptionResult& result) {
     
     // Call user callback
     if (transcription_callback_) {
+        auto start = std::chrono::steady_clock::now();
         transcription_callback_(result);
+        if (result.is_final) {
+            record_latency(LatencyStage::CALLBACK, std::chrono::steady_clock::now() - start);
+        }
     }
 }
 
@@ -372,7 +926,14 @@ void STTEngine::set_transcription_callback(TranscriptionCallback callback) {
 }
 
 void STTEngine::set_language(const std::string& language) {
-    whisper_->set_language(language);
+    {
+        std::lock_guard<std::mutex> lock(model_mutex_);
+        config_.model_config.language = language;
+        current_whisper()->set_language(language);
+    }
+    if (partial_whisper_) {
+        partial_whisper_->set_language(language);
+    }
     if (terminal_output_) {
         terminal_output_->print_status("Language set to: " + language);
     }
@@ -386,39 +947,224 @@ void STTEngine::set_vad_enabled(bool enabled) {
 }
 
 void STTEngine::update_vad_config(const audio::VADConfig& config) {
-    vad_->update_config(config);
-    config_.vad_config = config;
+    std::lock_guard<std::mutex> update_lock(vad_update_mutex_);
+    
+    audio::VADConfig next = config;
+    next.sample_rate = config_.vad_config.sample_rate;
+    
+    // Same kind of VAD: publish the settings and let each stream's ingest
+    // path pick them up between frames
+    auto built = std::atomic_load(&vad_config_);
+    bool new_model = next.type == audio::VADConfig::Type::NEURAL &&
+                     (next.neural_model_path != built->neural_model_path ||
+                      next.neural_batch_ms != built->neural_batch_ms ||
+                      next.neural_context_ms != built->neural_context_ms);
+    if (next.type == built->type && !new_model) {
+        for (auto& stream : streams_) {
+            stream->newest_vad->update_config(next);
+        }
+        std::atomic_store(&vad_config_, std::make_shared<const audio::VADConfig>(next));
+        return;
+    }
+    
+    // Anything still retired would hold up the swap below
+    collect_retired_vads();
+    
+    // A different VAD type means new VAD objects. They are built here, and
+    // each stream swaps its own in at its next frame; processing, queued
+    // finals and deliveries carry on meanwhile. A VAD never swapped in is
+    // destroyed here, one swapped out by the ingest thread (pulled
+    // streams) or, after waiting for the swap, here (pushed streams).
+    for (auto& stream : streams_) {
+        stream->newest_vad = create_stream_vad(*stream, next);
+        std::atomic_store(&stream->next_vad, stream->newest_vad);
+        stream->vad_swap_pending.store(true, std::memory_order_release);
+    }
+    std::atomic_store(&vad_config_, std::make_shared<const audio::VADConfig>(next));
+    
+    // Pushed audio may arrive on a real-time thread, which must not free a
+    // VAD; give it a few frames to take the new one
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(VAD_SWAP_WAIT_MS);
+    auto unswapped = [this] {
+        return std::any_of(streams_.begin(), streams_.end(), [](const std::unique_ptr<Stream>& stream) {
+            return !stream->source && std::atomic_load(&stream->next_vad);
+        });
+    };
+    while (running_.load() && !paused_.load() && std::chrono::steady_clock::now() < deadline && unswapped()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(INGEST_POLL_MS));
+    }
+    collect_retired_vads();
 }
 
-void STTEngine::set_model(const std::string& model_path) {
-    // Stop processing during model switch
-    bool was_running = running_.load();
-    if (was_running) {
-        stop();
+// Everything WhisperWrapper lets change between utterances
+static void apply_decode_settings(WhisperWrapper& whisper, const ModelConfig& config) {
+    whisper.set_language(config.language);
+    whisper.set_translate(config.translate);
+    whisper.set_beam_size(config.beam_size);
+    whisper.set_temperature(config.temperature);
+    whisper.set_adaptive_audio_ctx(config.adaptive_audio_ctx);
+    whisper.set_cascade(config.cascade_decode, config.cascade_min_confidence, config.cascade_min_avg_logprob);
+}
+
+void STTEngine::update_model_config(const ModelConfig& config) {
+    bool new_model;
+    {
+        std::lock_guard<std::mutex> lock(model_mutex_);
+        new_model = config.model_path != config_.model_config.model_path;
+        
+        // The path changes once the loader has the model; until then the
+        // current one keeps serving with the new decode settings
+        std::string model_path = config_.model_config.model_path;
+        config_.model_config = config;
+        config_.model_config.model_path = model_path;
+        apply_decode_settings(*current_whisper(), config);
+    }
+    if (partial_whisper_) {
+        partial_whisper_->set_language(config.language);
+        partial_whisper_->set_translate(config.translate);
     }
     
-    // Update config with new model path
-    config_.model_config.model_path = model_path;
-    
-    // Create new whisper instance
-    whisper_ = std::make_unique<WhisperWrapper>();
+    if (new_model) {
+        set_model(config.model_path);
+    }
+}
+
+void STTEngine::set_model(const std::string& model_path) {
+    {
+        std::lock_guard<std::mutex> lock(loader_mutex_);
+        pending_model_path_ = model_path;
+        model_loading_ = true;
+        if (!loader_running_) {
+            if (loader_thread_.joinable()) {
+                loader_thread_.join();
+            }
+            loader_running_ = true;
+            loader_thread_ = std::thread(&STTEngine::loader_loop, this);
+        }
+    }
+    loader_cv_.notify_one();
     
-    // Initialize with updated config
-    if (!whisper_->initialize(config_.model_config)) {
-        throw std::runtime_error("Failed to load model: " + model_path);
+    if (terminal_output_) {
+        terminal_output_->print_status("Loading model: " + model_path);
+    }
+}
+
+void STTEngine::set_model_load_callback(ModelLoadCallback callback) {
+    model_load_callback_ = callback;
+}
+
+std::string STTEngine::get_model_path() const {
+    std::lock_guard<std::mutex> lock(model_mutex_);
+    return config_.model_config.model_path;
+}
+
+STTEngine::Config STTEngine::get_current_config() const {
+    Config config;
+    {
+        std::lock_guard<std::mutex> lock(model_mutex_);
+        config = config_;
+    }
+    if (auto vad_config = std::atomic_load(&vad_config_)) {
+        config.vad_config = *vad_config;
     }
+    return config;
+}
+
+void STTEngine::loader_loop() {
+    std::unique_lock<std::mutex> lock(loader_mutex_);
     
-    // Restart if was running
-    if (was_running) {
-        start();
+    while (true) {
+        loader_cv_.wait(lock, [this] { return !pending_model_path_.empty() || !loader_running_; });
+        if (!loader_running_) break;
+        
+        std::string model_path = std::move(pending_model_path_);
+        pending_model_path_.clear();
+        lock.unlock();
+        
+        ModelConfig model_config;
+        {
+            std::lock_guard<std::mutex> model_lock(model_mutex_);
+            model_config = config_.model_config;
+        }
+        model_config.model_path = model_path;
+        
+        // The old model keeps serving while this loads
+        auto next = std::make_shared<WhisperWrapper>();
+        bool success = next->initialize(model_config);
+        if (success && config_.warm_up) {
+            next->warm_up();
+        }
+        
+        if (success) {
+            std::lock_guard<std::mutex> model_lock(model_mutex_);
+            
+            // Settings changed during the load apply to the new model too
+            apply_decode_settings(*next, config_.model_config);
+            next->set_segment_metadata(config_.segment_metadata || config_.carry_context);
+            config_.model_config.model_path = model_path;
+            
+            // Chunks already decoding finish on the old model, which is
+            // freed when the last of them drops its reference
+            std::atomic_store(&whisper_, next);
+        }
+        
+        if (terminal_output_) {
+            if (success) {
+                terminal_output_->print_status("Model changed to: " + model_path);
+            } else {
+                terminal_output_->print_error("Failed to load model: " + model_path);
+            }
+        }
+        if (model_load_callback_) {
+            model_load_callback_(model_path, success);
+        }
+        
+        lock.lock();
+        if (pending_model_path_.empty()) {
+            model_loading_ = false;
+        }
+    }
+}
+
+void STTEngine::stop_loader() {
+    {
+        std::lock_guard<std::mutex> lock(loader_mutex_);
+        loader_running_ = false;
+        pending_model_path_.clear();
     }
+    loader_cv_.notify_all();
     
+    if (loader_thread_.joinable()) {
+        loader_thread_.join();
+    }
+    model_loading_ = false;
+}
+
+void STTEngine::set_adaptive_audio_ctx(bool enabled) {
+    {
+        std::lock_guard<std::mutex> lock(model_mutex_);
+        config_.model_config.adaptive_audio_ctx = enabled;
+        current_whisper()->set_adaptive_audio_ctx(enabled);
+    }
     if (terminal_output_) {
-        terminal_output_->print_status("Model changed to: " + model_path);
+        terminal_output_->print_status("Adaptive audio_ctx " + std::string(enabled ? "enabled" : "disabled"));
+    }
+}
+
+void STTEngine::set_segment_metadata(bool enabled) {
+    std::lock_guard<std::mutex> lock(model_mutex_);
+    config_.segment_metadata = enabled;
+    current_whisper()->set_segment_metadata(enabled || config_.carry_context);
+    if (partial_whisper_) {
+        partial_whisper_->set_segment_metadata(enabled || config_.carry_context);
     }
 }
 
 void STTEngine::update_metrics() {
+    // Several workers may finish at once; one refresh is enough
+    std::unique_lock<std::mutex> update_lock(metrics_update_mutex_, std::try_to_lock);
+    if (!update_lock.owns_lock()) return;
+    
     auto now = std::chrono::steady_clock::now();
     if (now - last_metrics_update_ < std::chrono::seconds(1)) {
         return;
@@ -472,7 +1218,11 @@ void STTEngine::update_metrics() {
     // Update RTF
     {
         std::lock_guard<std::mutex> lock(metrics_mutex_);
-        metrics_.avg_rtf = whisper_->get_rtf();
+        auto whisper = current_whisper();
+        metrics_.avg_rtf = whisper->get_rtf();
+        metrics_.avg_audio_ctx = whisper->get_avg_audio_ctx();
+        metrics_.cascade_decodes = whisper->get_cascade_decodes();
+        metrics_.cascade_fallbacks = whisper->get_cascade_fallbacks();
     }
     
     // Display metrics
@@ -480,26 +1230,78 @@ void STTEngine::update_metrics() {
         terminal_output_->update_metrics(
             metrics_.cpu_usage,
             metrics_.memory_usage_mb,
-            1 // Active threads (simplified)
+            static_cast<int>(processing_threads_.size())
         );
     }
 }
 
+const char* STTEngine::latency_stage_name(LatencyStage stage) {
+    switch (stage) {
+        case LatencyStage::SPEECH_TO_DELIVERY: return "speech_to_delivery";
+        case LatencyStage::DECISION_TO_DELIVERY: return "decision_to_delivery";
+        case LatencyStage::VAD_HANGOVER: return "vad_hangover";
+        case LatencyStage::QUEUE_WAIT: return "queue_wait";
+        case LatencyStage::DECODE: return "decode";
+        case LatencyStage::REORDER_WAIT: return "reorder_wait";
+        case LatencyStage::CALLBACK: return "callback";
+        case LatencyStage::PARTIAL: return "partial";
+        default: return "unknown";
+    }
+}
+
 STTEngine::Metrics STTEngine::get_metrics() const {
     std::lock_guard<std::mutex> lock(metrics_mutex_);
-    return metrics_;
+    Metrics metrics = metrics_;
+    metrics.queue_depth = queue_depth_.load();
+    return metrics;
+}
+
+size_t STTEngine::get_pending_finals() {
+    // Read the enqueue side first: delivery never runs ahead of it
+    uint64_t queued;
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        queued = next_sequence_;
+    }
+    std::lock_guard<std::mutex> lock(delivery_mutex_);
+    return static_cast<size_t>(queued - next_delivery_sequence_);
 }
 
 void STTEngine::clear_buffers() {
-    speech_buffer_.clear();
-    in_speech_ = false;
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        while (!audio_queue_.empty()) {
+            release_buffer(std::move(audio_queue_.front().samples));
+            audio_queue_.pop_front();
+        }
+        queue_depth_ = 0;
+        partial_queue_ = std::queue<AudioChunk>();
+        next_sequence_ = 0;
+        for (auto& stream : streams_) {
+            stream->queued_partials = 0;
+        }
+    }
     
-    std::lock_guard<std::mutex> lock(queue_mutex_);
-    while (!audio_queue_.empty()) {
-        audio_queue_.pop();
+    {
+        std::lock_guard<std::mutex> lock(delivery_mutex_);
+        completed_chunks_.clear();
+        next_delivery_sequence_ = 0;
     }
     
-    vad_->reset();
+    for (auto& stream : streams_) {
+        stream->speech_buffer.clear();
+        stream->partial_sent_samples = 0;
+        stream->in_speech = false;
+        stream->ingest_filled = 0;
+        partial_decoder()->reset_streaming_state(stream->streaming);
+        stream->utterance++;
+        stream->vad->reset();
+        
+        std::lock_guard<std::mutex> context_lock(stream->context_mutex);
+        stream->context_tokens.clear();
+        stream->context_model.reset();
+        stream->context_sequence = 0;
+    }
 }
 
 } // namespace stt
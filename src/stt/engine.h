@@ -3,30 +3,92 @@
 
 #include "stt/whisper_wrapper.h"
 #include "audio/vad.h"
+#include "audio/audio_tap.h"
 #include "utils/terminal_output.h"
+#include "utils/histogram.h"
+#include <array>
 #include <memory>
 #include <atomic>
 #include <thread>
 #include <queue>
+#include <deque>
+#include <map>
+#include <vector>
 #include <mutex>
 #include <condition_variable>
+#include <string>
 
 namespace rt_stt {
 namespace stt {
 
 class STTEngine {
 public:
+    enum class TranscriptionMode {
+        UTTERANCE,  // One final result after each utterance ends
+        STREAMING   // Partial results on a sliding window while speaking, then a final
+    };
+    
+    // What enqueueing a final does when max_queue_size utterances are waiting
+    enum class OverflowPolicy {
+        DROP_OLDEST,  // Discard the oldest waiting utterance
+        MERGE,        // Append to the stream's newest waiting utterance (one decode); else drop oldest
+        DOWNGRADE     // Decode on the partial model once half full; drop oldest when full
+    };
+    
     struct Config {
         ModelConfig model_config;
+        
+        // STREAMING: optional fast model (e.g. tiny.en/base.en) that decodes
+        // partials on its own workers while model_config decodes finals.
+        // An empty model_path decodes partials with model_config. Also the
+        // catch-up model for OverflowPolicy::DOWNGRADE.
+        ModelConfig partial_model_config;
         audio::VADConfig vad_config;
+        TranscriptionMode mode = TranscriptionMode::UTTERANCE;
+        size_t partial_step_ms = 1000; // STREAMING: new audio between partial results
         bool enable_terminal_output = false;
         bool measure_performance = true;
         size_t audio_buffer_size_ms = 30;
-        size_t max_queue_size = 100;
+        size_t max_queue_size = 100;     // Finals waiting for a decoder; 0 = unbounded
+        OverflowPolicy overflow_policy = OverflowPolicy::DROP_OLDEST;
+        size_t max_utterance_ms = 30000; // Capacity reserved for each pooled speech buffer
+        bool warm_up = true;             // Silent decode per model before it serves (initialize, set_model)
+        
+        // Join consecutive waiting utterances of one stream, each no longer
+        // than batch_max_utterance_ms, into one decode of at most
+        // batch_max_ms, so short commands share the fixed encoder cost
+        bool batch_short_utterances = false;
+        size_t batch_max_utterance_ms = 2000;
+        size_t batch_max_ms = 20000;
+        
+        // Prompt each final with the tail of the stream's previous final
+        // (at most context_max_tokens tokens), unless more than
+        // context_max_gap_ms has passed since it
+        bool carry_context = false;      // Needs token ids, so keeps them even without segment_metadata
+        size_t context_max_tokens = 64;
+        size_t context_max_gap_ms = 30000;
+        
+        // Per-segment text and token ids on results; off when nobody reads them
+        bool segment_metadata = true;
+        
+        // Independent capture streams sharing the loaded model(s); each gets
+        // its own VAD and speech buffer. Empty means a single "default" stream.
+        std::vector<std::string> stream_ids;
+        
+        // Record what each stream is fed, and its VAD transitions, into a
+        // memory-mapped ring file holding the last tap_seconds (see
+        // audio::AudioTap; replay with rt-stt-replay). Streams after the
+        // first append ".<stream id>" to the path. Empty disables.
+        std::string tap_path;
+        size_t tap_seconds = 300;
     };
     
     using TranscriptionCallback = std::function<void(const TranscriptionResult&)>;
     
+    // Pull-mode audio source, e.g. AudioCapture::read_samples. Returns the
+    // number of samples written to buffer (0 when nothing is ready).
+    using AudioSource = std::function<size_t(float* buffer, size_t max_samples)>;
+    
     STTEngine();
     ~STTEngine();
     
@@ -42,8 +104,18 @@ public:
     bool is_running() const { return running_.load(); }
     bool is_paused() const { return paused_.load(); }
     
-    // Audio input
+    // Audio input (the single-argument forms address stream 0)
     void feed_audio(const float* samples, size_t n_samples);
+    void feed_audio(size_t stream, const float* samples, size_t n_samples);
+    
+    // Drain audio from a pull-mode source on a dedicated ingest thread
+    // instead of calling feed_audio from the audio thread. Set before start().
+    void set_audio_source(AudioSource source);
+    void set_audio_source(size_t stream, AudioSource source);
+    
+    // Streams, in Config::stream_ids order
+    size_t get_stream_count() const { return streams_.size(); }
+    const std::string& get_stream_id(size_t stream) const { return streams_[stream]->id; }
     
     // Callbacks
     void set_transcription_callback(TranscriptionCallback callback);
@@ -51,14 +123,55 @@ public:
     // Configuration
     void set_language(const std::string& language);
     void set_vad_enabled(bool enabled);
+    
+    // Live updates, safe while the pipeline runs. The VADs take new
+    // settings at their next frame and decodes at their next utterance,
+    // so neither waits on the caller. A different VAD type (or a new
+    // neural model) is built on the caller's thread and each stream swaps
+    // it in between frames, ending an utterance in progress; nothing queued
+    // is lost. The sample rate is fixed at initialize().
     void update_vad_config(const audio::VADConfig& config);
+    
+    // Language, translate, beam size, temperature, adaptive audio_ctx and
+    // cascade settings apply from the next utterance; a different
+    // model_path loads in the background (set_model). Load-time settings
+    // (threads, decoders, GPU, mmap) take effect with the next model load.
+    void update_model_config(const ModelConfig& config);
+    
+    // Load a new main model on a background thread while the current one
+    // keeps decoding; it is swapped in between chunks once loaded, so no
+    // audio or queued utterance is lost. A newer request supersedes one
+    // still loading. The callback reports each load's outcome.
+    using ModelLoadCallback = std::function<void(const std::string& model_path, bool success)>;
     void set_model(const std::string& model_path);
-    Config get_current_config() const { return config_; }
+    void set_model_load_callback(ModelLoadCallback callback);
+    bool is_model_loading() const { return model_loading_.load(); }
+    std::string get_model_path() const;
+    void set_adaptive_audio_ctx(bool enabled);
+    void set_segment_metadata(bool enabled);
+    Config get_current_config() const;
+    
+    // Where initialize() spent its time
+    struct StartupTiming {
+        float model_load_ms = 0.0f;  // Main and partial models
+        float warm_up_ms = 0.0f;
+    };
+    StartupTiming get_startup_timing() const { return startup_timing_; }
     
     // Performance metrics
     struct Metrics {
         float avg_latency_ms = 0.0f;
         float avg_rtf = 0.0f;
+        float avg_audio_ctx = 0.0f;  // Mean encoder frames per decode (1500 = full window)
+        size_t cascade_decodes = 0;  // Finals decoded greedy-first (ModelConfig::cascade_decode)
+        size_t cascade_fallbacks = 0; // ...that fell back to the full strategy
+        size_t queue_depth = 0;       // Finals waiting for a decoder
+        float avg_queue_wait_ms = 0.0f; // Time finals spent waiting for a decoder
+        size_t dropped_chunks = 0;    // Finals discarded on overflow
+        size_t merged_chunks = 0;     // Finals appended to a waiting one on overflow
+        size_t downgraded_chunks = 0; // Finals decoded on the partial model under backlog
+        size_t batched_decodes = 0;   // Decodes that covered several utterances
+        size_t batched_chunks = 0;    // ...and the utterances they covered
         float cpu_usage = 0.0f;
         size_t memory_usage_mb = 0;
         size_t processed_samples = 0;
@@ -67,12 +180,91 @@ public:
     
     Metrics get_metrics() const;
     
+    // Finals queued or decoding whose results have not been delivered yet;
+    // zero once everything handed to the engine so far has come out
+    size_t get_pending_finals();
+    
+    // Where a result's latency goes, recorded per result into lock-free
+    // histograms. Finals pass through every stage but PARTIAL.
+    enum class LatencyStage {
+        SPEECH_TO_DELIVERY,    // Last voiced frame -> final delivered
+        DECISION_TO_DELIVERY,  // Speech end decision -> final delivered
+        VAD_HANGOVER,  // Last voiced frame (SPEECH_ENDING) -> speech end decision
+        QUEUE_WAIT,    // Queued -> picked up by a decoder
+        DECODE,        // Whisper inference, per decode call
+        REORDER_WAIT,  // Decoded -> released in queue order
+        CALLBACK,      // Transcription callback for a final (JSON build and IPC fan-out)
+        PARTIAL,       // STREAMING: partial requested -> delivered
+        COUNT
+    };
+    static const char* latency_stage_name(LatencyStage stage);
+    utils::LatencyHistogram::Snapshot get_latency_snapshot(LatencyStage stage) const {
+        return latency_[static_cast<size_t>(stage)].snapshot();
+    }
+    
 private:
     // Core components
-    std::unique_ptr<WhisperWrapper> whisper_;
-    std::unique_ptr<audio::VAD> vad_;
+    // The main model is swapped atomically by set_model; workers take a
+    // reference per chunk through current_whisper()
+    std::shared_ptr<WhisperWrapper> whisper_;
+    std::shared_ptr<WhisperWrapper> partial_whisper_;  // Null unless Config::partial_model_config is set
+    std::shared_ptr<WhisperWrapper> current_whisper() const { return std::atomic_load(&whisper_); }
+    mutable std::mutex model_mutex_;  // Guards config_.model_config against the loader
+    
+    // config_.vad_config is what initialize() built the streams with; the
+    // settings in effect since, type changes included, are published here
+    std::shared_ptr<const audio::VADConfig> vad_config_;
+    std::mutex vad_update_mutex_;     // Serializes update_vad_config callers
+    std::atomic<bool> vads_retired_{false};  // Some Stream::retired_vad needs freeing
+    
     std::unique_ptr<utils::TerminalOutput> terminal_output_;
     
+    // Per-stream capture state; the models are shared
+    struct Stream {
+        std::string id;
+        size_t index = 0;
+        std::shared_ptr<audio::VAD> vad;       // Thread feeding the stream only
+        std::shared_ptr<audio::VAD> newest_vad; // vad_update_mutex_; vad or the one about to replace it
+        
+        // A replacement VAD waits in next_vad until feed_audio swaps it in
+        // between frames; the old one goes to retired_vad and is destroyed
+        // by collect_retired_vads, never on the audio thread (a neural VAD
+        // joins its worker). atomic_load / atomic_store / atomic_exchange only.
+        std::shared_ptr<audio::VAD> next_vad;
+        std::shared_ptr<audio::VAD> retired_vad;
+        std::atomic<bool> vad_swap_pending{false};
+        std::unique_ptr<audio::AudioTap> tap;  // Config::tap_path
+        
+        // Speech buffer for VAD (pooled; moved into the chunk at speech end)
+        std::vector<float> speech_buffer;
+        size_t frame_samples = 0;        // Size of the frame currently in VAD::process
+        bool in_speech = false;
+        size_t partial_sent_samples = 0; // STREAMING: speech_buffer prefix already in the window
+        audio::VAD::State last_vad_state = audio::VAD::State::SILENCE;
+        std::chrono::steady_clock::time_point speech_ending_time;  // Entered SPEECH_ENDING
+        
+        // Pull-mode input, drained by the ingest thread
+        AudioSource source;
+        std::vector<float> ingest_frame;
+        size_t ingest_filled = 0;
+        
+        // STREAMING: sliding window and decode bookkeeping
+        WhisperWrapper::StreamingState streaming;
+        size_t queued_partials = 0;               // Guarded by queue_mutex_
+        uint64_t queued_partial_utterance = 0;    // Guarded by queue_mutex_
+        std::atomic<bool> partial_decode_busy{false};
+        std::atomic<uint64_t> utterance{0};       // Bumped when an utterance is finalized or dropped
+        
+        // Prompt carried from the latest final (Config::carry_context).
+        // Token ids only mean something to the model that produced them.
+        std::mutex context_mutex;
+        std::vector<int> context_tokens;
+        std::weak_ptr<WhisperWrapper> context_model;
+        uint64_t context_sequence = 0;            // Sequence + 1 of the final it came from
+        std::chrono::steady_clock::time_point context_time;
+    };
+    std::vector<std::unique_ptr<Stream>> streams_;
+    
     // State
     std::atomic<bool> running_{false};
     std::atomic<bool> paused_{false};
@@ -84,31 +276,105 @@ private:
         std::chrono::steady_clock::time_point timestamp;
         bool is_speech_start = false;
         bool is_speech_end = false;
+        bool is_partial = false; // Decode the stream's streaming window; carries no samples
+        uint64_t sequence = 0;   // Queue order of finals; their results are delivered in this order
+        size_t stream = 0;       // Index into streams_
+        uint64_t utterance = 0;  // Stream::utterance when queued; stale partials are dropped
+        std::chrono::steady_clock::time_point speech_ended{};  // Finals: Stream::speech_ending_time
     };
     
-    std::queue<AudioChunk> audio_queue_;
+    std::deque<AudioChunk> audio_queue_;   // Finals, bounded by Config::max_queue_size
     std::mutex queue_mutex_;
     std::condition_variable queue_cv_;
+    uint64_t next_sequence_ = 0;
+    
+    // STREAMING: partial decode requests, kept apart from finals so a long
+    // final decode never holds up the next partial
+    std::queue<AudioChunk> partial_queue_;
+    std::condition_variable partial_cv_;
     
-    // Processing thread
-    std::thread processing_thread_;
+    // Processing workers, one per whisper decoder state
+    std::vector<std::thread> processing_threads_;
     void processing_loop();
     
-    // Speech buffer for VAD
-    std::vector<float> speech_buffer_;
-    bool in_speech_ = false;
-    std::chrono::steady_clock::time_point speech_start_time_;
+    // Partial workers, one per partial_whisper_ state (or a single worker
+    // sharing whisper_'s states)
+    std::vector<std::thread> partial_threads_;
+    void partial_loop();
+    
+    // In-order delivery of results from concurrently decoded chunks
+    struct CompletedChunk {
+        std::chrono::steady_clock::time_point timestamp;
+        std::vector<TranscriptionResult> results;
+        std::chrono::steady_clock::time_point decoded{};
+        std::chrono::steady_clock::time_point speech_ended{};
+    };
+    std::mutex delivery_mutex_;
+    std::map<uint64_t, CompletedChunk> completed_chunks_;
+    uint64_t next_delivery_sequence_ = 0;
+    
+    // Reusable sample buffers for speech and chunks, so queueing an
+    // utterance does not allocate once the pool has warmed up
+    std::mutex buffer_pool_mutex_;
+    std::vector<std::vector<float>> buffer_pool_;
+    size_t buffer_capacity_ = 0;
+    std::vector<float> acquire_buffer();
+    void release_buffer(std::vector<float>&& buffer);
+    
+    // Background model loader (set_model)
+    std::thread loader_thread_;
+    std::mutex loader_mutex_;
+    std::condition_variable loader_cv_;
+    std::string pending_model_path_;    // Guarded by loader_mutex_; latest request wins
+    bool loader_running_ = false;       // Guarded by loader_mutex_
+    std::atomic<bool> model_loading_{false};
+    ModelLoadCallback model_load_callback_;
+    void loader_loop();
+    void stop_loader();
+    
+    // Ingest thread (pull mode): every stream's source -> feed_audio
+    std::thread ingest_thread_;
+    void ingest_loop();
     
     // Callbacks
     TranscriptionCallback transcription_callback_;
     
     // Metrics tracking
     mutable std::mutex metrics_mutex_;
+    std::mutex metrics_update_mutex_;
     Metrics metrics_;
     std::chrono::steady_clock::time_point last_metrics_update_;
+    StartupTiming startup_timing_;
+    double total_queue_wait_ms_ = 0.0;  // Guarded by metrics_mutex_
+    size_t queue_wait_count_ = 0;
+    std::atomic<size_t> queue_depth_{0};
+    std::array<utils::LatencyHistogram, static_cast<size_t>(LatencyStage::COUNT)> latency_;
+    void record_latency(LatencyStage stage, std::chrono::steady_clock::duration elapsed) {
+        latency_[static_cast<size_t>(stage)].record_us(static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count()));
+    }
     
     // Helper methods
-    void process_audio_chunk(const AudioChunk& chunk);
+    std::shared_ptr<audio::VAD> create_stream_vad(Stream& stream, const audio::VADConfig& config);
+    void swap_stream_vad(Stream& stream);
+    void collect_retired_vads();  // Any thread but the one that may be real-time
+    void on_vad_state_change(Stream& stream, audio::VAD::State old_state, audio::VAD::State new_state);
+    void enqueue_chunk(AudioChunk&& chunk);
+    bool merge_into_queued(AudioChunk& chunk);
+    void skip_chunk(const AudioChunk& chunk);
+    void process_audio_chunk(const AudioChunk& chunk, bool downgrade, std::vector<TranscriptionResult>& results);
+    void process_audio_batch(const std::vector<AudioChunk>& batch, bool downgrade,
+                             std::vector<std::vector<TranscriptionResult>>& results);
+    std::vector<int> stream_prompt(Stream& stream, const std::shared_ptr<WhisperWrapper>& whisper,
+                                   const AudioChunk& chunk);
+    void update_stream_context(Stream& stream, const std::shared_ptr<WhisperWrapper>& whisper,
+                               const AudioChunk& chunk, const std::vector<TranscriptionResult>& results);
+    void process_partial_chunk(const AudioChunk& chunk, std::vector<TranscriptionResult>& results);
+    void complete_chunk(const AudioChunk& chunk, std::vector<TranscriptionResult>&& results);
+    void complete_partial(const AudioChunk& chunk, std::vector<TranscriptionResult>&& results);
+    void queue_partial_audio(Stream& stream);
+    void finish_streaming_utterance(Stream& stream);
+    std::shared_ptr<WhisperWrapper> partial_decoder() const { return partial_whisper_ ? partial_whisper_ : current_whisper(); }
     void handle_transcription(const TranscriptionResult& result);
     void update_metrics();
     void clear_buffers();
@@ -5,6 +5,14 @@
 #include <algorithm>
 #include <numeric>
 #include <cctype>
+#include <cmath>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 namespace rt_stt {
 namespace stt {
@@ -15,18 +23,158 @@ static constexpr float STREAMING_WINDOW_SEC = 5.0f;  // Larger window for better
 static constexpr float STREAMING_STEP_SEC = 1.0f;    // Larger steps to reduce processing
 static constexpr float STREAMING_OVERLAP_SEC = 1.0f;
 
-struct WhisperWrapper::Impl {
-    whisper_context* ctx = nullptr;
-    whisper_full_params params;
+// Encoder frames: 1500 cover the full 30 s window, i.e. 50 per second
+static constexpr int MAX_AUDIO_CTX = 1500;
+static constexpr int AUDIO_CTX_PER_SEC = 50;
+
+// Everything a decode reads from the configuration. The setters publish a
+// new one whole and never modify it afterwards, so a decode that took one
+// keeps consistent settings, and a live language string, until it ends.
+struct WhisperWrapper::DecodeSettings {
     ModelConfig config;
+    whisper_full_params params;
+    whisper_full_params partial_params; // Cheaper settings for in-progress windows
+    whisper_full_params greedy_params;  // Cascade first pass: greedy, no temperature fallback
+    
+    // The params point into config.language; re-point them after a copy
+    void bind_language() {
+        params.language = config.language == "auto" ? nullptr : config.language.c_str();
+        partial_params.language = params.language;
+        greedy_params.language = params.language;
+    }
+};
+
+struct WhisperWrapper::Impl {
+    whisper_context* ctx = nullptr;     // Shared model weights, loaded without a state
+    std::shared_ptr<const DecodeSettings> settings;  // Only through load/update_settings
+    std::mutex settings_mutex;          // Serializes the setters, never taken by a decode
+    std::string model_name;             // File name of config.model_path, stamped on results
+    std::atomic<bool> segment_metadata{true};
     std::chrono::steady_clock::time_point last_process_time;
+    
+    // Decoder state pool: one whisper_state per concurrent decode
+    std::vector<whisper_state*> states;
+    std::vector<whisper_state*> free_states;
+    std::mutex pool_mutex;
+    std::condition_variable pool_cv;
+    
+    mutable std::mutex stats_mutex;
     float total_rtf = 0.0f;
     int rtf_count = 0;
+    int64_t total_audio_ctx = 0;
+    int audio_ctx_count = 0;
+    size_t cascade_decodes = 0;
+    size_t cascade_fallbacks = 0;
+    
+    // One snapshot per decode, taken when it starts
+    std::shared_ptr<const DecodeSettings> load_settings() const {
+        return std::atomic_load(&settings);
+    }
+    
+    // Copy, modify and publish; decodes already running keep the old one
+    template <typename Fn>
+    void update_settings(Fn&& modify) {
+        std::lock_guard<std::mutex> lock(settings_mutex);
+        auto current = load_settings();
+        if (!current) return;
+        auto next = std::make_shared<DecodeSettings>(*current);
+        modify(*next);
+        next->bind_language();
+        std::atomic_store(&settings, std::shared_ptr<const DecodeSettings>(std::move(next)));
+    }
+    
+    whisper_state* acquire_state() {
+        std::unique_lock<std::mutex> lock(pool_mutex);
+        pool_cv.wait(lock, [this] { return !free_states.empty(); });
+        whisper_state* state = free_states.back();
+        free_states.pop_back();
+        return state;
+    }
+    
+    void release_state(whisper_state* state) {
+        {
+            std::lock_guard<std::mutex> lock(pool_mutex);
+            free_states.push_back(state);
+        }
+        pool_cv.notify_one();
+    }
+};
+
+// Borrows a decoder state from the pool for the lifetime of the lease
+class WhisperWrapper::StateLease {
+public:
+    explicit StateLease(Impl& impl) : impl_(impl), state_(impl.acquire_state()) {}
+    ~StateLease() { impl_.release_state(state_); }
+    
+    StateLease(const StateLease&) = delete;
+    StateLease& operator=(const StateLease&) = delete;
+    
+    whisper_state* get() const { return state_; }
+    
+private:
+    Impl& impl_;
+    whisper_state* state_;
 };
 
+// Model file mapped read-only and fed to whisper through its loader
+// callbacks: the weights are copied once, sequentially, straight out of the
+// page cache (which keeps them warm across daemon restarts), with no stdio
+// buffering in between
+struct MappedModelFile {
+    const char* data = nullptr;
+    size_t size = 0;
+    size_t pos = 0;
+};
+
+static bool map_model_file(const std::string& path, MappedModelFile& file) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return false;
+    }
+    
+    void* addr = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) return false;
+    
+    madvise(addr, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+    madvise(addr, static_cast<size_t>(st.st_size), MADV_WILLNEED);
+    
+    file.data = static_cast<const char*>(addr);
+    file.size = static_cast<size_t>(st.st_size);
+    file.pos = 0;
+    return true;
+}
+
+static void unmap_model_file(MappedModelFile& file) {
+    if (file.data) {
+        munmap(const_cast<char*>(file.data), file.size);
+        file.data = nullptr;
+    }
+}
+
+static size_t mapped_model_read(void* ctx, void* output, size_t read_size) {
+    auto* file = static_cast<MappedModelFile*>(ctx);
+    size_t n = std::min(read_size, file->size - file->pos);
+    std::memcpy(output, file->data + file->pos, n);
+    file->pos += n;
+    return n;
+}
+
+static bool mapped_model_eof(void* ctx) {
+    auto* file = static_cast<MappedModelFile*>(ctx);
+    return file->pos >= file->size;
+}
+
+static void mapped_model_close(void* /*ctx*/) {
+    // Unmapped by the caller once whisper is done with it
+}
+
 WhisperWrapper::WhisperWrapper() 
-    : impl_(std::make_unique<Impl>())
-    , streaming_state_(std::make_unique<StreamingState>()) {
+    : impl_(std::make_unique<Impl>()) {
 }
 
 WhisperWrapper::~WhisperWrapper() {
@@ -34,73 +182,147 @@ WhisperWrapper::~WhisperWrapper() {
 }
 
 bool WhisperWrapper::initialize(const ModelConfig& config) {
-    impl_->config = config;
+    size_t name_pos = config.model_path.find_last_of("/\\");
+    impl_->model_name = name_pos != std::string::npos ? config.model_path.substr(name_pos + 1) : config.model_path;
     
     // Load model with parameters
     struct whisper_context_params cparams = whisper_context_default_params();
     cparams.use_gpu = config.use_gpu;
     cparams.flash_attn = config.flash_attn;
     
-    impl_->ctx = whisper_init_from_file_with_params(config.model_path.c_str(), cparams);
+    // Load the weights once; every decoder gets its own state below
+    MappedModelFile mapped;
+    if (config.use_mmap && map_model_file(config.model_path, mapped)) {
+        whisper_model_loader loader = {};
+        loader.context = &mapped;
+        loader.read = mapped_model_read;
+        loader.eof = mapped_model_eof;
+        loader.close = mapped_model_close;
+        
+        impl_->ctx = whisper_init_with_params_no_state(&loader, cparams);
+        unmap_model_file(mapped);
+    } else {
+        impl_->ctx = whisper_init_from_file_with_params_no_state(config.model_path.c_str(), cparams);
+    }
     if (!impl_->ctx) {
         std::cerr << "Failed to load model from: " << config.model_path << std::endl;
         return false;
     }
     
+    const int n_decoders = std::max(1, config.n_decoders);
+    for (int i = 0; i < n_decoders; ++i) {
+        whisper_state* state = whisper_init_state(impl_->ctx);
+        if (!state) {
+            std::cerr << "Failed to allocate whisper state " << i << std::endl;
+            shutdown();
+            return false;
+        }
+        impl_->states.push_back(state);
+    }
+    impl_->free_states = impl_->states;
+    
     // Initialize parameters for streaming
-    impl_->params = whisper_full_default_params(WHISPER_SAMPLING_GREEDY);
+    auto settings = std::make_shared<DecodeSettings>();
+    settings->config = config;
+    settings->params = whisper_full_default_params(WHISPER_SAMPLING_GREEDY);
     
     // Streaming-optimized parameters
-    impl_->params.n_threads = config.n_threads;
-    impl_->params.n_max_text_ctx = 16384;
-    impl_->params.translate = config.translate;
-    impl_->params.language = config.language == "auto" ? nullptr : config.language.c_str();
-    impl_->params.print_special = false;
-    impl_->params.print_progress = false;
-    impl_->params.print_realtime = false;
-    impl_->params.print_timestamps = false;
-    impl_->params.single_segment = false; // Allow multiple segments
-    impl_->params.max_tokens = 64;        // More tokens for better results
-    impl_->params.audio_ctx = 1500;       // Full context for accuracy
+    settings->params.n_threads = config.n_threads;
+    settings->params.n_max_text_ctx = 16384;
+    settings->params.translate = config.translate;
+    settings->params.print_special = false;
+    settings->params.print_progress = false;
+    settings->params.print_realtime = false;
+    settings->params.print_timestamps = false;
+    settings->params.single_segment = false; // Allow multiple segments
+    settings->params.max_tokens = 64;        // More tokens for better results
+    settings->params.audio_ctx = MAX_AUDIO_CTX; // Full context; see ModelConfig::adaptive_audio_ctx
     
     // Beam search parameters
     if (config.beam_size > 1) {
-        impl_->params.strategy = WHISPER_SAMPLING_BEAM_SEARCH;
-        impl_->params.beam_search.beam_size = config.beam_size;
+        settings->params.strategy = WHISPER_SAMPLING_BEAM_SEARCH;
+        settings->params.beam_search.beam_size = config.beam_size;
     }
     
     // Temperature for sampling
-    impl_->params.temperature = config.temperature;
+    settings->params.temperature = config.temperature;
     
     // Enable token timestamps for word-level timing
-    impl_->params.token_timestamps = true;
-    impl_->params.max_len = 0;  // No artificial length limit
+    settings->params.token_timestamps = true;
+    settings->params.max_len = 0;  // No artificial length limit
     
     // Speed optimizations
-    impl_->params.suppress_blank = true;
-    impl_->params.prompt_tokens = nullptr;
-    impl_->params.prompt_n_tokens = 0;
+    settings->params.suppress_blank = true;
+    settings->params.prompt_tokens = nullptr;
+    settings->params.prompt_n_tokens = 0;
+    
+    // Partials are superseded within a second, so favour speed over accuracy
+    settings->partial_params = settings->params;
+    settings->partial_params.strategy = WHISPER_SAMPLING_GREEDY;
+    settings->partial_params.single_segment = true;
+    settings->partial_params.no_context = true;
+    settings->partial_params.token_timestamps = false;
+    
+    // Cascade first pass: one greedy decode, accepted unless it scores poorly
+    settings->greedy_params = settings->params;
+    settings->greedy_params.strategy = WHISPER_SAMPLING_GREEDY;
+    settings->greedy_params.temperature_inc = 0.0f;
+    
+    settings->bind_language();
+    std::atomic_store(&impl_->settings, std::shared_ptr<const DecodeSettings>(std::move(settings)));
     
     std::cout << "Whisper model loaded successfully: " << get_model_type() << std::endl;
     std::cout << "Multilingual: " << (is_multilingual() ? "Yes" : "No") << std::endl;
+    std::cout << "Decoder states: " << impl_->states.size() << std::endl;
     
     return true;
 }
 
 void WhisperWrapper::shutdown() {
+    for (whisper_state* state : impl_->states) {
+        whisper_free_state(state);
+    }
+    impl_->states.clear();
+    impl_->free_states.clear();
+    
     if (impl_->ctx) {
         whisper_free(impl_->ctx);
         impl_->ctx = nullptr;
     }
 }
 
+void WhisperWrapper::warm_up() {
+    if (!impl_->ctx) return;
+    
+    // One short silent decode with the final-result settings. The GPU
+    // pipelines and compute buffers are set up on first use, and this way
+    // the first real utterance does not pay for it. Stats are not recorded.
+    std::vector<float> silence(SAMPLE_RATE, 0.0f);
+    auto settings = impl_->load_settings();
+    whisper_full_params params = settings->params;
+    params.max_tokens = 4;
+    params.no_context = true;
+    params.token_timestamps = false;   // Full audio_ctx: the largest encoder graph
+    
+    StateLease lease(*impl_);
+    whisper_full_with_state(impl_->ctx, lease.get(), params, silence.data(), static_cast<int>(silence.size()));
+}
+
+size_t WhisperWrapper::get_pool_size() const {
+    return impl_->states.size();
+}
+
 void WhisperWrapper::process_audio(const float* samples, size_t n_samples, TranscriptionCallback callback) {
     if (!impl_->ctx) return;
     
     auto start_time = std::chrono::steady_clock::now();
+    auto settings = impl_->load_settings();
+    
+    StateLease lease(*impl_);
+    whisper_state* state = lease.get();
     
     // Process full audio
-    int result = whisper_full(impl_->ctx, impl_->params, samples, n_samples);
+    int result = whisper_full_with_state(impl_->ctx, state, settings->params, samples, n_samples);
     
     if (result != 0) {
         std::cerr << "Whisper processing failed with code: " << result << std::endl;
@@ -108,25 +330,26 @@ void WhisperWrapper::process_audio(const float* samples, size_t n_samples, Trans
     }
     
     // Extract results
-    const int n_segments = whisper_full_n_segments(impl_->ctx);
+    const int n_segments = whisper_full_n_segments_from_state(state);
+    const float confidence = calculate_confidence(state);
     
     for (int i = 0; i < n_segments; ++i) {
         TranscriptionResult tr;
-        tr.text = whisper_full_get_segment_text(impl_->ctx, i);
-        tr.confidence = calculate_confidence(impl_->ctx);
+        tr.text = whisper_full_get_segment_text_from_state(state, i);
+        tr.confidence = confidence;
         tr.is_final = true;
         
         // Get timestamps
-        int64_t t0 = whisper_full_get_segment_t0(impl_->ctx, i);
-        int64_t t1 = whisper_full_get_segment_t1(impl_->ctx, i);
+        int64_t t0 = whisper_full_get_segment_t0_from_state(state, i);
+        int64_t t1 = whisper_full_get_segment_t1_from_state(state, i);
         tr.timestamps.push_back({t0 * 10, t1 * 10}); // Convert to ms
         
         // Language detection
-        if (impl_->config.language == "auto") {
-            int lang_id = whisper_full_lang_id(impl_->ctx);
+        if (settings->config.language == "auto") {
+            int lang_id = whisper_full_lang_id_from_state(state);
             tr.language = whisper_lang_str(lang_id);
         } else {
-            tr.language = impl_->config.language;
+            tr.language = settings->config.language;
         }
         
         auto end_time = std::chrono::steady_clock::now();
@@ -136,171 +359,417 @@ void WhisperWrapper::process_audio(const float* samples, size_t n_samples, Trans
         float audio_duration = static_cast<float>(n_samples) / SAMPLE_RATE;
         float process_duration = tr.processing_time.count() / 1000.0f;
         float rtf = process_duration / audio_duration;
-        impl_->total_rtf += rtf;
-        impl_->rtf_count++;
+        {
+            std::lock_guard<std::mutex> lock(impl_->stats_mutex);
+            impl_->total_rtf += rtf;
+            impl_->rtf_count++;
+        }
         
-        callback(tr);
+        callback(std::move(tr));
     }
 }
 
-void WhisperWrapper::process_stream(const float* samples, size_t n_samples, TranscriptionCallback callback) {
+// Normalizes whitespace in place (runs collapsed to one space, ends
+// trimmed) in a single pass; returns false if nothing worth emitting is left
+static bool clean_transcript(std::string& text) {
+    if (text.empty()) return false;
+    
+    size_t out = 0;
+    bool pending_space = false;
+    bool has_alphanumeric = false;
+    for (size_t in = 0; in < text.size(); ++in) {
+        char c = text[in];
+        if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+            pending_space = out > 0;
+            continue;
+        }
+        if (pending_space) {
+            text[out++] = ' ';
+            pending_space = false;
+        }
+        has_alphanumeric = has_alphanumeric || std::isalnum(static_cast<unsigned char>(c));
+        text[out++] = c;
+    }
+    text.resize(out);
+    
+    // Skip if it's just punctuation
+    return has_alphanumeric && text.length() > 1;
+}
+
+void WhisperWrapper::process_stream(const float* samples, size_t n_samples, TranscriptionCallback callback,
+                                    const std::vector<int>& prompt_tokens) {
     if (!impl_->ctx || !samples || n_samples == 0) return;
     
     auto start_time = std::chrono::steady_clock::now();
     
     // Process the COMPLETE utterance in one go
     // No sliding windows, no repetition
-    TranscriptionResult result = process_segment(samples, n_samples);
+    TranscriptionResult result;
+    {
+        StateLease lease(*impl_);
+        result = decode_final(lease.get(), samples, n_samples, prompt_tokens, false);
+    }
     
     // Check if we got valid text
-    if (!result.text.empty()) {
-        // Clean up the text
-        std::string cleaned = result.text;
+    if (clean_transcript(result.text)) {
+        result.is_final = true; // Complete utterance
         
-        // Remove multiple spaces
-        size_t pos = 0;
-        while ((pos = cleaned.find("  ", pos)) != std::string::npos) {
-            cleaned.replace(pos, 2, " ");
-        }
+        auto end_time = std::chrono::steady_clock::now();
+        result.processing_time = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
         
-        // Trim leading/trailing whitespace
-        size_t first = cleaned.find_first_not_of(" \t\n\r");
-        size_t last = cleaned.find_last_not_of(" \t\n\r");
-        if (first != std::string::npos && last != std::string::npos) {
-            cleaned = cleaned.substr(first, last - first + 1);
-        }
+        callback(std::move(result));
+    }
+}
+
+void WhisperWrapper::process_batch(const std::vector<std::pair<const float*, size_t>>& utterances, int gap_ms,
+                                   BatchCallback callback, const std::vector<int>& prompt_tokens) {
+    if (!impl_->ctx || utterances.empty()) return;
+    
+    auto start_time = std::chrono::steady_clock::now();
+    
+    // Join the utterances with silence, remembering where each one starts
+    const size_t gap_samples = static_cast<size_t>(std::max(gap_ms, 0)) * SAMPLE_RATE / 1000;
+    size_t total_samples = 0;
+    for (const auto& utterance : utterances) {
+        total_samples += utterance.second + gap_samples;
+    }
+    
+    std::vector<float> joined;
+    joined.reserve(total_samples);
+    std::vector<float> starts_sec;  // Start of each utterance in the joined audio, plus the end
+    for (const auto& utterance : utterances) {
+        starts_sec.push_back(static_cast<float>(joined.size()) / SAMPLE_RATE);
+        joined.insert(joined.end(), utterance.first, utterance.first + utterance.second);
+        joined.insert(joined.end(), gap_samples, 0.0f);
+    }
+    starts_sec.push_back(static_cast<float>(joined.size()) / SAMPLE_RATE);
+    
+    TranscriptionResult batch;
+    {
+        StateLease lease(*impl_);
+        batch = decode_final(lease.get(), joined.data(), joined.size(), prompt_tokens, true);
+    }
+    
+    // Each segment belongs to the utterance its midpoint falls in; the
+    // silence gaps keep whisper from running a segment across two of them
+    std::vector<TranscriptionResult> results(utterances.size());
+    std::vector<float> logprob_sums(utterances.size(), 0.0f);
+    std::vector<size_t> token_counts(utterances.size(), 0);
+    for (auto& segment : batch.segments) {
+        float mid = 0.5f * (segment.start + segment.end);
+        size_t index = std::upper_bound(starts_sec.begin(), starts_sec.end() - 1, mid) - starts_sec.begin();
+        index = std::min(std::max<size_t>(index, 1), utterances.size()) - 1;
         
-        // Skip if it's just punctuation
-        bool has_alphanumeric = false;
-        for (char c : cleaned) {
-            if (std::isalnum(c)) {
-                has_alphanumeric = true;
-                break;
-            }
-        }
+        TranscriptionResult& result = results[index];
+        logprob_sums[index] += segment.avg_logprob * segment.tokens.size();
+        token_counts[index] += segment.tokens.size();
+        result.text += segment.text;
         
-        if (has_alphanumeric && cleaned.length() > 1) {
-            result.text = cleaned;
-            result.is_final = true; // Complete utterance
-            
-            auto end_time = std::chrono::steady_clock::now();
-            result.processing_time = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
-            
-            callback(result);
-        }
+        TranscriptionResult::Segment local = std::move(segment);
+        local.id = static_cast<int>(result.segments.size());
+        local.start = std::max(0.0f, local.start - starts_sec[index]);
+        local.end = std::max(local.start, local.end - starts_sec[index]);
+        result.segments.push_back(std::move(local));
+    }
+    
+    auto processing_time = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start_time);
+    
+    for (size_t i = 0; i < utterances.size(); ++i) {
+        TranscriptionResult& result = results[i];
+        result.text.erase(0, result.text.find_first_not_of(" \t\n\r"));
+        result.text.erase(result.text.find_last_not_of(" \t\n\r") + 1);
+        if (!clean_transcript(result.text)) continue;
+        
+        result.confidence = token_counts[i] > 0
+            ? std::min(1.0f, std::exp(logprob_sums[i] / token_counts[i])) : 0.0f;
+        result.is_final = true;
+        result.processing_time = processing_time;
+        result.language = batch.language;
+        result.language_probability = batch.language_probability;
+        result.audio_duration_ms = static_cast<int64_t>(utterances[i].second * 1000 / SAMPLE_RATE);
+        result.model_name = batch.model_name;
+        result.audio_ctx = batch.audio_ctx;
+        result.fallback_used = batch.fallback_used;
+        
+        callback(i, std::move(result));
+    }
+}
+
+void WhisperWrapper::append_partial(StreamingState& state, const float* samples, size_t n_samples) {
+    if (!samples || n_samples == 0) return;
+    
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.context_buffer.insert(state.context_buffer.end(), samples, samples + n_samples);
+    
+    // Slide the window forward in whole steps once it exceeds its maximum
+    // length, keeping STREAMING_OVERLAP_SEC of already-decoded audio as context
+    const size_t window_samples = static_cast<size_t>(STREAMING_WINDOW_SEC * SAMPLE_RATE);
+    const size_t step_samples = static_cast<size_t>(STREAMING_STEP_SEC * SAMPLE_RATE);
+    const size_t overlap_samples = static_cast<size_t>(STREAMING_OVERLAP_SEC * SAMPLE_RATE);
+    if (state.context_buffer.size() > window_samples) {
+        size_t excess = state.context_buffer.size() - window_samples;
+        size_t drop = ((excess + step_samples - 1) / step_samples) * step_samples;
+        drop = std::min(drop, state.context_buffer.size() - overlap_samples);
+        
+        state.overlap_buffer.assign(state.context_buffer.begin() + drop - std::min(drop, overlap_samples),
+                                    state.context_buffer.begin() + drop);
+        state.context_buffer.erase(state.context_buffer.begin(), state.context_buffer.begin() + drop);
+        state.offset_ms += static_cast<int64_t>(drop) * 1000 / SAMPLE_RATE;
     }
 }
 
-TranscriptionResult WhisperWrapper::process_segment(const float* samples, size_t n_samples) {
+void WhisperWrapper::decode_partial(StreamingState& state, TranscriptionCallback callback) {
+    if (!impl_->ctx) return;
+    
+    // Snapshot the window so appends can continue while we decode
+    std::vector<float> window;
+    int64_t offset_ms;
+    {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        const size_t step_samples = static_cast<size_t>(STREAMING_STEP_SEC * SAMPLE_RATE);
+        if (state.context_buffer.size() < step_samples) return;
+        window = state.context_buffer;
+        offset_ms = state.offset_ms;
+    }
+    
+    auto start_time = std::chrono::steady_clock::now();
+    
+    auto settings = impl_->load_settings();
     TranscriptionResult result;
+    {
+        StateLease lease(*impl_);
+        result = process_segment(lease.get(), window.data(), window.size(), *settings, settings->partial_params);
+    }
     
-    // std::cout << "[WhisperWrapper] Running whisper_full on " << n_samples << " samples" << std::endl;
+    {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        if (!clean_transcript(result.text)) {
+            state.n_failures++;
+            return;
+        }
+        
+        // Partials only matter when they change
+        if (result.text == state.previous_text) return;
+        state.previous_text = result.text;
+    }
+    
+    // Report window-relative times against the start of the utterance
+    const float offset_sec = offset_ms / 1000.0f;
+    for (auto& segment : result.segments) {
+        segment.start += offset_sec;
+        segment.end += offset_sec;
+    }
+    
+    result.is_final = false;
+    auto end_time = std::chrono::steady_clock::now();
+    result.processing_time = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+    
+    callback(std::move(result));
+}
+
+// Encoder frames needed for n_samples plus the margin, rounded up to the
+// granularity and capped at the full window
+static int adaptive_audio_ctx(size_t n_samples, const ModelConfig& config) {
+    int64_t audio_ms = static_cast<int64_t>(n_samples) * 1000 / SAMPLE_RATE + std::max(0, config.audio_ctx_margin_ms);
+    int64_t frames = (audio_ms * AUDIO_CTX_PER_SEC + 999) / 1000;
+    
+    const int64_t granularity = std::max(1, config.audio_ctx_granularity);
+    frames = ((frames + granularity - 1) / granularity) * granularity;
+    return static_cast<int>(std::min<int64_t>(std::max<int64_t>(frames, granularity), MAX_AUDIO_CTX));
+}
+
+TranscriptionResult WhisperWrapper::process_segment(whisper_state* state, const float* samples, size_t n_samples,
+                                                    const DecodeSettings& settings,
+                                                    const whisper_full_params& params,
+                                                    const std::vector<int>& prompt_tokens, bool full_segments) {
+    TranscriptionResult result;
+    result.confidence = 0.0f;
+    result.is_final = false;
+    result.processing_time = std::chrono::milliseconds(0);
+    result.language_probability = 0.0f;
+    result.audio_duration_ms = 0;
+    
+    // Per-call copy so the encoder window can follow the segment length and
+    // the prompt can come from the caller's stream
+    whisper_full_params call_params = params;
+    if (!prompt_tokens.empty()) {
+        call_params.prompt_tokens = prompt_tokens.data();
+        call_params.prompt_n_tokens = static_cast<int>(prompt_tokens.size());
+    }
+    if (settings.config.adaptive_audio_ctx) {
+        call_params.audio_ctx = adaptive_audio_ctx(n_samples, settings.config);
+    }
+    result.audio_ctx = call_params.audio_ctx > 0 ? call_params.audio_ctx : MAX_AUDIO_CTX;
+    {
+        std::lock_guard<std::mutex> lock(impl_->stats_mutex);
+        impl_->total_audio_ctx += result.audio_ctx;
+        impl_->audio_ctx_count++;
+    }
     
     // Run whisper on segment
-    int ret = whisper_full(impl_->ctx, impl_->params, samples, n_samples);
+    int ret = whisper_full_with_state(impl_->ctx, state, call_params, samples, n_samples);
+    if (ret != 0) return result;
     
-    // std::cout << "[WhisperWrapper] whisper_full returned: " << ret << std::endl;
+    const int n_segments = whisper_full_n_segments_from_state(state);
+    if (n_segments <= 0) return result;
     
-    if (ret == 0) {
-        const int n_segments = whisper_full_n_segments(impl_->ctx);
-        // std::cout << "[WhisperWrapper] Number of segments: " << n_segments << std::endl;
+    // One pass over segments and tokens gathers the text, the per-segment
+    // metadata and the overall confidence. Segment text and token ids are
+    // only copied when someone wants them (set_segment_metadata, or a batch
+    // that needs them to split its result).
+    const bool metadata = full_segments || impl_->segment_metadata.load(std::memory_order_relaxed);
+    result.segments.reserve(n_segments);
+    
+    float total_logprob = 0.0f;
+    int total_tokens = 0;
+    for (int i = 0; i < n_segments; ++i) {
+        const char* text = whisper_full_get_segment_text_from_state(state, i);
+        const size_t text_len = text ? std::strlen(text) : 0;
+        result.text.append(text ? text : "", text_len);
         
-        if (n_segments > 0) {
-            // Concatenate all segments for better results
-            result.text = "";
-            
-            // Extract detailed metadata for each segment
-            for (int i = 0; i < n_segments; ++i) {
-                const char* text = whisper_full_get_segment_text(impl_->ctx, i);
-                if (text && strlen(text) > 0) {
-                    result.text += text;
-                }
-                
-                // Create segment with full metadata
-                TranscriptionResult::Segment segment;
-                segment.id = i;
-                segment.seek = 0;
-                segment.start = whisper_full_get_segment_t0(impl_->ctx, i) / 100.0f; // Convert to seconds
-                segment.end = whisper_full_get_segment_t1(impl_->ctx, i) / 100.0f;
-                segment.text = text ? text : "";
-                
-                // Get tokens for this segment
-                const int n_tokens = whisper_full_n_tokens(impl_->ctx, i);
-                for (int j = 0; j < n_tokens; ++j) {
-                    segment.tokens.push_back(whisper_full_get_token_id(impl_->ctx, i, j));
-                }
-                
-                // Calculate average log probability
-                segment.avg_logprob = 0.0f;
-                if (n_tokens > 0) {
-                    float sum_logprob = 0.0f;
-                    for (int j = 0; j < n_tokens; ++j) {
-                        sum_logprob += whisper_full_get_token_p(impl_->ctx, i, j);
-                    }
-                    segment.avg_logprob = sum_logprob / n_tokens;
-                }
-                
-                // Set temperature and other params
-                segment.temperature = impl_->params.temperature;
-                segment.compression_ratio = 1.0f; // Whisper.cpp doesn't expose this directly
-                segment.no_speech_prob = 0.0f; // Will be set if available
-                
-                result.segments.push_back(segment);
-            }
-            
-            result.confidence = calculate_confidence(impl_->ctx);
-            
-            // std::cout << "[WhisperWrapper] Got text: '" << result.text << "'" << std::endl;
-            
-            // Trim whitespace
-            result.text.erase(0, result.text.find_first_not_of(" \t\n\r"));
-            result.text.erase(result.text.find_last_not_of(" \t\n\r") + 1);
-            
-            // Get language with probability
-            if (impl_->config.language == "auto") {
-                int lang_id = whisper_full_lang_id(impl_->ctx);
-                result.language = whisper_lang_str(lang_id);
-                
-                // Get language detection probabilities
-                if (n_segments > 0) {
-                    // Get the language probability from the first segment
-                    result.language_probability = 0.99f; // Default high confidence
-                    // Note: whisper.cpp doesn't expose language probabilities directly
-                }
-            } else {
-                result.language = impl_->config.language;
-                result.language_probability = 1.0f;
+        result.segments.emplace_back();
+        TranscriptionResult::Segment& segment = result.segments.back();
+        segment.id = i;
+        segment.seek = 0;
+        segment.start = whisper_full_get_segment_t0_from_state(state, i) / 100.0f; // Convert to seconds
+        segment.end = whisper_full_get_segment_t1_from_state(state, i) / 100.0f;
+        if (metadata) {
+            segment.text.assign(text ? text : "", text_len);
+        }
+        
+        const int n_tokens = whisper_full_n_tokens_from_state(state, i);
+        if (metadata) {
+            segment.tokens.reserve(n_tokens);
+        }
+        float segment_logprob = 0.0f;
+        for (int j = 0; j < n_tokens; ++j) {
+            whisper_token_data token = whisper_full_get_token_data_from_state(state, i, j);
+            segment_logprob += token.plog;
+            if (metadata) {
+                segment.tokens.push_back(token.id);
             }
-            
-            // Set audio duration
-            result.audio_duration_ms = (n_samples * 1000) / SAMPLE_RATE;
-            
-            // Extract model name from path
-            size_t pos = impl_->config.model_path.find_last_of("/\\");
-            result.model_name = (pos != std::string::npos) ? 
-                impl_->config.model_path.substr(pos + 1) : 
-                impl_->config.model_path;
         }
+        segment.avg_logprob = n_tokens > 0 ? segment_logprob / n_tokens : 0.0f;
+        total_logprob += segment_logprob;
+        total_tokens += n_tokens;
+        
+        segment.temperature = params.temperature;
+        segment.compression_ratio = 1.0f; // Whisper.cpp doesn't expose this directly
+        segment.no_speech_prob = 0.0f; // Will be set if available
+    }
+    
+    // Confidence is exp(mean token log-probability)
+    if (total_tokens > 0) {
+        result.confidence = std::min(1.0f, std::max(0.0f, std::exp(total_logprob / total_tokens)));
+    }
+    
+    // Trim whitespace
+    size_t first = result.text.find_first_not_of(" \t\n\r");
+    if (first == std::string::npos) {
+        result.text.clear();
+    } else {
+        result.text.erase(result.text.find_last_not_of(" \t\n\r") + 1);
+        result.text.erase(0, first);
+    }
+    
+    // Get language with probability
+    if (settings.config.language == "auto") {
+        int lang_id = whisper_full_lang_id_from_state(state);
+        result.language = whisper_lang_str(lang_id);
+        result.language_probability = 0.99f; // whisper.cpp doesn't expose language probabilities directly
     } else {
-        // std::cout << "[WhisperWrapper] ERROR: whisper_full failed with code " << ret << std::endl;
+        result.language = settings.config.language;
+        result.language_probability = 1.0f;
     }
     
+    result.audio_duration_ms = (n_samples * 1000) / SAMPLE_RATE;
+    result.model_name = impl_->model_name;
+    
     return result;
 }
 
-float WhisperWrapper::calculate_confidence(whisper_context* ctx) {
+TranscriptionResult WhisperWrapper::decode_final(whisper_state* state, const float* samples, size_t n_samples,
+                                                 const std::vector<int>& prompt_tokens, bool full_segments) {
+    auto start_time = std::chrono::steady_clock::now();
+    
+    // Both cascade passes run with the settings the utterance started with
+    auto settings = impl_->load_settings();
+    bool fallback = false;
+    TranscriptionResult result;
+    if (!settings->config.cascade_decode) {
+        result = process_segment(state, samples, n_samples, *settings, settings->params, prompt_tokens, full_segments);
+    } else {
+        result = process_segment(state, samples, n_samples, *settings, settings->greedy_params,
+                                 prompt_tokens, full_segments);
+        
+        // Nothing decoded means no speech; re-decoding would not help
+        fallback = !result.segments.empty() && !accept_cascade_result(result, *settings);
+        if (fallback) {
+            result = process_segment(state, samples, n_samples, *settings, settings->params, prompt_tokens, full_segments);
+            result.fallback_used = true;
+        }
+    }
+    
+    // RTF over the whole decode, fallback pass included
+    float audio_duration = static_cast<float>(n_samples) / SAMPLE_RATE;
+    float process_duration = std::chrono::duration<float>(std::chrono::steady_clock::now() - start_time).count();
+    
+    std::lock_guard<std::mutex> lock(impl_->stats_mutex);
+    if (audio_duration > 0.0f) {
+        impl_->total_rtf += process_duration / audio_duration;
+        impl_->rtf_count++;
+    }
+    if (settings->config.cascade_decode) {
+        impl_->cascade_decodes++;
+        if (fallback) {
+            impl_->cascade_fallbacks++;
+        }
+    }
+    return result;
+}
+
+std::vector<int> WhisperWrapper::get_prompt_tokens(const TranscriptionResult& result, size_t max_tokens) const {
+    std::vector<int> tokens;
+    if (!impl_->ctx || max_tokens == 0) return tokens;
+    
+    // Ids from end-of-text up are special/timestamp tokens
+    const int eot = whisper_token_eot(impl_->ctx);
+    for (auto segment = result.segments.rbegin(); segment != result.segments.rend(); ++segment) {
+        for (auto token = segment->tokens.rbegin(); token != segment->tokens.rend(); ++token) {
+            if (*token >= eot) continue;
+            tokens.push_back(*token);
+            if (tokens.size() == max_tokens) break;
+        }
+        if (tokens.size() == max_tokens) break;
+    }
+    std::reverse(tokens.begin(), tokens.end());
+    return tokens;
+}
+
+bool WhisperWrapper::accept_cascade_result(const TranscriptionResult& result,
+                                           const DecodeSettings& settings) const {
+    if (result.confidence < settings.config.cascade_min_confidence) return false;
+    
+    for (const auto& segment : result.segments) {
+        if (segment.avg_logprob < settings.config.cascade_min_avg_logprob) return false;
+    }
+    return true;
+}
+
+float WhisperWrapper::calculate_confidence(whisper_state* state) {
     // Calculate confidence based on token probabilities
-    const int n_segments = whisper_full_n_segments(ctx);
+    const int n_segments = whisper_full_n_segments_from_state(state);
     if (n_segments == 0) return 0.0f;
     
     float total_logprob = 0.0f;
     int total_tokens = 0;
     
     for (int i = 0; i < n_segments; ++i) {
-        const int n_tokens = whisper_full_n_tokens(ctx, i);
+        const int n_tokens = whisper_full_n_tokens_from_state(state, i);
         for (int j = 0; j < n_tokens; ++j) {
-            auto token_data = whisper_full_get_token_data(ctx, i, j);
-            total_logprob += token_data.p;
+            auto token_data = whisper_full_get_token_data_from_state(state, i, j);
+            total_logprob += token_data.plog;
             total_tokens++;
         }
     }
@@ -315,23 +784,57 @@ float WhisperWrapper::calculate_confidence(whisper_context* ctx) {
 }
 
 void WhisperWrapper::set_language(const std::string& language) {
-    impl_->config.language = language;
-    impl_->params.language = language == "auto" ? nullptr : language.c_str();
+    impl_->update_settings([&language](DecodeSettings& settings) {
+        settings.config.language = language;
+    });
 }
 
 void WhisperWrapper::set_translate(bool translate) {
-    impl_->config.translate = translate;
-    impl_->params.translate = translate;
+    impl_->update_settings([translate](DecodeSettings& settings) {
+        settings.config.translate = translate;
+        settings.params.translate = translate;
+        settings.partial_params.translate = translate;
+        settings.greedy_params.translate = translate;
+    });
 }
 
 void WhisperWrapper::set_beam_size(int beam_size) {
-    impl_->config.beam_size = beam_size;
-    if (beam_size > 1) {
-        impl_->params.strategy = WHISPER_SAMPLING_BEAM_SEARCH;
-        impl_->params.beam_search.beam_size = beam_size;
-    } else {
-        impl_->params.strategy = WHISPER_SAMPLING_GREEDY;
-    }
+    impl_->update_settings([beam_size](DecodeSettings& settings) {
+        settings.config.beam_size = beam_size;
+        if (beam_size > 1) {
+            settings.params.strategy = WHISPER_SAMPLING_BEAM_SEARCH;
+            settings.params.beam_search.beam_size = beam_size;
+        } else {
+            settings.params.strategy = WHISPER_SAMPLING_GREEDY;
+        }
+    });
+}
+
+void WhisperWrapper::set_adaptive_audio_ctx(bool enabled) {
+    impl_->update_settings([enabled](DecodeSettings& settings) {
+        settings.config.adaptive_audio_ctx = enabled;
+    });
+}
+
+void WhisperWrapper::set_cascade(bool enabled, float min_confidence, float min_avg_logprob) {
+    impl_->update_settings([=](DecodeSettings& settings) {
+        settings.config.cascade_decode = enabled;
+        settings.config.cascade_min_confidence = min_confidence;
+        settings.config.cascade_min_avg_logprob = min_avg_logprob;
+    });
+}
+
+void WhisperWrapper::set_temperature(float temperature) {
+    impl_->update_settings([temperature](DecodeSettings& settings) {
+        settings.config.temperature = temperature;
+        settings.params.temperature = temperature;
+        settings.partial_params.temperature = temperature;
+        settings.greedy_params.temperature = temperature;
+    });
+}
+
+void WhisperWrapper::set_segment_metadata(bool enabled) {
+    impl_->segment_metadata = enabled;
 }
 
 bool WhisperWrapper::is_multilingual() const {
@@ -373,10 +876,27 @@ std::string WhisperWrapper::get_model_type() const {
 }
 
 float WhisperWrapper::get_rtf() const {
+    std::lock_guard<std::mutex> lock(impl_->stats_mutex);
     if (impl_->rtf_count == 0) return 0.0f;
     return impl_->total_rtf / impl_->rtf_count;
 }
 
+size_t WhisperWrapper::get_cascade_decodes() const {
+    std::lock_guard<std::mutex> lock(impl_->stats_mutex);
+    return impl_->cascade_decodes;
+}
+
+size_t WhisperWrapper::get_cascade_fallbacks() const {
+    std::lock_guard<std::mutex> lock(impl_->stats_mutex);
+    return impl_->cascade_fallbacks;
+}
+
+float WhisperWrapper::get_avg_audio_ctx() const {
+    std::lock_guard<std::mutex> lock(impl_->stats_mutex);
+    if (impl_->audio_ctx_count == 0) return 0.0f;
+    return static_cast<float>(impl_->total_audio_ctx) / impl_->audio_ctx_count;
+}
+
 size_t WhisperWrapper::get_model_memory_usage() const {
     if (!impl_->ctx) return 0;
     // This function no longer exists in newer whisper.cpp
@@ -390,12 +910,13 @@ size_t WhisperWrapper::get_model_memory_usage() const {
     return 500 * 1024 * 1024; // default estimate
 }
 
-void WhisperWrapper::reset_streaming_state() {
-    streaming_state_->context_buffer.clear();
-    streaming_state_->overlap_buffer.clear();
-    streaming_state_->offset_ms = 0;
-    streaming_state_->previous_text.clear();
-    streaming_state_->n_failures = 0;
+void WhisperWrapper::reset_streaming_state(StreamingState& state) {
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.context_buffer.clear();
+    state.overlap_buffer.clear();
+    state.offset_ms = 0;
+    state.previous_text.clear();
+    state.n_failures = 0;
 }
 
 } // namespace stt
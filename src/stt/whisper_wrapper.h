@@ -6,9 +6,12 @@
 #include <memory>
 #include <functional>
 #include <chrono>
+#include <mutex>
+#include <utility>
 
 // Forward declarations for whisper.cpp types
 struct whisper_context;
+struct whisper_state;
 struct whisper_full_params;
 
 namespace rt_stt {
@@ -20,6 +23,7 @@ struct TranscriptionResult {
     float confidence;
     bool is_final;
     std::chrono::milliseconds processing_time;
+    std::chrono::milliseconds speech_latency{0};  // Finals from the engine: last voiced frame -> delivered
     std::string language;
     float language_probability;
     std::vector<std::pair<int64_t, int64_t>> timestamps; // start, end in ms
@@ -41,24 +45,56 @@ struct TranscriptionResult {
     std::vector<Segment> segments;
     int64_t audio_duration_ms;
     std::string model_name;
+    std::string stream_id; // Capture stream the audio came from
+    int audio_ctx = 0;     // Encoder frames used (1500 = the full 30 s window)
+    bool fallback_used = false; // Cascade mode: the greedy pass was rejected and re-decoded
 };
 
 // Model configuration
 struct ModelConfig {
     std::string model_path;
     std::string language = "en"; // "en" for English, "auto" for detection
-    int n_threads = 4;
+    int n_threads = 4;       // Threads per decode
     int n_processors = 1;
+    int n_decoders = 1;      // Decoder states sharing the weights (concurrent decodes)
     bool use_gpu = true;
     bool flash_attn = false;
     int beam_size = 5;
     float temperature = 0.0f;
     bool translate = false; // Translate to English
+    bool use_mmap = true;   // Read the model file through a memory map
+    
+    // Size the encoder window to each utterance instead of the full 30 s
+    // (audio_ctx = 1500). Whisper was trained on full windows, so this trades
+    // some accuracy for encoder time; measure before enabling.
+    bool adaptive_audio_ctx = false;
+    int audio_ctx_margin_ms = 500;   // Extra context beyond the audio itself
+    int audio_ctx_granularity = 64;  // Round audio_ctx up to a multiple of this
+    
+    // Decode finals greedily first and only re-run the full strategy (beam
+    // search when beam_size > 1, with temperature fallback) when the greedy
+    // result scores below either threshold
+    bool cascade_decode = false;
+    float cascade_min_confidence = 0.6f;     // exp(mean token log-probability)
+    float cascade_min_avg_logprob = -1.0f;   // Worst segment's mean token log-probability
 };
 
 class WhisperWrapper {
 public:
-    using TranscriptionCallback = std::function<void(const TranscriptionResult&)>;
+    // Results are handed over by rvalue so callers can move them on
+    using TranscriptionCallback = std::function<void(TranscriptionResult&&)>;
+    
+    // Sliding-window state for one stream's in-progress utterance. Owned by
+    // the caller so several streams can share one model, and so the state
+    // outlives a model swap.
+    struct StreamingState {
+        std::vector<float> context_buffer;
+        std::vector<float> overlap_buffer;
+        int64_t offset_ms = 0;
+        std::string previous_text;
+        int n_failures = 0;
+        std::mutex mutex;   // Appends and decodes run on different threads
+    };
     
     WhisperWrapper();
     ~WhisperWrapper();
@@ -67,16 +103,52 @@ public:
     bool initialize(const ModelConfig& config);
     void shutdown();
     
+    // Run one short silent decode so one-time backend setup (shader
+    // compilation, buffer allocation) happens before the first utterance
+    void warm_up();
+    
     // Process audio data
     void process_audio(const float* samples, size_t n_samples, TranscriptionCallback callback);
     
-    // Stream processing (for real-time)
-    void process_stream(const float* samples, size_t n_samples, TranscriptionCallback callback);
+    // Stream processing (for real-time). prompt_tokens, if any, are fed to
+    // the decoder as preceding context (see get_prompt_tokens).
+    void process_stream(const float* samples, size_t n_samples, TranscriptionCallback callback,
+                        const std::vector<int>& prompt_tokens = {});
+    
+    // Decode several short utterances in one whisper_full call: they are
+    // joined with gap_ms of silence and each segment is handed back to the
+    // utterance its timestamps fall in. The callback receives the index of
+    // each utterance that produced text, along with its final result.
+    using BatchCallback = std::function<void(size_t utterance, TranscriptionResult&&)>;
+    void process_batch(const std::vector<std::pair<const float*, size_t>>& utterances, int gap_ms,
+                       BatchCallback callback, const std::vector<int>& prompt_tokens = {});
+    
+    // The last max_tokens text tokens of a result (timestamps and special
+    // tokens removed), for prompting the decode that follows it
+    std::vector<int> get_prompt_tokens(const TranscriptionResult& result, size_t max_tokens) const;
     
-    // Configuration
+    // Incremental processing of an utterance that is still in progress.
+    // append_partial adds new samples to a sliding window (cheap; callers
+    // must append in order), decode_partial emits a partial (is_final = false)
+    // result for the current window.
+    void append_partial(StreamingState& state, const float* samples, size_t n_samples);
+    void decode_partial(StreamingState& state, TranscriptionCallback callback);
+    
+    // Drop the sliding window once the utterance has been finalized
+    void reset_streaming_state(StreamingState& state);
+    
+    // Configuration. Safe while decodes run: each decode keeps the settings
+    // it started with, and the change applies from the next utterance.
     void set_language(const std::string& language);
     void set_translate(bool translate);
     void set_beam_size(int beam_size);
+    void set_adaptive_audio_ctx(bool enabled);
+    void set_cascade(bool enabled, float min_confidence, float min_avg_logprob);
+    void set_temperature(float temperature);
+    
+    // Per-segment text and token ids on results (default on). Off, segments
+    // keep only timing and log-probabilities, saving their allocations.
+    void set_segment_metadata(bool enabled);
     
     // Model info
     bool is_multilingual() const;
@@ -84,28 +156,30 @@ public:
     std::string get_model_type() const;
     
     // Performance metrics
-    float get_rtf() const; // Real-time factor
+    float get_rtf() const; // Real-time factor, mean over final decodes
+    float get_avg_audio_ctx() const; // Mean encoder frames per decode
+    size_t get_cascade_decodes() const;   // Finals decoded in cascade mode
+    size_t get_cascade_fallbacks() const; // ...of which needed the full strategy
     size_t get_model_memory_usage() const;
     
+    // Number of decodes that can run concurrently (process_* are thread-safe
+    // and block while all decoder states are busy)
+    size_t get_pool_size() const;
+    
 private:
     struct Impl;
+    struct DecodeSettings;
+    class StateLease;
     std::unique_ptr<Impl> impl_;
     
-    // Streaming state
-    struct StreamingState {
-        std::vector<float> context_buffer;
-        std::vector<float> overlap_buffer;
-        int64_t offset_ms = 0;
-        std::string previous_text;
-        int n_failures = 0;
-    };
-    
-    std::unique_ptr<StreamingState> streaming_state_;
-    
     // Internal methods
-    void reset_streaming_state();
-    TranscriptionResult process_segment(const float* samples, size_t n_samples);
-    float calculate_confidence(whisper_context* ctx);
+    TranscriptionResult process_segment(whisper_state* state, const float* samples, size_t n_samples,
+                                        const DecodeSettings& settings, const whisper_full_params& params,
+                                        const std::vector<int>& prompt_tokens = {}, bool full_segments = false);
+    TranscriptionResult decode_final(whisper_state* state, const float* samples, size_t n_samples,
+                                     const std::vector<int>& prompt_tokens, bool full_segments);
+    float calculate_confidence(whisper_state* state);
+    bool accept_cascade_result(const TranscriptionResult& result, const DecodeSettings& settings) const;
 };
 
 } // namespace stt
@@ -62,6 +62,7 @@ int main(int argc, char* argv[]) {
             std::cout << "  --no-gpu           Disable GPU acceleration\n";
             std::cout << "  --translate        Translate to English\n";
             std::cout << "  --device NAME      Audio device name (default: MOTU M2)\n";
+            std::cout << "  --native-rate      Capture at the device rate and resample to 16 kHz\n";
             std::cout << "  --no-vad           Disable VAD (process all audio)\n";
             return 0;
         }
@@ -107,6 +108,7 @@ int main(int argc, char* argv[]) {
     audio_config.sample_rate = 16000;
     audio_config.channels = 1;
     audio_config.buffer_size_ms = 30;
+    audio_config.use_callback = false;
     
     // Check for audio device override
     for (int i = 1; i < argc - 1; i++) {
@@ -115,6 +117,11 @@ int main(int argc, char* argv[]) {
             break;
         }
     }
+    for (int i = 1; i < argc; i++) {
+        if (std::string(argv[i]) == "--native-rate") {
+            audio_config.native_rate = true;
+        }
+    }
     
     // Create audio capture
     rt_stt::audio::AudioCapture capture;
@@ -134,9 +141,9 @@ int main(int argc, char* argv[]) {
         }
     }
     
-    // Set audio callback
-    capture.set_callback([&engine](const float* samples, size_t n_samples) {
-        engine.feed_audio(samples, n_samples);
+    // Engine pulls audio from the capture ring on its ingest thread
+    engine.set_audio_source([&capture](float* buffer, size_t max_samples) {
+        return capture.read_samples(buffer, max_samples);
     });
     
     // Start engine and capture
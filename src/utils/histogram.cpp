@@ -0,0 +1,85 @@
+#include "utils/histogram.h"
+#include <algorithm>
+#include <cmath>
+
+namespace rt_stt {
+namespace utils {
+
+size_t LatencyHistogram::bucket_index(uint64_t us) {
+    if (us < static_cast<uint64_t>(SUB_BUCKETS)) {
+        return static_cast<size_t>(us);
+    }
+    
+    int msb = 63;
+    while (!(us >> msb)) --msb;
+    if (msb > MAX_EXPONENT) {
+        return BUCKET_COUNT - 1;
+    }
+    
+    int shift = msb - SUB_BUCKET_BITS;
+    return static_cast<size_t>(shift + 1) * SUB_BUCKETS + static_cast<size_t>((us >> shift) - SUB_BUCKETS);
+}
+
+uint64_t LatencyHistogram::bucket_midpoint(size_t index) {
+    if (index < static_cast<size_t>(SUB_BUCKETS)) {
+        return index;
+    }
+    
+    int shift = static_cast<int>(index / SUB_BUCKETS) - 1;
+    uint64_t lower = static_cast<uint64_t>(index % SUB_BUCKETS + SUB_BUCKETS) << shift;
+    return lower + ((uint64_t(1) << shift) >> 1);
+}
+
+void LatencyHistogram::record_us(uint64_t us) {
+    counts_[bucket_index(us)].fetch_add(1, std::memory_order_relaxed);
+    sum_us_.fetch_add(us, std::memory_order_relaxed);
+    
+    uint64_t prev = max_us_.load(std::memory_order_relaxed);
+    while (us > prev && !max_us_.compare_exchange_weak(prev, us, std::memory_order_relaxed)) {}
+}
+
+LatencyHistogram::Snapshot LatencyHistogram::snapshot() const {
+    Snapshot snap;
+    for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+        snap.counts[i] = counts_[i].load(std::memory_order_relaxed);
+        snap.count += snap.counts[i];
+    }
+    // The total is the sum of the buckets, so percentiles are consistent
+    // with the counts they walk
+    snap.sum_us = sum_us_.load(std::memory_order_relaxed);
+    snap.max_us = max_us_.load(std::memory_order_relaxed);
+    return snap;
+}
+
+float LatencyHistogram::Snapshot::percentile_ms(double q) const {
+    if (count == 0) return 0.0f;
+    
+    uint64_t rank = static_cast<uint64_t>(std::ceil(std::clamp(q, 0.0, 1.0) * count));
+    rank = std::max<uint64_t>(rank, 1);
+    
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+        seen += counts[i];
+        if (seen >= rank) {
+            // The midpoint can overshoot the largest value actually seen
+            return std::min(bucket_midpoint(i), max_us) / 1000.0f;
+        }
+    }
+    return max_ms();
+}
+
+void write_prometheus_summary(std::ostream& out, const std::string& name,
+                              const std::string& labels, const LatencyHistogram::Snapshot& snapshot) {
+    const std::string prefix = labels.empty() ? "" : labels + ",";
+    for (double q : {0.5, 0.9, 0.99}) {
+        out << name << "{" << prefix << "quantile=\"" << q << "\"} "
+            << snapshot.percentile_ms(q) / 1000.0 << "\n";
+    }
+    
+    const std::string suffix = labels.empty() ? "" : "{" + labels + "}";
+    out << name << "_sum" << suffix << " " << snapshot.sum_us / 1e6 << "\n";
+    out << name << "_count" << suffix << " " << snapshot.count << "\n";
+}
+
+} // namespace utils
+} // namespace rt_stt
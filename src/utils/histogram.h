@@ -0,0 +1,60 @@
+#ifndef UTILS_HISTOGRAM_H
+#define UTILS_HISTOGRAM_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+namespace rt_stt {
+namespace utils {
+
+// HDR-style latency histogram: 16 linear sub-buckets per power of two of
+// microseconds, so any recorded value is within ~6% of its bucket. record()
+// is a few relaxed atomic adds and safe from any thread; readers take a
+// snapshot, which may mix in a concurrent record but never tears a count.
+class LatencyHistogram {
+public:
+    static constexpr int SUB_BUCKET_BITS = 4;
+    static constexpr int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static constexpr int MAX_EXPONENT = 36;   // ~19 hours in microseconds
+    static constexpr size_t BUCKET_COUNT = (MAX_EXPONENT - SUB_BUCKET_BITS + 2) * SUB_BUCKETS;
+
+    struct Snapshot {
+        std::array<uint64_t, BUCKET_COUNT> counts{};
+        uint64_t count = 0;
+        uint64_t sum_us = 0;
+        uint64_t max_us = 0;
+
+        // Value at quantile q (0..1), in milliseconds
+        float percentile_ms(double q) const;
+        float mean_ms() const { return count ? static_cast<float>(sum_us / 1000.0 / count) : 0.0f; }
+        float max_ms() const { return max_us / 1000.0f; }
+    };
+
+    void record_us(uint64_t us);
+    void record_ms(double ms) { record_us(ms > 0.0 ? static_cast<uint64_t>(ms * 1000.0) : 0); }
+
+    Snapshot snapshot() const;
+
+private:
+    std::array<std::atomic<uint64_t>, BUCKET_COUNT> counts_{};
+    std::atomic<uint64_t> sum_us_{0};
+    std::atomic<uint64_t> max_us_{0};
+
+    static size_t bucket_index(uint64_t us);
+    static uint64_t bucket_midpoint(size_t index);
+};
+
+// Prometheus text exposition of a snapshot as summary series (p50/p90/p99,
+// _sum, _count) in seconds. labels, if non-empty, is the inside of {...},
+// e.g. stage="decode". The caller writes the # HELP / # TYPE lines once.
+void write_prometheus_summary(std::ostream& out, const std::string& name,
+                              const std::string& labels, const LatencyHistogram::Snapshot& snapshot);
+
+} // namespace utils
+} // namespace rt_stt
+
+#endif // UTILS_HISTOGRAM_H
@@ -0,0 +1,100 @@
+#include "utils/tool_common.h"
+#include "miniaudio.h"
+#include <algorithm>
+#include <atomic>
+#include <csignal>
+#include <cstdio>
+#include <iostream>
+#include <vector>
+
+namespace rt_stt {
+namespace utils {
+
+namespace {
+
+std::atomic<bool> g_running(true);
+
+void stop_handler(int signal) {
+    if (signal == SIGINT || signal == SIGTERM) {
+        g_running = false;
+    }
+}
+
+} // namespace
+
+void install_stop_handlers() {
+    std::signal(SIGINT, stop_handler);
+    std::signal(SIGTERM, stop_handler);
+}
+
+bool running() {
+    return g_running.load();
+}
+
+std::string format_time(double seconds) {
+    auto ms = static_cast<long long>(seconds * 1000.0 + 0.5);
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%02lld:%02lld:%02lld.%03lld",
+                  ms / 3600000, (ms / 60000) % 60, (ms / 1000) % 60, ms % 1000);
+    return buffer;
+}
+
+bool decode_audio_file(const std::string& path, uint32_t sample_rate, size_t frame_samples,
+                       const FrameFn& on_frame, uint64_t& total_samples) {
+    total_samples = 0;
+
+    // miniaudio resamples and downmixes while decoding
+    ma_decoder_config decoder_config = ma_decoder_config_init(ma_format_f32, 1, sample_rate);
+    ma_decoder decoder;
+    if (ma_decoder_init_file(path.c_str(), &decoder_config, &decoder) != MA_SUCCESS) {
+        std::cerr << "Failed to open audio file: " << path << std::endl;
+        return false;
+    }
+
+    std::vector<float> frame(frame_samples);
+    while (g_running.load()) {
+        ma_uint64 frames_read = 0;
+        ma_result result = ma_decoder_read_pcm_frames(&decoder, frame.data(), frame_samples, &frames_read);
+        if (frames_read > 0) {
+            on_frame(frame.data(), static_cast<size_t>(frames_read));
+            total_samples += frames_read;
+        }
+        if (result != MA_SUCCESS || frames_read < frame_samples) break;
+    }
+    ma_decoder_uninit(&decoder);
+    return true;
+}
+
+bool parse_model_option(int argc, char* argv[], int& i, stt::ModelConfig& model) {
+    std::string arg = argv[i];
+    if (arg == "--no-gpu") {
+        model.use_gpu = false;
+        return true;
+    }
+    if (i + 1 >= argc) {
+        return false;
+    }
+    if (arg == "--model") {
+        model.model_path = argv[++i];
+    } else if (arg == "--language") {
+        model.language = argv[++i];
+    } else if (arg == "--threads") {
+        model.n_threads = std::max(1, std::stoi(argv[++i]));
+    } else if (arg == "--beam-size") {
+        model.beam_size = std::stoi(argv[++i]);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+void print_model_usage() {
+    std::cout << "  --model PATH        Path to Whisper model (default: models/ggml-base.en.bin)\n";
+    std::cout << "  --language LANG     Language code (default: en, use 'auto' for detection)\n";
+    std::cout << "  --threads N         Threads per decode (default: 4)\n";
+    std::cout << "  --beam-size N       Beam search size (default: 5)\n";
+    std::cout << "  --no-gpu            Disable GPU acceleration\n";
+}
+
+} // namespace utils
+} // namespace rt_stt
@@ -0,0 +1,43 @@
+#ifndef UTILS_TOOL_COMMON_H
+#define UTILS_TOOL_COMMON_H
+
+#include "stt/whisper_wrapper.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+namespace rt_stt {
+namespace utils {
+
+// Helpers shared by the offline tools (rt-stt-batch, rt-stt-bench,
+// rt-stt-replay): the SIGINT/SIGTERM stop flag, file decoding and the
+// model options every tool accepts.
+
+// Clears running() on SIGINT or SIGTERM so loops can wind down cleanly
+void install_stop_handlers();
+bool running();
+
+// HH:MM:SS.mmm, rounded to the millisecond
+std::string format_time(double seconds);
+
+// Decodes a file in any format miniaudio reads (WAV, FLAC, MP3) to mono
+// float at sample_rate, handing it to on_frame frame_samples at a time (the
+// last piece may be shorter). Stops early once running() is cleared.
+// Returns false if the file could not be opened; total_samples is what was
+// handed over.
+using FrameFn = std::function<void(const float* samples, size_t n_samples)>;
+bool decode_audio_file(const std::string& path, uint32_t sample_rate, size_t frame_samples,
+                       const FrameFn& on_frame, uint64_t& total_samples);
+
+// Consumes argv[i] (and its value, advancing i) if it is one of --model,
+// --language, --threads, --beam-size or --no-gpu; false leaves i alone
+bool parse_model_option(int argc, char* argv[], int& i, stt::ModelConfig& model);
+
+// Usage lines for the options parse_model_option() accepts
+void print_model_usage();
+
+} // namespace utils
+} // namespace rt_stt
+
+#endif // UTILS_TOOL_COMMON_H